@@ -7,11 +7,43 @@ bloomfilter – fast C++17 Bloom filter
 from importlib import import_module
 
 try:
-    BloomFilter = import_module("._bloomfilter", __package__).BloomFilter
+    _ext = import_module("._bloomfilter", __package__)
 except ModuleNotFoundError as exc:  # pragma: no cover
     raise ImportError(
         "The C extension failed to import. Did the build step run successfully?"
     ) from exc
 
-__all__ = ["BloomFilter"]
+AdaptiveBloomFilter = _ext.AdaptiveBloomFilter
+BlockIndex = _ext.BlockIndex
+BlockedBloomFilter = _ext.BlockedBloomFilter
+BloomFilter = _ext.BloomFilter
+BloomierFilter = _ext.BloomierFilter
+CountMinSketch = _ext.CountMinSketch
+DiskBloomFilter = getattr(_ext, "DiskBloomFilter", None)  # POSIX only
+FilterArray = _ext.FilterArray
+IBLT = _ext.IBLT
+ParquetBloomFilter = _ext.ParquetBloomFilter
+TieredBloomFilter = _ext.TieredBloomFilter
+set_num_threads = _ext.set_num_threads
+get_num_threads = _ext.get_num_threads
+metrics_text = _ext.metrics_text
+merge_files = getattr(_ext, "merge_files", None)  # POSIX only
+
+__all__ = [
+    "AdaptiveBloomFilter",
+    "BlockIndex",
+    "BlockedBloomFilter",
+    "BloomFilter",
+    "BloomierFilter",
+    "CountMinSketch",
+    "DiskBloomFilter",
+    "FilterArray",
+    "IBLT",
+    "ParquetBloomFilter",
+    "TieredBloomFilter",
+    "set_num_threads",
+    "get_num_threads",
+    "metrics_text",
+    "merge_files",
+]
 __version__ = "0.1.1"
@@ -0,0 +1,152 @@
+#include "adaptive_bloom_filter.h"
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+namespace {
+
+size_t round_up_pow2(size_t n) {
+  size_t p = 1;
+  while (p < n) p <<= 1;
+  return p;
+}
+
+} // namespace
+
+FingerprintTable::FingerprintTable(size_t capacity)
+    : size_(0), rng_state_(HASH_SEED2) {
+  if (capacity == 0) {
+    throw std::invalid_argument("Fingerprint table capacity must be > 0");
+  }
+  // Cuckoo tables with 4-slot buckets stay insertable up to ~95% load
+  const size_t buckets = round_up_pow2(
+      (capacity * 100 / 95 + SLOTS_PER_BUCKET - 1) / SLOTS_PER_BUCKET);
+  slots_.assign(buckets * SLOTS_PER_BUCKET, 0);
+  bucket_mask_ = buckets - 1;
+}
+
+// Constructor for deserialization
+FingerprintTable::FingerprintTable(const std::vector<uint32_t> &slots_data)
+    : slots_(slots_data), size_(0), rng_state_(HASH_SEED2) {
+  const size_t buckets = slots_.size() / SLOTS_PER_BUCKET;
+  if (buckets == 0 || slots_.size() % SLOTS_PER_BUCKET != 0 ||
+      (buckets & (buckets - 1)) != 0) {
+    throw std::invalid_argument("Invalid data for fingerprint table restoration");
+  }
+  bucket_mask_ = buckets - 1;
+  for (uint32_t fp : slots_) size_ += fp != 0;
+}
+
+FingerprintTable::Location FingerprintTable::locate(const KeyHash &hash) const {
+  // Remix so the table is independent of the filter's own probe positions
+  const uint64_t g = mix64(hash.h1 ^ (hash.h2 << 32 | hash.h2 >> 32));
+  uint32_t fp = static_cast<uint32_t>(g >> 32);
+  fp += fp == 0; // 0 is reserved for empty slots
+  const size_t b1 = static_cast<size_t>(g) & bucket_mask_;
+  return {fp, b1, alternate(b1, fp)};
+}
+
+size_t FingerprintTable::alternate(size_t bucket, uint32_t fingerprint) const {
+  // Partial-key cuckoo hashing: the xor is its own inverse
+  return (bucket ^ static_cast<size_t>(mix64(fingerprint))) & bucket_mask_;
+}
+
+bool FingerprintTable::try_place(size_t bucket, uint32_t fingerprint) {
+  uint32_t *slots = &slots_[bucket * SLOTS_PER_BUCKET];
+  for (size_t s = 0; s < SLOTS_PER_BUCKET; ++s) {
+    if (slots[s] == 0) {
+      slots[s] = fingerprint;
+      return true;
+    }
+  }
+  return false;
+}
+
+void FingerprintTable::insert(const KeyHash &hash) {
+  if (contains(hash)) return;
+  const Location loc = locate(hash);
+  ++size_;
+  if (try_place(loc.bucket1, loc.fingerprint) ||
+      try_place(loc.bucket2, loc.fingerprint)) {
+    return;
+  }
+  uint32_t fp = loc.fingerprint;
+  size_t bucket = (rng_state_ & 1) ? loc.bucket1 : loc.bucket2;
+  for (int kick = 0; kick < MAX_KICKS; ++kick) {
+    rng_state_ = mix64(rng_state_);
+    std::swap(fp, slots_[bucket * SLOTS_PER_BUCKET + rng_state_ % SLOTS_PER_BUCKET]);
+    bucket = alternate(bucket, fp);
+    if (try_place(bucket, fp)) return;
+  }
+  --size_; // table is saturated: forget the fingerprint still in hand
+}
+
+bool FingerprintTable::contains(const KeyHash &hash) const {
+  const Location loc = locate(hash);
+  const uint32_t *b1 = &slots_[loc.bucket1 * SLOTS_PER_BUCKET];
+  const uint32_t *b2 = &slots_[loc.bucket2 * SLOTS_PER_BUCKET];
+  bool found = false;
+  for (size_t s = 0; s < SLOTS_PER_BUCKET; ++s) {
+    found |= (b1[s] == loc.fingerprint) | (b2[s] == loc.fingerprint);
+  }
+  return found;
+}
+
+bool FingerprintTable::erase(const KeyHash &hash) {
+  const Location loc = locate(hash);
+  for (size_t bucket : {loc.bucket1, loc.bucket2}) {
+    uint32_t *slots = &slots_[bucket * SLOTS_PER_BUCKET];
+    for (size_t s = 0; s < SLOTS_PER_BUCKET; ++s) {
+      if (slots[s] == loc.fingerprint) {
+        slots[s] = 0;
+        --size_;
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+void FingerprintTable::clear() {
+  std::fill(slots_.begin(), slots_.end(), 0);
+  size_ = 0;
+}
+
+AdaptiveBloomFilter::AdaptiveBloomFilter(size_t estimated_num_items,
+                                         double false_positive_rate,
+                                         size_t max_suppressed)
+    : filter_(estimated_num_items, false_positive_rate),
+      suppressed_(max_suppressed) {}
+
+AdaptiveBloomFilter::AdaptiveBloomFilter(const BloomFilter &filter,
+                                         size_t max_suppressed)
+    : filter_(filter), suppressed_(max_suppressed) {}
+
+// Constructor for deserialization
+AdaptiveBloomFilter::AdaptiveBloomFilter(const BloomFilter &filter,
+                                         const std::vector<uint32_t> &slots_data)
+    : filter_(filter), suppressed_(slots_data) {}
+
+void AdaptiveBloomFilter::add(const char *data, size_t len) {
+  const KeyHash hash = filter_.hash(data, len);
+  filter_.add_hash(hash);
+  if (suppressed_.size() != 0) {
+    suppressed_.erase(hash);
+  }
+}
+
+bool AdaptiveBloomFilter::might_contain(const char *data, size_t len) const {
+  const KeyHash hash = filter_.hash(data, len);
+  // The table is only consulted on the (rare) positive path
+  return filter_.might_contain_hash(hash) &&
+         (suppressed_.size() == 0 || !suppressed_.contains(hash));
+}
+
+bool AdaptiveBloomFilter::report_false_positive(const char *data, size_t len) {
+  const KeyHash hash = filter_.hash(data, len);
+  if (!filter_.might_contain_hash(hash)) {
+    return false;
+  }
+  suppressed_.insert(hash);
+  return true;
+}
@@ -0,0 +1,83 @@
+#ifndef ADAPTIVE_BLOOM_FILTER_H
+#define ADAPTIVE_BLOOM_FILTER_H
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+#include "bloom_filter.h"
+#include "hashing.h"
+
+// Small cuckoo table of 32-bit fingerprints (4 slots per bucket). Used as a
+// bounded cache: when an insertion cannot find room the last evicted
+// fingerprint is dropped instead of failing.
+class FingerprintTable {
+public:
+    explicit FingerprintTable(size_t capacity);
+    // Constructor for deserialization
+    explicit FingerprintTable(const std::vector<uint32_t>& slots_data);
+
+    void insert(const KeyHash& hash);
+    bool contains(const KeyHash& hash) const;
+    bool erase(const KeyHash& hash);
+    void clear();
+
+    size_t size() const { return size_; }
+    size_t capacity() const { return slots_.size(); }
+    const std::vector<uint32_t>& get_raw_slots_vector() const { return slots_; }
+
+private:
+    struct Location {
+        uint32_t fingerprint;
+        size_t bucket1;
+        size_t bucket2;
+    };
+    Location locate(const KeyHash& hash) const;
+    size_t alternate(size_t bucket, uint32_t fingerprint) const;
+    bool try_place(size_t bucket, uint32_t fingerprint);
+
+    static constexpr size_t SLOTS_PER_BUCKET = 4;
+    static constexpr int MAX_KICKS = 128;
+
+    std::vector<uint32_t> slots_; // 0 marks an empty slot
+    size_t bucket_mask_;
+    size_t size_;
+    uint64_t rng_state_;
+};
+
+// BloomFilter plus a record of confirmed false positives. Once the caller
+// reports that a "maybe" answer was wrong, later queries for that key are
+// answered "no" from the fingerprint table without reaching the backend.
+// Adding a key clears any matching record, so inserted keys are never
+// suppressed; a non-member fingerprint collision with a member (about
+// 2^-32 per reported key) is the only way to lose a true positive.
+class AdaptiveBloomFilter {
+public:
+    AdaptiveBloomFilter(size_t estimated_num_items, double false_positive_rate,
+                        size_t max_suppressed);
+    AdaptiveBloomFilter(const BloomFilter& filter, size_t max_suppressed);
+    // Constructor for deserialization
+    AdaptiveBloomFilter(const BloomFilter& filter, const std::vector<uint32_t>& slots_data);
+
+    void add(const char* data, size_t len);
+    bool might_contain(const char* data, size_t len) const;
+
+    // Record a key the backend confirmed absent. Returns false (and records
+    // nothing) if the filter does not currently answer "maybe" for it.
+    bool report_false_positive(const char* data, size_t len);
+    void clear_suppressed() { suppressed_.clear(); }
+
+    // Accessors
+    const BloomFilter& get_filter() const { return filter_; }
+    size_t get_num_suppressed() const { return suppressed_.size(); }
+    size_t get_max_suppressed() const { return suppressed_.capacity(); }
+    const std::vector<uint32_t>& get_raw_slots_vector() const {
+        return suppressed_.get_raw_slots_vector();
+    }
+
+private:
+    BloomFilter filter_;
+    FingerprintTable suppressed_;
+};
+
+#endif // ADAPTIVE_BLOOM_FILTER_H
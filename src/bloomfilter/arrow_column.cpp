@@ -0,0 +1,130 @@
+#include "arrow_column.h"
+#include "batch_hash.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+ArrowColumn::ArrowColumn(const ArrowSchema &schema, const ArrowArray &array)
+    : length_(static_cast<size_t>(array.length)),
+      offset_(static_cast<size_t>(array.offset)), null_count_(array.null_count),
+      validity_(static_cast<const uint8_t *>(array.buffers ? array.buffers[0] : nullptr)) {
+  if (schema.format == nullptr || schema.dictionary != nullptr) {
+    throw std::invalid_argument("Dictionary-encoded Arrow arrays are not supported");
+  }
+  const std::string format(schema.format);
+  if (format == "u" || format == "z") {
+    kind_ = Kind::Binary;
+  } else if (format == "U" || format == "Z") {
+    kind_ = Kind::LargeBinary;
+  } else if (format.size() == 1 && std::strchr("cCsSiIlL", format[0])) {
+    kind_ = Kind::Integer;
+    const char c = format[0];
+    int_width_ = (c == 'c' || c == 'C') ? 1 : (c == 's' || c == 'S') ? 2
+               : (c == 'i' || c == 'I') ? 4 : 8;
+    int_signed_ = c == 'c' || c == 's' || c == 'i' || c == 'l';
+  } else {
+    throw std::invalid_argument("Unsupported Arrow type '" + format +
+                                "': expected string, binary or integer");
+  }
+
+  const int64_t expected_buffers = kind_ == Kind::Integer ? 2 : 3;
+  if (array.n_buffers != expected_buffers || array.buffers == nullptr) {
+    throw std::invalid_argument("Malformed Arrow array: unexpected buffer count");
+  }
+  if (kind_ == Kind::Integer) {
+    data_ = static_cast<const char *>(array.buffers[1]);
+  } else {
+    if (kind_ == Kind::Binary) {
+      offsets32_ = static_cast<const int32_t *>(array.buffers[1]);
+    } else {
+      offsets64_ = static_cast<const int64_t *>(array.buffers[1]);
+    }
+    data_ = static_cast<const char *>(array.buffers[2]);
+  }
+  // The data buffer of a string column may be null when every value is empty
+  if (length_ > 0 && array.buffers[1] == nullptr) {
+    throw std::invalid_argument("Malformed Arrow array: missing offsets or values buffer");
+  }
+}
+
+uint64_t ArrowColumn::integer(size_t i) const {
+  const char *p = data_ + (offset_ + i) * int_width_;
+  switch (int_width_) {
+  case 1: {
+    uint8_t v;
+    std::memcpy(&v, p, 1);
+    return int_signed_ ? static_cast<uint64_t>(static_cast<int64_t>(static_cast<int8_t>(v))) : v;
+  }
+  case 2: {
+    uint16_t v;
+    std::memcpy(&v, p, 2);
+    return int_signed_ ? static_cast<uint64_t>(static_cast<int64_t>(static_cast<int16_t>(v))) : v;
+  }
+  case 4: {
+    uint32_t v;
+    std::memcpy(&v, p, 4);
+    return int_signed_ ? static_cast<uint64_t>(static_cast<int64_t>(static_cast<int32_t>(v))) : v;
+  }
+  default: {
+    uint64_t v;
+    std::memcpy(&v, p, 8);
+    return v;
+  }
+  }
+}
+
+std::string_view ArrowColumn::key(size_t i, char (&scratch)[8]) const {
+  const size_t row = offset_ + i;
+  switch (kind_) {
+  case Kind::Binary:
+    return {data_ + offsets32_[row],
+            static_cast<size_t>(offsets32_[row + 1] - offsets32_[row])};
+  case Kind::LargeBinary:
+    return {data_ + offsets64_[row],
+            static_cast<size_t>(offsets64_[row + 1] - offsets64_[row])};
+  case Kind::Integer:
+  default: {
+    const uint64_t v = integer(i);
+    for (unsigned b = 0; b < 8; ++b) {
+      scratch[b] = static_cast<char>(v >> (8 * b));
+    }
+    return {scratch, 8};
+  }
+  }
+}
+
+void add_arrow_column(BloomFilter &filter, const ArrowColumn &column,
+                      size_t threads) {
+  parallel_for(column.size(), 1 << 14, threads, [&](size_t begin, size_t end) {
+    KeyHash hashes[HASH_BLOCK];
+    for (size_t start = begin; start < end; start += HASH_BLOCK) {
+      const size_t m = std::min(HASH_BLOCK, end - start);
+      hash_column_rows(filter.get_hash_scheme(), column, start, m, hashes);
+      for (size_t j = 0; j < m; ++j) {
+        if (column.is_valid(start + j)) filter.add_hash_concurrent(hashes[j]);
+      }
+    }
+  });
+}
+
+void contains_arrow_column(const BloomFilter &filter, const ArrowColumn &column,
+                           uint64_t *out_bits, size_t threads) {
+  // Chunk by whole output words so threads never share one
+  const size_t num_words = (column.size() + 63) / 64;
+  parallel_for(num_words, 256, threads, [&](size_t begin, size_t end) {
+    KeyHash hashes[64];
+    for (size_t w = begin; w < end; ++w) {
+      uint64_t word = 0;
+      const size_t first = w * 64;
+      const size_t last = std::min(column.size(), first + 64);
+      hash_column_rows(filter.get_hash_scheme(), column, first, last - first, hashes);
+      for (size_t i = first; i < last; ++i) {
+        if (!column.is_valid(i)) continue;
+        word |= static_cast<uint64_t>(filter.might_contain_hash(hashes[i - first])) << (i & 63);
+      }
+      out_bits[w] = word;
+    }
+  });
+}
@@ -0,0 +1,58 @@
+#ifndef ARROW_COLUMN_H
+#define ARROW_COLUMN_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+#include "arrow_c_data.h"
+#include "bloom_filter.h"
+
+// Zero-copy reader over one Arrow array of string, binary, large_string,
+// large_binary or integer type. Keys are read straight from the offsets and
+// data buffers. Integers of any width are hashed as their value widened to
+// 8 little-endian bytes, so int32 and int64 columns agree.
+class ArrowColumn {
+public:
+    // Throws std::invalid_argument for unsupported types
+    ArrowColumn(const ArrowSchema& schema, const ArrowArray& array);
+
+    size_t size() const { return length_; }
+    bool has_nulls() const { return validity_ != nullptr && null_count_ != 0; }
+    bool is_valid(size_t i) const {
+        if (validity_ == nullptr) return true;
+        const size_t bit = offset_ + i;
+        return (validity_[bit >> 3] >> (bit & 7)) & 1;
+    }
+
+    // Bytes of row i; integer rows are encoded into `scratch`
+    std::string_view key(size_t i, char (&scratch)[8]) const;
+
+    bool is_integer() const { return kind_ == Kind::Integer; }
+    // Integer rows widened to 64 bits (only for integer columns)
+    uint64_t integer(size_t i) const;
+
+private:
+    enum class Kind { Binary, LargeBinary, Integer };
+
+    Kind kind_;
+    unsigned int_width_ = 0; // bytes
+    bool int_signed_ = false;
+    size_t length_;
+    size_t offset_;
+    int64_t null_count_;
+    const uint8_t* validity_;
+    const int32_t* offsets32_ = nullptr;
+    const int64_t* offsets64_ = nullptr;
+    const char* data_ = nullptr;
+};
+
+// Insert every non-null row
+void add_arrow_column(BloomFilter& filter, const ArrowColumn& column, size_t threads = 0);
+
+// Membership of every row as an Arrow boolean bitmap (LSB first) written to
+// out_bits[0 .. (size + 63) / 64); null rows read as false
+void contains_arrow_column(const BloomFilter& filter, const ArrowColumn& column,
+                           uint64_t* out_bits, size_t threads = 0);
+
+#endif // ARROW_COLUMN_H
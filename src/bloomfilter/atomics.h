@@ -0,0 +1,72 @@
+#ifndef BLOOM_ATOMICS_H
+#define BLOOM_ATOMICS_H
+
+#include <cstdint>
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+
+// Relaxed atomic read-modify-write on plain integer storage, so the same
+// arrays serve both the single-threaded and the concurrent code paths.
+
+// Returns the previous value of *word
+inline uint64_t atomic_or_relaxed(uint64_t* word, uint64_t mask) {
+#if defined(_MSC_VER) && !defined(__clang__)
+    return static_cast<uint64_t>(_InterlockedOr64(reinterpret_cast<volatile long long*>(word),
+                                                  static_cast<long long>(mask)));
+#else
+    return __atomic_fetch_or(word, mask, __ATOMIC_RELAXED);
+#endif
+}
+
+inline uint32_t atomic_or_relaxed(uint32_t* word, uint32_t mask) {
+#if defined(_MSC_VER) && !defined(__clang__)
+    return static_cast<uint32_t>(_InterlockedOr(reinterpret_cast<volatile long*>(word),
+                                                static_cast<long>(mask)));
+#else
+    return __atomic_fetch_or(word, mask, __ATOMIC_RELAXED);
+#endif
+}
+
+inline void atomic_add_relaxed(uint64_t* p, uint64_t value) {
+#if defined(_MSC_VER) && !defined(__clang__)
+    _InterlockedExchangeAdd64(reinterpret_cast<volatile long long*>(p),
+                              static_cast<long long>(value));
+#else
+    __atomic_fetch_add(p, value, __ATOMIC_RELAXED);
+#endif
+}
+
+inline uint64_t atomic_load_relaxed(const uint64_t* p) {
+#if defined(_MSC_VER) && !defined(__clang__)
+    return *reinterpret_cast<const volatile uint64_t*>(p);
+#else
+    return __atomic_load_n(p, __ATOMIC_RELAXED);
+#endif
+}
+
+inline uint32_t atomic_load_relaxed(const uint32_t* p) {
+#if defined(_MSC_VER) && !defined(__clang__)
+    return *reinterpret_cast<const volatile uint32_t*>(p);
+#else
+    return __atomic_load_n(p, __ATOMIC_RELAXED);
+#endif
+}
+
+// On failure `expected` is refreshed with the current value
+inline bool atomic_cas_relaxed(uint32_t* p, uint32_t& expected, uint32_t desired) {
+#if defined(_MSC_VER) && !defined(__clang__)
+    const long prev = _InterlockedCompareExchange(reinterpret_cast<volatile long*>(p),
+                                                  static_cast<long>(desired),
+                                                  static_cast<long>(expected));
+    if (static_cast<uint32_t>(prev) == expected) return true;
+    expected = static_cast<uint32_t>(prev);
+    return false;
+#else
+    return __atomic_compare_exchange_n(p, &expected, desired, true,
+                                       __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+#endif
+}
+
+#endif // BLOOM_ATOMICS_H
@@ -0,0 +1,328 @@
+#include "batch_hash.h"
+#include <algorithm>
+#include <cstring>
+
+#if (defined(__GNUC__) || defined(__clang__)) && defined(__x86_64__)
+#define BATCH_HASH_HAVE_SIMD 1
+#include <immintrin.h>
+#endif
+
+namespace {
+
+using namespace xxh64_constexpr; // PRIME1..PRIME5
+
+constexpr size_t MAX_LANES = 16;
+constexpr size_t SHORT_KEY_BYTES = 32; // XXH64 takes its stripe loop from here
+// Below this, staging the group and the byte rounds' extra vector multiplies
+// cost more than hashing key by key (measured on AVX2 and AVX-512)
+constexpr size_t MIN_LANE_BYTES = 11;
+
+static_assert(sizeof(KeyHash) == 16, "KeyHash must be two packed words");
+
+// XXH64 reads a key shorter than 32 bytes as len / 8 words, then one
+// 4-byte word if len % 8 >= 4, then the remaining len % 4 bytes, each read
+// feeding one round. A group's reads are staged slot by slot, lane-major
+// within a slot, so the lane kernels use plain vector loads.
+constexpr size_t MAX_SLOTS = 3 + 1 + 3;
+
+inline void stage_key(const char *p, size_t len, uint64_t *slots, size_t stride) {
+  size_t off = 0;
+  for (; off + 8 <= len; off += 8, slots += stride) *slots = short_key_detail::load64(p + off);
+  if (off + 4 <= len) {
+    *slots = short_key_detail::load32(p + off);
+    slots += stride;
+    off += 4;
+  }
+  for (; off < len; ++off, slots += stride) *slots = static_cast<unsigned char>(p[off]);
+}
+
+// Lane kernels: hash_key of `lanes` keys of one length `len` < 32 from their
+// staged slots, written to h1[0..lanes) and h2[0..lanes)
+using GroupFn = void (*)(const uint64_t *slots, size_t len, uint64_t *h1, uint64_t *h2);
+// hash_u64_keys over a whole multiple of the lane count
+using U64Fn = void (*)(const uint64_t *values, size_t n, KeyHash *out);
+
+inline KeyHash scalar_u64_hash(uint64_t value) {
+  char bytes[8];
+  for (unsigned b = 0; b < 8; ++b) bytes[b] = static_cast<char>(value >> (8 * b));
+  return hash_key(bytes, 8);
+}
+
+#ifdef BATCH_HASH_HAVE_SIMD
+
+// GCC 12's AVX-512 intrinsics pass _mm512_undefined_epi32() through their
+// unused mask operand, which -Wuninitialized reports at every call site
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+
+// ------- AVX-512: native 64-bit multiply and rotate ---------------------
+
+#define BATCH_HASH_AVX512 __attribute__((target("avx512f,avx512dq")))
+
+BATCH_HASH_AVX512 inline __m512i mul512(__m512i a, uint64_t b) {
+  return _mm512_mullo_epi64(a, _mm512_set1_epi64(static_cast<long long>(b)));
+}
+
+BATCH_HASH_AVX512 inline __m512i add512(__m512i a, uint64_t b) {
+  return _mm512_add_epi64(a, _mm512_set1_epi64(static_cast<long long>(b)));
+}
+
+template <int R>
+BATCH_HASH_AVX512 inline __m512i rol512(__m512i x) {
+  return _mm512_rol_epi64(x, R);
+}
+
+BATCH_HASH_AVX512 inline __m512i avalanche512(__m512i h) {
+  h = mul512(_mm512_xor_si512(h, _mm512_srli_epi64(h, 33)), PRIME2);
+  h = mul512(_mm512_xor_si512(h, _mm512_srli_epi64(h, 29)), PRIME3);
+  return _mm512_xor_si512(h, _mm512_srli_epi64(h, 32));
+}
+
+// One 8-byte round of XXH64's tail for both seeds; the input half is shared
+BATCH_HASH_AVX512 inline void round8_512(__m512i &a, __m512i &b, __m512i k) {
+  k = mul512(rol512<31>(mul512(k, PRIME2)), PRIME1);
+  a = add512(mul512(rol512<27>(_mm512_xor_si512(a, k)), PRIME1), PRIME4);
+  b = add512(mul512(rol512<27>(_mm512_xor_si512(b, k)), PRIME1), PRIME4);
+}
+
+// Keys go two vectors at a time, so four independent multiply chains
+// (two seeds each) hide the multiply latency
+BATCH_HASH_AVX512 void group_avx512(const uint64_t *slots, size_t len, uint64_t *h1,
+                                    uint64_t *h2) {
+  __m512i a[2], b[2];
+  for (int v = 0; v < 2; ++v) {
+    a[v] = _mm512_set1_epi64(static_cast<long long>(HASH_SEED1 + PRIME5 + len));
+    b[v] = _mm512_set1_epi64(static_cast<long long>(HASH_SEED2 + PRIME5 + len));
+  }
+  size_t off = 0;
+  for (; off + 8 <= len; off += 8, slots += 16) {
+    for (int v = 0; v < 2; ++v) round8_512(a[v], b[v], _mm512_loadu_si512(slots + 8 * v));
+  }
+  if (off + 4 <= len) {
+    for (int v = 0; v < 2; ++v) {
+      const __m512i k = mul512(_mm512_loadu_si512(slots + 8 * v), PRIME1);
+      a[v] = add512(mul512(rol512<23>(_mm512_xor_si512(a[v], k)), PRIME2), PRIME3);
+      b[v] = add512(mul512(rol512<23>(_mm512_xor_si512(b[v], k)), PRIME2), PRIME3);
+    }
+    slots += 16;
+    off += 4;
+  }
+  for (; off < len; ++off, slots += 16) {
+    for (int v = 0; v < 2; ++v) {
+      const __m512i k = mul512(_mm512_loadu_si512(slots + 8 * v), PRIME5);
+      a[v] = mul512(rol512<11>(_mm512_xor_si512(a[v], k)), PRIME1);
+      b[v] = mul512(rol512<11>(_mm512_xor_si512(b[v], k)), PRIME1);
+    }
+  }
+  for (int v = 0; v < 2; ++v) {
+    _mm512_storeu_si512(h1 + 8 * v, avalanche512(a[v]));
+    _mm512_storeu_si512(h2 + 8 * v, avalanche512(b[v]));
+  }
+}
+
+// Contiguous values: plain vector loads, and h1/h2 interleaved into KeyHash
+// order with two permutes
+BATCH_HASH_AVX512 void u64_avx512(const uint64_t *values, size_t n, KeyHash *out) {
+  const __m512i lo_pairs = _mm512_set_epi64(11, 3, 10, 2, 9, 1, 8, 0);
+  const __m512i hi_pairs = _mm512_set_epi64(15, 7, 14, 6, 13, 5, 12, 4);
+  for (size_t i = 0; i < n; i += 8) {
+    __m512i a = _mm512_set1_epi64(static_cast<long long>(HASH_SEED1 + PRIME5 + 8));
+    __m512i b = _mm512_set1_epi64(static_cast<long long>(HASH_SEED2 + PRIME5 + 8));
+    round8_512(a, b, _mm512_loadu_si512(values + i));
+    a = avalanche512(a);
+    b = avalanche512(b);
+    uint64_t *dst = reinterpret_cast<uint64_t *>(out + i);
+    _mm512_storeu_si512(dst, _mm512_permutex2var_epi64(a, lo_pairs, b));
+    _mm512_storeu_si512(dst + 8, _mm512_permutex2var_epi64(a, hi_pairs, b));
+  }
+}
+
+// ------- AVX2: 64-bit multiply from three 32x32 products ----------------
+
+#define BATCH_HASH_AVX2 __attribute__((target("avx2")))
+
+BATCH_HASH_AVX2 inline __m256i mul256(__m256i a, uint64_t b) {
+  const __m256i lo = _mm256_set1_epi64x(static_cast<long long>(b & 0xFFFFFFFFULL));
+  const __m256i hi = _mm256_set1_epi64x(static_cast<long long>(b >> 32));
+  const __m256i cross = _mm256_add_epi64(_mm256_mul_epu32(_mm256_srli_epi64(a, 32), lo),
+                                         _mm256_mul_epu32(a, hi));
+  return _mm256_add_epi64(_mm256_mul_epu32(a, lo), _mm256_slli_epi64(cross, 32));
+}
+
+BATCH_HASH_AVX2 inline __m256i load256(const uint64_t *p) {
+  return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+}
+
+BATCH_HASH_AVX2 inline __m256i add256(__m256i a, uint64_t b) {
+  return _mm256_add_epi64(a, _mm256_set1_epi64x(static_cast<long long>(b)));
+}
+
+template <int R>
+BATCH_HASH_AVX2 inline __m256i rol256(__m256i x) {
+  return _mm256_or_si256(_mm256_slli_epi64(x, R), _mm256_srli_epi64(x, 64 - R));
+}
+
+BATCH_HASH_AVX2 inline __m256i avalanche256(__m256i h) {
+  h = mul256(_mm256_xor_si256(h, _mm256_srli_epi64(h, 33)), PRIME2);
+  h = mul256(_mm256_xor_si256(h, _mm256_srli_epi64(h, 29)), PRIME3);
+  return _mm256_xor_si256(h, _mm256_srli_epi64(h, 32));
+}
+
+BATCH_HASH_AVX2 inline void round8_256(__m256i &a, __m256i &b, __m256i k) {
+  k = mul256(rol256<31>(mul256(k, PRIME2)), PRIME1);
+  a = add256(mul256(rol256<27>(_mm256_xor_si256(a, k)), PRIME1), PRIME4);
+  b = add256(mul256(rol256<27>(_mm256_xor_si256(b, k)), PRIME1), PRIME4);
+}
+
+BATCH_HASH_AVX2 void group_avx2(const uint64_t *slots, size_t len, uint64_t *h1,
+                                uint64_t *h2) {
+  __m256i a[2], b[2];
+  for (int v = 0; v < 2; ++v) {
+    a[v] = _mm256_set1_epi64x(static_cast<long long>(HASH_SEED1 + PRIME5 + len));
+    b[v] = _mm256_set1_epi64x(static_cast<long long>(HASH_SEED2 + PRIME5 + len));
+  }
+  size_t off = 0;
+  for (; off + 8 <= len; off += 8, slots += 8) {
+    for (int v = 0; v < 2; ++v) round8_256(a[v], b[v], load256(slots + 4 * v));
+  }
+  if (off + 4 <= len) {
+    for (int v = 0; v < 2; ++v) {
+      const __m256i k = mul256(load256(slots + 4 * v), PRIME1);
+      a[v] = add256(mul256(rol256<23>(_mm256_xor_si256(a[v], k)), PRIME2), PRIME3);
+      b[v] = add256(mul256(rol256<23>(_mm256_xor_si256(b[v], k)), PRIME2), PRIME3);
+    }
+    slots += 8;
+    off += 4;
+  }
+  for (; off < len; ++off, slots += 8) {
+    for (int v = 0; v < 2; ++v) {
+      const __m256i k = mul256(load256(slots + 4 * v), PRIME5);
+      a[v] = mul256(rol256<11>(_mm256_xor_si256(a[v], k)), PRIME1);
+      b[v] = mul256(rol256<11>(_mm256_xor_si256(b[v], k)), PRIME1);
+    }
+  }
+  for (int v = 0; v < 2; ++v) {
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(h1 + 4 * v), avalanche256(a[v]));
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(h2 + 4 * v), avalanche256(b[v]));
+  }
+}
+
+BATCH_HASH_AVX2 void u64_avx2(const uint64_t *values, size_t n, KeyHash *out) {
+  for (size_t i = 0; i < n; i += 4) {
+    __m256i a = _mm256_set1_epi64x(static_cast<long long>(HASH_SEED1 + PRIME5 + 8));
+    __m256i b = _mm256_set1_epi64x(static_cast<long long>(HASH_SEED2 + PRIME5 + 8));
+    round8_256(a, b, _mm256_loadu_si256(reinterpret_cast<const __m256i *>(values + i)));
+    a = avalanche256(a);
+    b = avalanche256(b);
+    // [a0 b0 a2 b2] and [a1 b1 a3 b3] -> [a0 b0 a1 b1] and [a2 b2 a3 b3]
+    const __m256i even = _mm256_unpacklo_epi64(a, b);
+    const __m256i odd = _mm256_unpackhi_epi64(a, b);
+    __m256i *dst = reinterpret_cast<__m256i *>(out + i);
+    _mm256_storeu_si256(dst, _mm256_permute2x128_si256(even, odd, 0x20));
+    _mm256_storeu_si256(dst + 1, _mm256_permute2x128_si256(even, odd, 0x31));
+  }
+}
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+#endif // BATCH_HASH_HAVE_SIMD
+
+struct Kernels {
+  size_t lanes = 1;
+  GroupFn group = nullptr;
+  U64Fn u64 = nullptr;
+};
+
+Kernels select_kernels() {
+#ifdef BATCH_HASH_HAVE_SIMD
+  if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512dq")) {
+    return {16, group_avx512, u64_avx512};
+  }
+  if (__builtin_cpu_supports("avx2")) return {8, group_avx2, u64_avx2};
+#endif
+  return {};
+}
+
+const Kernels &kernels() {
+  static const Kernels k = select_kernels();
+  return k;
+}
+
+// Keys order[0..count) of the block, all of length len
+void hash_same_length(const Kernels &k, const std::string_view *keys, const uint16_t *order,
+                      size_t count, size_t len, KeyHash *out) {
+  uint64_t slots[MAX_SLOTS * MAX_LANES];
+  uint64_t h1[MAX_LANES], h2[MAX_LANES];
+  for (size_t g = 0; g < count; g += k.lanes) {
+    const size_t live = std::min(k.lanes, count - g);
+    // A mostly empty group costs more than hashing its keys one by one
+    if (live * 2 < k.lanes) {
+      for (size_t j = 0; j < live; ++j) {
+        const std::string_view key = keys[order[g + j]];
+        out[order[g + j]] = hash_key(key.data(), key.size());
+      }
+      continue;
+    }
+    // Missing lanes repeat the group's first key
+    for (size_t j = 0; j < k.lanes; ++j) {
+      stage_key(keys[order[g + (j < live ? j : 0)]].data(), len, slots + j, k.lanes);
+    }
+    k.group(slots, len, h1, h2);
+    for (size_t j = 0; j < live; ++j) out[order[g + j]] = {h1[j], h2[j]};
+  }
+}
+
+} // namespace
+
+size_t hash_lanes() { return kernels().lanes; }
+
+void hash_keys(const std::string_view *keys, size_t n, KeyHash *out) {
+  const Kernels &k = kernels();
+  if (k.lanes == 1) {
+    for (size_t i = 0; i < n; ++i) out[i] = hash_key(keys[i].data(), keys[i].size());
+    return;
+  }
+  for (size_t base = 0; base < n; base += HASH_BLOCK) {
+    const size_t m = std::min(HASH_BLOCK, n - base);
+    const std::string_view *block = keys + base;
+    KeyHash *block_out = out + base;
+
+    // Counting sort of the lane-sized keys by length; the rest are hashed now
+    uint16_t count[SHORT_KEY_BYTES] = {};
+    size_t lane_keys = 0;
+    for (size_t j = 0; j < m; ++j) {
+      const size_t len = block[j].size();
+      if (len >= MIN_LANE_BYTES && len < SHORT_KEY_BYTES) {
+        ++count[len];
+        ++lane_keys;
+      } else {
+        block_out[j] = hash_key(block[j].data(), len);
+      }
+    }
+    if (lane_keys == 0) continue;
+    uint16_t start[SHORT_KEY_BYTES + 1] = {};
+    for (size_t len = 0; len < SHORT_KEY_BYTES; ++len) start[len + 1] = start[len] + count[len];
+    uint16_t order[HASH_BLOCK];
+    uint16_t fill[SHORT_KEY_BYTES];
+    std::memcpy(fill, start, sizeof(fill));
+    for (size_t j = 0; j < m; ++j) {
+      const size_t len = block[j].size();
+      if (len >= MIN_LANE_BYTES && len < SHORT_KEY_BYTES) order[fill[len]++] = static_cast<uint16_t>(j);
+    }
+    for (size_t len = MIN_LANE_BYTES; len < SHORT_KEY_BYTES; ++len) {
+      if (count[len]) hash_same_length(k, block, order + start[len], count[len], len, block_out);
+    }
+  }
+}
+
+void hash_u64_keys(const uint64_t *values, size_t n, KeyHash *out) {
+  const Kernels &k = kernels();
+  const size_t whole = k.lanes == 1 ? 0 : n / k.lanes * k.lanes;
+  if (whole) k.u64(values, whole, out);
+  for (size_t i = whole; i < n; ++i) out[i] = scalar_u64_hash(values[i]);
+}
@@ -0,0 +1,71 @@
+#ifndef BATCH_HASH_H
+#define BATCH_HASH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <type_traits>
+
+#include "bloom_engine.h"
+#include "hash_schemes.h"
+#include "hashing.h"
+#include "key_batch.h"
+
+// hash_key of many keys at once, for the batch paths. Keys of 11 to 31
+// bytes are grouped by length and hashed across SIMD lanes, sixteen keys per
+// AVX-512 group or eight per AVX2 group. Each group runs XXH64's input
+// rounds once for both seeds. Results equal hash_key's bit for bit. Other
+// lengths, short leftover groups and hosts without AVX2 use hash_key.
+
+// Keys sorted by length per block of this many
+inline constexpr size_t HASH_BLOCK = 256;
+
+void hash_keys(const std::string_view* keys, size_t n, KeyHash* out);
+// 8-byte keys given as integers, hashed as their 8 little-endian bytes (the
+// integer key encoding of ArrowColumn and StridedColumn)
+void hash_u64_keys(const uint64_t* values, size_t n, KeyHash* out);
+// Keys per SIMD group on this host; 1 means scalar hash_key
+size_t hash_lanes();
+
+// Base hashes under `scheme` of rows [start, start + n) of a column type
+// (see semi_join.h). Null rows are hashed too, and their hashes are unused.
+template <typename Column>
+void hash_column_rows(HashScheme scheme, const Column& column, size_t start, size_t n,
+                      KeyHash* out) {
+    char scratch[8];
+    if (scheme != HashScheme::Xxh64) {
+        for (size_t j = 0; j < n; ++j) {
+            const std::string_view k = column.key(start + j, scratch);
+            out[j] = hash_with_scheme(scheme, k.data(), k.size());
+        }
+        return;
+    }
+    for (size_t base = 0; base < n; base += HASH_BLOCK) {
+        const size_t m = n - base < HASH_BLOCK ? n - base : HASH_BLOCK;
+        if (column.is_integer()) {
+            uint64_t values[HASH_BLOCK];
+            for (size_t j = 0; j < m; ++j) values[j] = column.integer(start + base + j);
+            hash_u64_keys(values, m, out + base);
+        } else {
+            std::string_view views[HASH_BLOCK];
+            for (size_t j = 0; j < m; ++j) views[j] = column.key(start + base + j, scratch);
+            hash_keys(views, m, out + base);
+        }
+    }
+}
+
+// Base hashes under a hash policy (bloom_engine.h) of keys [start, start + n),
+// n <= HASH_BLOCK; XXH64 hashes the block across SIMD lanes, the other
+// schemes key by key
+template <class Hash>
+void hash_batch(const KeyBatch& keys, size_t start, size_t n, KeyHash* out) {
+    if constexpr (std::is_same_v<Hash, Xxh64PairHash>) {
+        std::string_view views[HASH_BLOCK];
+        for (size_t j = 0; j < n; ++j) views[j] = keys[start + j];
+        hash_keys(views, n, out);
+    } else {
+        for (size_t j = 0; j < n; ++j) out[j] = Hash::hash(keys.data(start + j), keys.length(start + j));
+    }
+}
+
+#endif // BATCH_HASH_H
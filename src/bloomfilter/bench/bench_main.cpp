@@ -0,0 +1,249 @@
+// bloomfilter-bench: add / query / batch microbenchmarks with per-operation
+// hardware counters (see perf_counters.h)
+
+#include "batch_hash.h"
+#include "blocked_bloom_filter.h"
+#include "bloom_filter.h"
+#include "filter_array.h"
+#include "hash_schemes.h"
+#include "key_batch.h"
+#include "perf_counters.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct Options {
+  size_t n = 1000000;
+  double fpr = 0.01;
+  size_t threads = 0;
+  int repeat = 3;
+  std::string filter; // run benchmarks whose name contains this
+  bool csv = false;
+};
+
+struct Benchmark {
+  std::string name;
+  // Untimed preparation, then the timed body; returns operations performed
+  std::function<void()> setup;
+  std::function<size_t()> run;
+};
+
+struct Result {
+  double ns_per_op;
+  PerfCounters::Values per_op;
+};
+
+volatile size_t sink; // keeps query results alive
+
+KeyBatch make_keys(size_t n, const char *prefix) {
+  KeyBatch keys;
+  keys.reserve(n, n * 12);
+  for (size_t i = 0; i < n; ++i) keys.push_back(prefix + std::to_string(i));
+  return keys;
+}
+
+// Best (fastest) of `repeat` runs
+Result measure(const Benchmark &b, PerfCounters &counters, int repeat) {
+  Result best{INFINITY, {}};
+  for (int r = 0; r < repeat; ++r) {
+    if (b.setup) b.setup();
+    counters.start();
+    const auto t0 = std::chrono::steady_clock::now();
+    const size_t ops = b.run();
+    const auto t1 = std::chrono::steady_clock::now();
+    counters.stop();
+    const double ns = std::chrono::duration<double, std::nano>(t1 - t0).count() / ops;
+    if (ns < best.ns_per_op) {
+      best.ns_per_op = ns;
+      best.per_op = counters.read();
+      for (double &v : best.per_op) v /= static_cast<double>(ops);
+    }
+  }
+  return best;
+}
+
+void print_header(const Options &opt) {
+  if (opt.csv) {
+    std::printf("benchmark,ns_per_op");
+    for (int e = 0; e < PerfCounters::NUM_EVENTS; ++e) {
+      std::printf(",%s", PerfCounters::name(static_cast<PerfCounters::Event>(e)));
+    }
+    std::printf(",ipc\n");
+    return;
+  }
+  std::printf("%-28s %9s", "benchmark (per op)", "ns");
+  for (int e = 0; e < PerfCounters::NUM_EVENTS; ++e) {
+    std::printf(" %13s", PerfCounters::name(static_cast<PerfCounters::Event>(e)));
+  }
+  std::printf(" %6s\n", "IPC");
+}
+
+void print_row(const Options &opt, const std::string &name, const Result &r) {
+  const double ipc = r.per_op[PerfCounters::INSTRUCTIONS] / r.per_op[PerfCounters::CYCLES];
+  if (opt.csv) {
+    std::printf("%s,%.3f", name.c_str(), r.ns_per_op);
+    for (double v : r.per_op) std::isnan(v) ? std::printf(",") : std::printf(",%.4f", v);
+    std::isnan(ipc) ? std::printf(",\n") : std::printf(",%.3f\n", ipc);
+    return;
+  }
+  std::printf("%-28s %9.2f", name.c_str(), r.ns_per_op);
+  for (double v : r.per_op) std::isnan(v) ? std::printf(" %13s", "-") : std::printf(" %13.3f", v);
+  std::isnan(ipc) ? std::printf(" %6s\n", "-") : std::printf(" %6.2f\n", ipc);
+}
+
+bool parse_options(int argc, char **argv, Options &opt) {
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    const bool has_value = i + 1 < argc;
+    if (arg == "--n" && has_value) {
+      opt.n = std::strtoull(argv[++i], nullptr, 10);
+    } else if (arg == "--fpr" && has_value) {
+      opt.fpr = std::atof(argv[++i]);
+    } else if (arg == "--threads" && has_value) {
+      opt.threads = std::strtoull(argv[++i], nullptr, 10);
+    } else if (arg == "--repeat" && has_value) {
+      opt.repeat = std::max(1, std::atoi(argv[++i]));
+    } else if (arg == "--filter" && has_value) {
+      opt.filter = argv[++i];
+    } else if (arg == "--csv") {
+      opt.csv = true;
+    } else {
+      std::fprintf(stderr,
+                   "usage: %s [--n KEYS] [--fpr P] [--threads N] [--repeat R] "
+                   "[--filter SUBSTR] [--csv]\n",
+                   argv[0]);
+      return false;
+    }
+  }
+  return opt.n > 0 && opt.fpr > 0 && opt.fpr < 1;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  Options opt;
+  if (!parse_options(argc, argv, opt)) return 2;
+
+  // Open counters before the thread pool starts so its workers inherit them
+  PerfCounters counters;
+  if (!counters.status().empty()) {
+    std::fprintf(stderr, "note: some hardware counters unavailable: %s\n",
+                 counters.status().c_str());
+  }
+
+  const KeyBatch present = make_keys(opt.n, "key:");
+  const KeyBatch absent = make_keys(opt.n, "miss:");
+  std::vector<uint8_t> out(opt.n);
+
+  BloomFilter standard(opt.n, opt.fpr);
+  BlockedBloomFilter blocked(opt.n, opt.fpr);
+  auto reset_standard = [&] { standard = BloomFilter(opt.n, opt.fpr); };
+  auto reset_blocked = [&] { blocked = BlockedBloomFilter(opt.n, opt.fpr); };
+  auto fill_standard = [&] {
+    for (size_t i = 0; i < present.size(); ++i) standard.add(present.data(i), present.length(i));
+  };
+  auto fill_blocked = [&] {
+    for (size_t i = 0; i < present.size(); ++i) blocked.add(present.data(i), present.length(i));
+  };
+  auto hash_all = [&](KeyHash (*hash)(const char *, size_t)) {
+    uint64_t acc = 0;
+    for (size_t i = 0; i < present.size(); ++i) {
+      const KeyHash h = hash(present.data(i), present.length(i));
+      acc += h.h1 ^ h.h2;
+    }
+    sink = acc;
+    return present.size();
+  };
+  // hash_keys and hash_u64_keys, HASH_BLOCK keys at a time
+  auto hash_blocks = [&](size_t n, auto hash_block) {
+    KeyHash hashes[HASH_BLOCK];
+    uint64_t acc = 0;
+    for (size_t start = 0; start < n; start += HASH_BLOCK) {
+      const size_t m = std::min(HASH_BLOCK, n - start);
+      hash_block(start, m, hashes);
+      for (size_t j = 0; j < m; ++j) acc += hashes[j].h1 ^ hashes[j].h2;
+    }
+    sink = acc;
+    return n;
+  };
+  std::vector<uint64_t> ints(present.size());
+  for (size_t i = 0; i < ints.size(); ++i) ints[i] = i * 0x9E3779B97F4A7C15ULL;
+  // One 512-bit blocked filter per two keys, keys spread over them at random
+  const size_t num_arrays = std::max<size_t>(1, opt.n / 2);
+  FilterArray array(num_arrays, 512, 7, FilterLayout::Blocked);
+  auto reset_array = [&] { array = FilterArray(num_arrays, 512, 7, FilterLayout::Blocked); };
+  std::vector<uint64_t> array_ids(present.size());
+  for (size_t i = 0; i < array_ids.size(); ++i) array_ids[i] = ints[i] % num_arrays;
+  auto query = [](const auto &filter, const KeyBatch &keys) {
+    size_t hits = 0;
+    for (size_t i = 0; i < keys.size(); ++i) hits += filter.might_contain(keys.data(i), keys.length(i));
+    sink = hits;
+    return keys.size();
+  };
+
+  const std::vector<Benchmark> benchmarks = {
+      {"standard/add", reset_standard, [&] { fill_standard(); return present.size(); }},
+      {"standard/query-hit", [&] { reset_standard(); fill_standard(); },
+       [&] { return query(standard, present); }},
+      {"standard/query-miss", [&] { reset_standard(); fill_standard(); }, [&] { return query(standard, absent); }},
+      {"hash/xxh64-pair", nullptr, [&] { return hash_all(hash_key); }},
+      {"hash/short_key", nullptr, [&] { return hash_all(short_key_hash); }},
+      {"hash/crc32c", nullptr, [&] { return hash_all(crc32c_hash); }},
+      {"hash/xxh64-lanes", nullptr, [&] {
+         return hash_blocks(present.size(), [&](size_t start, size_t m, KeyHash *out) {
+           std::string_view views[HASH_BLOCK];
+           for (size_t j = 0; j < m; ++j) views[j] = {present.data(start + j), present.length(start + j)};
+           hash_keys(views, m, out);
+         });
+       }},
+      {"hash/xxh64-u64-lanes", nullptr, [&] {
+         return hash_blocks(ints.size(), [&](size_t start, size_t m, KeyHash *out) {
+           hash_u64_keys(ints.data() + start, m, out);
+         });
+       }},
+      {"standard/add_many", reset_standard, [&] {
+         standard.add_many(present, opt.threads);
+         return present.size();
+       }},
+      {"standard/add_many_partitioned", reset_standard, [&] {
+         standard.add_many_partitioned(present, opt.threads);
+         return present.size();
+       }},
+      {"standard/contains_many", [&] { reset_standard(); fill_standard(); }, [&] {
+         standard.might_contain_many(absent, out.data(), opt.threads);
+         return absent.size();
+       }},
+      {"array/add_many", reset_array, [&] {
+         array.add_many(array_ids.data(), present, opt.threads);
+         return present.size();
+       }},
+      {"array/contains_many", [&] { reset_array(); array.add_many(array_ids.data(), present, 1); }, [&] {
+         array.might_contain_many(array_ids.data(), absent, out.data(), opt.threads);
+         return absent.size();
+       }},
+      {"blocked/add", reset_blocked, [&] { fill_blocked(); return present.size(); }},
+      {"blocked/query-hit", [&] { reset_blocked(); fill_blocked(); },
+       [&] { return query(blocked, present); }},
+      {"blocked/query-miss", [&] { reset_blocked(); fill_blocked(); }, [&] { return query(blocked, absent); }},
+  };
+
+  std::fprintf(stderr, "n=%zu fpr=%g threads=%zu repeat=%d\n", opt.n, opt.fpr,
+               resolve_threads(opt.threads), opt.repeat);
+  print_header(opt);
+  for (const Benchmark &b : benchmarks) {
+    if (!opt.filter.empty() && b.name.find(opt.filter) == std::string::npos) continue;
+    print_row(opt, b.name, measure(b, counters, opt.repeat));
+    std::fflush(stdout);
+  }
+  return 0;
+}
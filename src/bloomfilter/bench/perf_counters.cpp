@@ -0,0 +1,128 @@
+#include "perf_counters.h"
+
+#include <limits>
+
+#ifdef __linux__
+#include <cerrno>
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+constexpr double NaN = std::numeric_limits<double>::quiet_NaN();
+
+#ifdef __linux__
+struct EventSpec {
+  uint32_t type;
+  uint64_t config;
+};
+
+constexpr uint64_t cache_event(uint64_t cache, uint64_t op, uint64_t result) {
+  return cache | (op << 8) | (result << 16);
+}
+
+const EventSpec SPECS[PerfCounters::NUM_EVENTS] = {
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {PERF_TYPE_HW_CACHE, cache_event(PERF_COUNT_HW_CACHE_L1D, PERF_COUNT_HW_CACHE_OP_READ,
+                                     PERF_COUNT_HW_CACHE_RESULT_MISS)},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+    {PERF_TYPE_HW_CACHE, cache_event(PERF_COUNT_HW_CACHE_DTLB, PERF_COUNT_HW_CACHE_OP_READ,
+                                     PERF_COUNT_HW_CACHE_RESULT_MISS)},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+};
+
+int open_event(const EventSpec &spec) {
+  perf_event_attr attr;
+  std::memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = spec.type;
+  attr.config = spec.config;
+  attr.disabled = 1;
+  attr.inherit = 1;        // include pool threads started after this
+  attr.exclude_kernel = 1; // allowed at perf_event_paranoid <= 2
+  attr.exclude_hv = 1;
+  attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+  return static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, -1, PERF_FLAG_FD_CLOEXEC));
+}
+#endif
+
+} // namespace
+
+PerfCounters::PerfCounters() {
+  fds_.fill(-1);
+#ifdef __linux__
+  for (int e = 0; e < NUM_EVENTS; ++e) {
+    fds_[e] = open_event(SPECS[e]);
+    if (fds_[e] < 0 && status_.empty()) {
+      status_ = std::string(name(static_cast<Event>(e))) + ": " + std::strerror(errno);
+      if (errno == EACCES || errno == EPERM) {
+        status_ += " (check /proc/sys/kernel/perf_event_paranoid)";
+      } else if (errno == ENOENT || errno == EOPNOTSUPP) {
+        status_ += " (event not supported on this CPU/VM)";
+      }
+    }
+  }
+#else
+  status_ = "perf_event_open is Linux-only";
+#endif
+}
+
+PerfCounters::~PerfCounters() {
+#ifdef __linux__
+  for (int fd : fds_) {
+    if (fd >= 0) close(fd);
+  }
+#endif
+}
+
+bool PerfCounters::any_available() const {
+  for (int fd : fds_) {
+    if (fd >= 0) return true;
+  }
+  return false;
+}
+
+void PerfCounters::start() {
+#ifdef __linux__
+  for (int fd : fds_) {
+    if (fd < 0) continue;
+    ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+    ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+  }
+#endif
+}
+
+void PerfCounters::stop() {
+#ifdef __linux__
+  for (int fd : fds_) {
+    if (fd >= 0) ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+  }
+#endif
+}
+
+PerfCounters::Values PerfCounters::read() const {
+  Values values;
+  values.fill(NaN);
+#ifdef __linux__
+  for (int e = 0; e < NUM_EVENTS; ++e) {
+    if (fds_[e] < 0) continue;
+    uint64_t buf[3]; // value, time_enabled, time_running
+    if (::read(fds_[e], buf, sizeof(buf)) != static_cast<ssize_t>(sizeof(buf))) continue;
+    if (buf[2] == 0) continue; // never scheduled
+    values[e] = static_cast<double>(buf[0]) * static_cast<double>(buf[1]) /
+                static_cast<double>(buf[2]);
+  }
+#endif
+  return values;
+}
+
+const char *PerfCounters::name(Event e) {
+  static const char *const NAMES[NUM_EVENTS] = {
+      "cycles", "instructions", "L1d-misses", "LLC-misses", "dTLB-misses", "branch-misses"};
+  return NAMES[e];
+}
@@ -0,0 +1,49 @@
+#ifndef BLOOM_BENCH_PERF_COUNTERS_H
+#define BLOOM_BENCH_PERF_COUNTERS_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Hardware counters for the calling thread and any threads it creates
+// afterwards (perf_event_open with inherit). Each event is opened on its own,
+// so a host that lacks, say, dTLB events still reports the rest. Events that
+// could not be opened read as NaN. Off Linux nothing is ever available.
+class PerfCounters {
+public:
+    enum Event {
+        CYCLES,
+        INSTRUCTIONS,
+        L1D_MISSES,
+        LLC_MISSES,
+        DTLB_MISSES,
+        BRANCH_MISSES,
+        NUM_EVENTS
+    };
+    using Values = std::array<double, NUM_EVENTS>;
+
+    PerfCounters();
+    ~PerfCounters();
+
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    bool available(Event e) const { return fds_[e] >= 0; }
+    bool any_available() const;
+    // Why events are missing (first open error), empty if all opened
+    const std::string& status() const { return status_; }
+
+    void start(); // reset and enable
+    void stop();  // disable
+    // Counts since start(), scaled up when the kernel multiplexed a counter
+    Values read() const;
+
+    static const char* name(Event e);
+
+private:
+    std::array<int, NUM_EVENTS> fds_;
+    std::string status_;
+};
+
+#endif // BLOOM_BENCH_PERF_COUNTERS_H
@@ -1,31 +1,431 @@
 #include <pybind11/pybind11.h>
 #include <pybind11/stl.h>
 #include <pybind11/operators.h>
+#include <pybind11/numpy.h>
+#include <cstring>
+#include <exception>
+#include <functional>
+#include <future>
+#include <optional>
+#include "adaptive_bloom_filter.h"
+#include "arrow_column.h"
+#include "blocked_bloom_filter.h"
+#include "block_index.h"
 #include "bloom_filter.h"
+#include "bloomier_filter.h"
+#include "count_min_sketch.h"
+#include "disk_bloom_filter.h"
+#include "filter_array.h"
+#include "filter_merge.h"
+#include "iblt.h"
+#include "key_batch.h"
+#include "metrics.h"
+#include "parquet_bloom_filter.h"
+#include "semi_join.h"
+#include "thread_pool.h"
+#include "tiered_bloom_filter.h"
+#include "tokenizer.h"
 
 #define STRINGIFY(x) #x
 #define MACRO_STRINGIFY(x) STRINGIFY(x)
 
 namespace py = pybind11;
 
+// View a str (as UTF-8) or bytes key without copying
+static std::string_view key_view(py::handle item) {
+    if (py::isinstance<py::str>(item) || py::isinstance<py::bytes>(item)) {
+        return py::cast<std::string_view>(item);
+    }
+    throw py::type_error("Only str or bytes supported");
+}
+
+// str or os.PathLike to a filesystem path
+static std::string fs_path(py::handle path) {
+    return py::module_::import("os").attr("fspath")(path).cast<std::string>();
+}
+
+// Copy an iterable of str/bytes keys into a contiguous arena
+static KeyBatch to_key_batch(py::iterable items) {
+    KeyBatch batch;
+    if (py::isinstance<py::sequence>(items)) {
+        batch.reserve(py::len(items), 0);
+    }
+    for (py::handle item : items) {
+        batch.push_back(key_view(item));
+    }
+    return batch;
+}
+
+// Pull keys from any iterator into bounded KeyBatch chunks and hand each
+// full chunk to insert() on the thread pool. Two arenas alternate, so the next
+// chunk is filled (GIL held) while the previous one is hashed (GIL free).
+static void stream_insert(py::iterable items, size_t chunk_size,
+                          const std::function<void(const KeyBatch &)> &insert) {
+    if (chunk_size == 0) throw py::value_error("chunk_size must be > 0");
+    KeyBatch chunks[2];
+    std::future<void> in_flight;
+    auto wait_in_flight = [&in_flight]() {
+        if (!in_flight.valid()) return;
+        py::gil_scoped_release release;
+        in_flight.get();
+    };
+
+    py::iterator it = py::iter(items);
+    for (size_t current = 0;; current ^= 1) {
+        KeyBatch &chunk = chunks[current];
+        chunk.clear();
+        try {
+            for (; chunk.size() < chunk_size && it != py::iterator::sentinel(); ++it) {
+                chunk.push_back(key_view(*it));
+            }
+        } catch (...) {
+            // The worker may still be reading the other arena
+            if (in_flight.valid()) in_flight.wait();
+            throw;
+        }
+        wait_in_flight();
+        if (chunk.empty()) return;
+        in_flight = ThreadPool::global()->async([&insert, &chunk]() { insert(chunk); });
+    }
+}
+
+static bool python_finalizing() {
+#if PY_VERSION_HEX >= 0x030D0000
+    return Py_IsFinalizing();
+#else
+    return _Py_IsFinalizing();
+#endif
+}
+
+// Python references owned by an in-flight async call; only touched with the GIL
+struct AsyncCall {
+    py::object loop;
+    py::object future;
+    py::object owner; // keeps the native object alive until completion
+};
+
+// The Python exception that `error` raises when it crosses a binding, so it
+// keeps pybind11's type mapping (std::invalid_argument -> ValueError, ...).
+// Needs the GIL.
+static py::object python_exception(std::exception_ptr error) {
+    py::cpp_function raise([error]() { std::rethrow_exception(error); });
+    try {
+        raise();
+    } catch (py::error_already_set &e) {
+        return e.value();
+    }
+    return py::none();
+}
+
+// Run work() on the native thread pool without the GIL and return a future
+// of the running asyncio loop. The worker re-acquires the GIL only to convert
+// the result with finish() and hand it to loop.call_soon_threadsafe. Errors
+// from work() or finish() resolve the future with their exception.
+template <typename Work, typename Finish>
+static py::object run_async(py::object owner, Work work, Finish finish) {
+    py::object loop = py::module_::import("asyncio").attr("get_running_loop")();
+    auto call = std::make_shared<AsyncCall>(AsyncCall{loop, loop.attr("create_future")(),
+                                                      std::move(owner)});
+    py::object future = call->future;
+
+    ThreadPool::global()->submit([call, work, finish]() {
+        using Result = decltype(work());
+        std::optional<Result> result;
+        std::exception_ptr error;
+        try {
+            result.emplace(work());
+        } catch (...) {
+            error = std::current_exception();
+        }
+        if (python_finalizing()) {
+            // Too late to touch Python objects; leak the references
+            call->loop.release();
+            call->future.release();
+            call->owner.release();
+            return;
+        }
+        py::gil_scoped_acquire gil;
+        py::object payload = py::none();
+        py::object exception = py::none();
+        if (!error) {
+            try {
+                payload = finish(std::move(*result));
+            } catch (py::error_already_set &e) {
+                exception = e.value();
+            } catch (...) {
+                error = std::current_exception();
+            }
+        }
+        if (error) exception = python_exception(error);
+        try {
+            py::cpp_function complete([](py::object fut, py::object value, py::object err) {
+                if (fut.attr("done")().cast<bool>()) return; // cancelled meanwhile
+                if (err.is_none()) {
+                    fut.attr("set_result")(value);
+                } else {
+                    fut.attr("set_exception")(err);
+                }
+            });
+            call->loop.attr("call_soon_threadsafe")(complete, call->future, payload, exception);
+        } catch (py::error_already_set &e) {
+            // A closed loop has nobody left to await the result; report anything else
+            if (!call->loop.attr("is_closed")().cast<bool>()) e.discard_as_unraisable("run_async");
+        }
+        call->loop = py::object();
+        call->future = py::object();
+        call->owner = py::object();
+    });
+    return future;
+}
+
+// Arrow arrays borrowed from any producer of the Arrow PyCapsule interface
+// (__arrow_c_array__ for arrays, __arrow_c_stream__ for chunked data)
+class ArrowInput {
+public:
+    explicit ArrowInput(py::handle obj) {
+        if (py::hasattr(obj, "__arrow_c_array__")) {
+            py::tuple capsules = obj.attr("__arrow_c_array__")();
+            keepalive_ = capsules;
+            auto *schema = static_cast<ArrowSchema *>(
+                PyCapsule_GetPointer(capsules[0].ptr(), "arrow_schema"));
+            auto *array = static_cast<ArrowArray *>(
+                PyCapsule_GetPointer(capsules[1].ptr(), "arrow_array"));
+            if (!schema || !array) throw py::error_already_set();
+            columns_.emplace_back(*schema, *array);
+        } else if (py::hasattr(obj, "__arrow_c_stream__")) {
+            py::object capsule = obj.attr("__arrow_c_stream__")();
+            keepalive_ = capsule;
+            auto *stream = static_cast<ArrowArrayStream *>(
+                PyCapsule_GetPointer(capsule.ptr(), "arrow_array_stream"));
+            if (!stream) throw py::error_already_set();
+            if (stream->get_schema(stream, &schema_) != 0) throw_stream_error(stream);
+            for (;;) {
+                ArrowArray chunk{};
+                if (stream->get_next(stream, &chunk) != 0) throw_stream_error(stream);
+                if (chunk.release == nullptr) break; // end of stream
+                chunks_.push_back(chunk);
+            }
+            for (const ArrowArray &chunk : chunks_) {
+                columns_.emplace_back(schema_, chunk);
+            }
+        } else {
+            throw py::type_error(
+                "Expected an Arrow array (object with __arrow_c_array__ or __arrow_c_stream__)");
+        }
+        for (const ArrowColumn &column : columns_) size_ += column.size();
+    }
+
+    ~ArrowInput() {
+        for (ArrowArray &chunk : chunks_) {
+            if (chunk.release) chunk.release(&chunk);
+        }
+        if (schema_.release) schema_.release(&schema_);
+    }
+
+    ArrowInput(const ArrowInput &) = delete;
+    ArrowInput &operator=(const ArrowInput &) = delete;
+
+    const std::vector<ArrowColumn> &columns() const { return columns_; }
+    size_t size() const { return size_; }
+
+private:
+    [[noreturn]] static void throw_stream_error(ArrowArrayStream *stream) {
+        const char *msg = stream->get_last_error ? stream->get_last_error(stream) : nullptr;
+        throw std::runtime_error(std::string("Arrow stream error: ") + (msg ? msg : "unknown"));
+    }
+
+    py::object keepalive_;
+    ArrowSchema schema_{};
+    std::vector<ArrowArray> chunks_; // owned stream chunks
+    std::vector<ArrowColumn> columns_;
+    size_t size_ = 0;
+};
+
+// OR nbits LSB-first bits of src into dst starting at bit dst_offset; dst
+// needs one spare word past the last bit written
+static void append_bits(uint64_t *dst, size_t dst_offset, const uint64_t *src, size_t nbits) {
+    const unsigned shift = dst_offset & 63;
+    uint64_t *out = dst + (dst_offset >> 6);
+    const size_t words = (nbits + 63) / 64;
+    for (size_t w = 0; w < words; ++w) {
+        uint64_t v = src[w];
+        if (w == words - 1 && (nbits & 63)) v &= (1ULL << (nbits & 63)) - 1;
+        out[w] |= v << shift;
+        if (shift) out[w + 1] |= v >> (64 - shift);
+    }
+}
+
+// Boolean column exported through the C Data Interface
+struct BoolArrayData {
+    std::vector<uint64_t> values;
+    std::vector<uint64_t> validity;
+    const void *buffers[2];
+};
+
+static void release_bool_array(ArrowArray *array) {
+    delete static_cast<BoolArrayData *>(array->private_data);
+    array->release = nullptr;
+}
+
+static void release_static_schema(ArrowSchema *schema) { schema->release = nullptr; }
+
+// Exposes one exported array to pyarrow.array() via __arrow_c_array__
+struct ArrowArrayExport {
+    py::object schema_capsule;
+    py::object array_capsule;
+};
+
+static py::object export_bool_array(std::vector<uint64_t> values,
+                                    std::vector<uint64_t> validity,
+                                    size_t length, int64_t null_count) {
+    auto *data = new BoolArrayData{std::move(values), std::move(validity), {nullptr, nullptr}};
+    data->buffers[0] = data->validity.empty() ? nullptr : data->validity.data();
+    data->buffers[1] = data->values.data();
+
+    auto *array = new ArrowArray{static_cast<int64_t>(length), null_count, 0, 2, 0,
+                                 data->buffers, nullptr, nullptr, release_bool_array, data};
+    auto *schema = new ArrowSchema{"b", "", nullptr, ARROW_FLAG_NULLABLE, 0, nullptr, nullptr,
+                                   release_static_schema, nullptr};
+    // Consumers move the struct out and null its release; free whatever is left
+    py::object array_capsule = py::reinterpret_steal<py::object>(PyCapsule_New(
+        array, "arrow_array", [](PyObject *cap) {
+            auto *a = static_cast<ArrowArray *>(PyCapsule_GetPointer(cap, "arrow_array"));
+            if (a->release) a->release(a);
+            delete a;
+        }));
+    py::object schema_capsule = py::reinterpret_steal<py::object>(PyCapsule_New(
+        schema, "arrow_schema", [](PyObject *cap) {
+            auto *s = static_cast<ArrowSchema *>(PyCapsule_GetPointer(cap, "arrow_schema"));
+            if (s->release) s->release(s);
+            delete s;
+        }));
+    py::object holder = py::cast(ArrowArrayExport{schema_capsule, array_capsule});
+    return py::module_::import("pyarrow").attr("array")(holder);
+}
+
+// 1-D integer or fixed-width bytes ('S') buffer, read in place
+static StridedColumn buffer_column(const py::buffer_info &info) {
+    if (info.ndim != 1) throw py::value_error("Expected a 1-D array");
+    std::string format = info.format;
+    if (!format.empty() && (format[0] == '@' || format[0] == '=' || format[0] == '<')) {
+        format.erase(0, 1);
+    }
+    StridedColumn::Kind kind;
+    if (format.size() == 1 && std::strchr("bhilq", format[0])) {
+        kind = StridedColumn::Kind::SignedInt;
+    } else if (format.size() == 1 && std::strchr("BHILQ", format[0])) {
+        kind = StridedColumn::Kind::UnsignedInt;
+    } else if (!format.empty() && format.back() == 's') {
+        kind = StridedColumn::Kind::FixedBytes;
+    } else {
+        throw py::type_error("Unsupported buffer format '" + info.format +
+                             "' (expected little-endian integers or fixed-width bytes)");
+    }
+    return StridedColumn(static_cast<const char *>(info.ptr), static_cast<size_t>(info.shape[0]),
+                         info.strides[0], static_cast<size_t>(info.itemsize), kind);
+}
+
+static bool is_arrow_object(py::handle obj) {
+    return py::hasattr(obj, "__arrow_c_array__") || py::hasattr(obj, "__arrow_c_stream__");
+}
+
+// PLAIN encoding of a value for Parquet hashing: str/bytes as raw bytes,
+// int as INT64 (or INT32), float as DOUBLE (or FLOAT)
+static std::string_view parquet_plain(py::handle value, const std::string &physical_type,
+                                      char (&scratch)[8]) {
+    auto little_endian = [&scratch](uint64_t bits, size_t width) {
+        for (size_t i = 0; i < width; ++i) scratch[i] = static_cast<char>(bits >> (8 * i));
+        return std::string_view(scratch, width);
+    };
+    if (py::isinstance<py::str>(value) || py::isinstance<py::bytes>(value)) {
+        return py::cast<std::string_view>(value);
+    }
+    if (py::isinstance<py::int_>(value)) {
+        if (physical_type == "INT32") {
+            return little_endian(static_cast<uint32_t>(value.cast<int32_t>()), 4);
+        }
+        if (physical_type.empty() || physical_type == "INT64") {
+            return little_endian(static_cast<uint64_t>(value.cast<int64_t>()), 8);
+        }
+    } else if (py::isinstance<py::float_>(value)) {
+        if (physical_type == "FLOAT") {
+            const float f = value.cast<float>();
+            uint32_t bits;
+            std::memcpy(&bits, &f, 4);
+            return little_endian(bits, 4);
+        }
+        if (physical_type.empty() || physical_type == "DOUBLE") {
+            const double d = value.cast<double>();
+            uint64_t bits;
+            std::memcpy(&bits, &d, 8);
+            return little_endian(bits, 8);
+        }
+    }
+    throw py::type_error("Unsupported value for Parquet physical type '" +
+                         (physical_type.empty() ? std::string("auto") : physical_type) + "'");
+}
+
+// Token keys hashed under the filter's own scheme
+template <typename Fn>
+static bool for_each_filter_token(const BloomFilter &bf, const Tokenizer &tokenizer,
+                                  const TokenOptions &options, std::string_view text, Fn &&fn) {
+    if (bf.get_hash_scheme() == HashScheme::Xxh64) {
+        return for_each_token_hash(tokenizer, options, text.data(), text.size(), fn);
+    }
+    return for_each_token_hash(tokenizer, options, text.data(), text.size(),
+                               [&bf](const char *data, size_t len) { return bf.hash(data, len); }, fn);
+}
+
+// IBLT keys are raw 64-bit ids (int) or str/bytes identified by their hash
+static uint64_t iblt_key(py::handle item) {
+    if (py::isinstance<py::int_>(item)) {
+        return item.cast<uint64_t>();
+    }
+    std::string_view view = key_view(item);
+    return InvertibleBloomLookupTable::key_id(view.data(), view.size());
+}
+
+static std::vector<uint64_t> iblt_keys(py::iterable items) {
+    std::vector<uint64_t> keys;
+    for (py::handle item : items) {
+        keys.push_back(iblt_key(item));
+    }
+    return keys;
+}
+
 PYBIND11_MODULE(_bloomfilter, m) {
     m.doc() = "Fast Bloom filter implementation with configurable false positive rate";
 
     py::class_<BloomFilter> bloom(m, "BloomFilter", "Space-efficient probabilistic set membership testing");
 
     bloom
-        .def(py::init<size_t, double>(), 
-             py::arg("estimated_num_items"), py::arg("false_positive_rate"),
-             "Create filter with optimal parameters based on item count and error rate")
-        .def(py::init<size_t, size_t>(),
-             py::arg("num_bits"), py::arg("num_hashes"),
+        .def(py::init([](size_t n, double p, const std::string &hash) {
+                 return BloomFilter(n, p, parse_hash_scheme(hash));
+             }),
+             py::arg("estimated_num_items"), py::arg("false_positive_rate"), py::arg("hash") = "xxh64",
+             "Create filter with optimal parameters based on item count and error rate; "
+             "hash is 'xxh64', 'short_key' or 'crc32c'")
+        .def(py::init([](size_t num_bits, size_t num_hashes, const std::string &hash) {
+                 return BloomFilter(num_bits, num_hashes, parse_hash_scheme(hash));
+             }),
+             py::arg("num_bits"), py::arg("num_hashes"), py::arg("hash") = "xxh64",
              "Create filter with explicit bit count and hash function count")
-        .def("add", py::overload_cast<const std::string&>(&BloomFilter::add), 
-             py::arg("item"), "Add string item to filter")
-        .def("add", [](BloomFilter &bf, py::bytes item) {
-             std::string_view view = py::cast<std::string_view>(item);
-             bf.add(view.data(), view.size());
-         }, py::arg("item"), "Add bytes to filter")
+        .def_static("tuned", [](size_t n, size_t memory_bytes, double target_fpr,
+                                const std::string &optimize, const std::string &hash) {
+             const TuneObjective objective = parse_tune_objective(optimize);
+             const HashScheme scheme = parse_hash_scheme(hash);
+             py::gil_scoped_release release;
+             return BloomFilter::tuned(n, memory_bytes, target_fpr, objective, scheme);
+         }, py::arg("n"), py::arg("memory_bytes") = 0, py::arg("target_fpr") = 0.01,
+             py::arg("optimize") = "latency", py::arg("hash") = "xxh64",
+             "Filter for n items whose layout, k and size are tuned for this machine; "
+             "memory_bytes=0 allows 1.5x the space-optimal size")
+        // Python-side writes are always atomic: batch calls elsewhere may be
+        // inserting into the same filter with the GIL released
+        .def("add", [](BloomFilter &bf, py::object item) {
+             std::string_view view = key_view(item);
+             bf.add_hash_concurrent(bf.hash(view.data(), view.size()));
+         }, py::arg("item"), "Add str or bytes item to filter")
         .def("might_contain", py::overload_cast<const std::string&>(&BloomFilter::might_contain, py::const_),
              py::arg("item"), "Test if string might be in filter")
         .def("might_contain", [](const BloomFilter &bf, py::bytes item) {
@@ -33,26 +433,876 @@ PYBIND11_MODULE(_bloomfilter, m) {
              return bf.might_contain(view.data(), view.size());
          }, py::arg("item"), "Test if bytes might be in filter")
         .def("__contains__", [](const BloomFilter &bf, py::object item) {
-             if (py::isinstance<py::str>(item)) {
-                 return bf.might_contain(py::cast<std::string>(item));
-             } else if (py::isinstance<py::bytes>(item)) {
-                 std::string_view view = py::cast<std::string_view>(item);
-                 return bf.might_contain(view.data(), view.size());
-             }
-             throw py::type_error("Only str or bytes supported");
+             std::string_view view = key_view(item);
+             return bf.might_contain(view.data(), view.size());
          }, "Test membership with 'item in filter' syntax")
+        .def("add_many", [](BloomFilter &bf, py::iterable items, size_t threads) {
+             KeyBatch keys = to_key_batch(items);
+             py::gil_scoped_release release;
+             bf.add_many(keys, threads);
+         }, py::arg("items"), py::arg("threads") = 0,
+             "Add every str/bytes item of an iterable (GIL released, multithreaded)")
+        .def("add_many_partitioned", [](BloomFilter &bf, py::iterable items, size_t threads,
+                                        size_t memory_bytes) {
+             KeyBatch keys = to_key_batch(items);
+             py::gil_scoped_release release;
+             bf.add_many_partitioned(keys, threads, memory_bytes);
+         }, py::arg("items"), py::arg("threads") = 0, py::arg("memory_bytes") = 0,
+             "Bulk add for filters much larger than the CPU cache: probes are grouped by "
+             "cache-sized region before setting bits. Scratch stays within memory_bytes "
+             "(0 = 256 MB). No other thread may add meanwhile.")
+        .def("contains_many", [](const BloomFilter &bf, py::iterable items, size_t threads) {
+             KeyBatch keys = to_key_batch(items);
+             std::vector<uint8_t> found(keys.size());
+             {
+                 py::gil_scoped_release release;
+                 bf.might_contain_many(keys, found.data(), threads);
+             }
+             py::list out(found.size());
+             for (size_t i = 0; i < found.size(); ++i) {
+                 out[i] = py::bool_(found[i] != 0);
+             }
+             return out;
+         }, py::arg("items"), py::arg("threads") = 0,
+             "Membership test for every item; returns a list of bools")
+        .def("add_many_async", [](py::object self, py::iterable items, size_t threads) {
+             auto keys = std::make_shared<KeyBatch>(to_key_batch(items));
+             BloomFilter &bf = self.cast<BloomFilter &>();
+             return run_async(self,
+                 [&bf, keys, threads]() { bf.add_many(*keys, threads); return true; },
+                 [](bool) { return py::object(py::none()); });
+         }, py::arg("items"), py::arg("threads") = 0,
+             "Awaitable add_many: runs on the native thread pool, never blocks the event loop")
+        .def("contains_many_async", [](py::object self, py::iterable items, size_t threads) {
+             auto keys = std::make_shared<KeyBatch>(to_key_batch(items));
+             const BloomFilter &bf = self.cast<const BloomFilter &>();
+             return run_async(self,
+                 [&bf, keys, threads]() {
+                     std::vector<uint8_t> found(keys->size());
+                     bf.might_contain_many(*keys, found.data(), threads);
+                     return found;
+                 },
+                 [](std::vector<uint8_t> found) {
+                     py::list out(found.size());
+                     for (size_t i = 0; i < found.size(); ++i) {
+                         out[i] = py::bool_(found[i] != 0);
+                     }
+                     return py::object(std::move(out));
+                 });
+         }, py::arg("items"), py::arg("threads") = 0,
+             "Awaitable contains_many: resolves to a list of bools")
+        .def("update", [](BloomFilter &bf, py::iterable items, size_t chunk_size, size_t threads) {
+             stream_insert(items, chunk_size, [&bf, threads](const KeyBatch &chunk) {
+                 bf.add_many(chunk, threads);
+             });
+         }, py::arg("items"), py::arg("chunk_size") = 65536, py::arg("threads") = 0,
+             "Add every item of any iterable in bounded chunks without building a list")
+        .def("add_arrow", [](BloomFilter &bf, py::object array, size_t threads) {
+             ArrowInput input(array);
+             py::gil_scoped_release release;
+             for (const ArrowColumn &column : input.columns()) {
+                 add_arrow_column(bf, column, threads);
+             }
+         }, py::arg("array"), py::arg("threads") = 0,
+             "Add every non-null value of an Arrow string/binary/integer array (zero-copy)")
+        .def("contains_arrow", [](const BloomFilter &bf, py::object array, size_t threads) {
+             ArrowInput input(array);
+             const size_t words = (input.size() + 63) / 64;
+             std::vector<uint64_t> values(words + 1), validity;
+             int64_t null_count = 0;
+             {
+                 py::gil_scoped_release release;
+                 bool any_nulls = false;
+                 for (const ArrowColumn &column : input.columns()) any_nulls |= column.has_nulls();
+                 if (any_nulls) validity.assign(words + 1, 0);
+
+                 std::vector<uint64_t> chunk_bits;
+                 size_t row = 0;
+                 for (const ArrowColumn &column : input.columns()) {
+                     chunk_bits.assign((column.size() + 63) / 64, 0);
+                     contains_arrow_column(bf, column, chunk_bits.data(), threads);
+                     append_bits(values.data(), row, chunk_bits.data(), column.size());
+                     if (any_nulls) {
+                         for (size_t i = 0; i < column.size(); ++i) {
+                             if (column.is_valid(i)) {
+                                 validity[(row + i) >> 6] |= 1ULL << ((row + i) & 63);
+                             } else {
+                                 ++null_count;
+                             }
+                         }
+                     }
+                     row += column.size();
+                 }
+             }
+             return export_bool_array(std::move(values), std::move(validity), input.size(), null_count);
+         }, py::arg("array"), py::arg("threads") = 0,
+             "Membership of every value as a pyarrow BooleanArray (nulls stay null)")
+        .def("build_from_column", [](BloomFilter &bf, py::object column, size_t threads) {
+             if (is_arrow_object(column)) {
+                 ArrowInput input(column);
+                 py::gil_scoped_release release;
+                 for (const ArrowColumn &chunk : input.columns()) {
+                     build_from_column(bf, chunk, threads);
+                 }
+                 return;
+             }
+             py::buffer_info info = column.cast<py::buffer>().request();
+             StridedColumn strided = buffer_column(info);
+             py::gil_scoped_release release;
+             build_from_column(bf, strided, threads);
+         }, py::arg("column"), py::arg("threads") = 0,
+             "Add every non-null key of a NumPy integer/bytes array or Arrow column (build side)")
+        .def("probe_select", [](const BloomFilter &bf, py::object column, size_t threads) {
+             std::vector<int64_t> selection;
+             if (is_arrow_object(column)) {
+                 ArrowInput input(column);
+                 py::gil_scoped_release release;
+                 int64_t row = 0;
+                 for (const ArrowColumn &chunk : input.columns()) {
+                     probe_select(bf, chunk, row, selection, threads);
+                     row += static_cast<int64_t>(chunk.size());
+                 }
+             } else {
+                 py::buffer_info info = column.cast<py::buffer>().request();
+                 StridedColumn strided = buffer_column(info);
+                 py::gil_scoped_release release;
+                 probe_select(bf, strided, 0, selection, threads);
+             }
+             py::array_t<int64_t> out(static_cast<py::ssize_t>(selection.size()));
+             std::memcpy(out.mutable_data(), selection.data(), selection.size() * sizeof(int64_t));
+             return out;
+         }, py::arg("column"), py::arg("threads") = 0,
+             "Row indices (int64 array) of the column's keys that might be in the filter")
+        .def("add_tokens", [](BloomFilter &bf, py::object text, const std::string &delimiters,
+                              bool lowercase, size_t ngram) {
+             std::string_view view = key_view(text);
+             Tokenizer tokenizer(delimiters);
+             py::gil_scoped_release release;
+             for_each_filter_token(bf, tokenizer, TokenOptions{lowercase, ngram}, view,
+                                   [&](const KeyHash &hash) {
+                                       bf.add_hash_concurrent(hash);
+                                       return true;
+                                   });
+         }, py::arg("text"), py::arg("delimiters") = std::string(Tokenizer::DEFAULT_DELIMITERS),
+             py::arg("lowercase") = false, py::arg("ngram") = 1,
+             "Add every token of text (and word n-grams up to ngram, joined by single spaces). "
+             "ngram is at most 8; larger values raise ValueError")
+        .def("contains_all_tokens", [](const BloomFilter &bf, py::object query,
+                                       const std::string &delimiters, bool lowercase, size_t ngram) {
+             std::string_view view = key_view(query);
+             Tokenizer tokenizer(delimiters);
+             return for_each_filter_token(bf, tokenizer, TokenOptions{lowercase, ngram}, view,
+                                          [&](const KeyHash &hash) { return bf.might_contain_hash(hash); });
+         }, py::arg("query"), py::arg("delimiters") = std::string(Tokenizer::DEFAULT_DELIMITERS),
+             py::arg("lowercase") = false, py::arg("ngram") = 1,
+             "True if every token (and n-gram) of query might be present; use the add_tokens "
+             "options (ngram at most 8)")
+        .def("contains_any_token", [](const BloomFilter &bf, py::object query,
+                                      const std::string &delimiters, bool lowercase) {
+             std::string_view view = key_view(query);
+             Tokenizer tokenizer(delimiters);
+             // Stops at the first hit; n-grams add nothing beyond their words
+             return !for_each_filter_token(bf, tokenizer, TokenOptions{lowercase, 1}, view,
+                                           [&](const KeyHash &hash) { return !bf.might_contain_hash(hash); });
+         }, py::arg("query"), py::arg("delimiters") = std::string(Tokenizer::DEFAULT_DELIMITERS),
+             py::arg("lowercase") = false,
+             "True if at least one token of query might be present")
+        .def("union_update", [](BloomFilter &bf, const BloomFilter &other, size_t threads) {
+             py::gil_scoped_release release;
+             bf.union_with(other, threads);
+         }, py::arg("other"), py::arg("threads") = 0,
+             "In-place union with a filter of identical parameters")
+        .def("__ior__", [](BloomFilter &bf, const BloomFilter &other) -> BloomFilter & {
+             py::gil_scoped_release release;
+             bf.union_with(other);
+             return bf;
+         })
+        .def("__or__", [](const BloomFilter &a, const BloomFilter &b) {
+             BloomFilter result(a);
+             py::gil_scoped_release release;
+             result.union_with(b);
+             return result;
+         })
+        .def("count_set_bits", [](const BloomFilter &bf, size_t threads) {
+             py::gil_scoped_release release;
+             return bf.count_set_bits(threads);
+         }, py::arg("threads") = 0, "Number of set bits (popcount of the bit array)")
+        .def("stats", [](const BloomFilter &bf) {
+#ifdef BLOOMFILTER_METRICS
+             const FilterMetrics::Snapshot s = bf.metrics().snapshot();
+             auto mean_seconds = [](const FilterMetrics::BatchStats &b) {
+                 return b.timed ? static_cast<double>(b.nanos) * 1e-9 / static_cast<double>(b.timed) : 0.0;
+             };
+             py::dict d;
+             d["adds"] = s.adds;
+             d["queries"] = s.queries;
+             d["positives"] = s.positives;
+             d["positive_rate"] = s.queries ? static_cast<double>(s.positives) / static_cast<double>(s.queries) : 0.0;
+             d["bits_set"] = s.bits_set;
+             d["fill_ratio"] = static_cast<double>(s.bits_set) / static_cast<double>(s.num_bits);
+             d["add_batches"] = s.batches[FilterMetrics::ADD_BATCH].calls;
+             d["add_batch_keys"] = s.batches[FilterMetrics::ADD_BATCH].keys;
+             d["add_batch_mean_seconds"] = mean_seconds(s.batches[FilterMetrics::ADD_BATCH]);
+             d["query_batches"] = s.batches[FilterMetrics::QUERY_BATCH].calls;
+             d["query_batch_keys"] = s.batches[FilterMetrics::QUERY_BATCH].keys;
+             d["query_batch_mean_seconds"] = mean_seconds(s.batches[FilterMetrics::QUERY_BATCH]);
+             return d;
+#else
+             (void)bf;
+             throw std::runtime_error("bloomfilter was built without metrics (rebuild with BLOOMFILTER_METRICS=ON)");
+#endif
+         }, "Operation counters since creation (adds, queries, positives, fill ratio, batch sizes and latency)")
+        .def_property("metrics_name",
+            [](const BloomFilter &bf) {
+#ifdef BLOOMFILTER_METRICS
+                return bf.metrics().name();
+#else
+                (void)bf;
+                return std::string();
+#endif
+            },
+            [](BloomFilter &bf, std::string name) {
+#ifdef BLOOMFILTER_METRICS
+                bf.metrics().set_name(std::move(name));
+#else
+                (void)bf;
+                (void)name;
+#endif
+            }, "Value of the filter label in metrics_text()")
+        .def("save", [](const BloomFilter &bf, py::object path) {
+             std::string p = fs_path(path);
+             py::gil_scoped_release release;
+             bf.save(p);
+         }, py::arg("path"), "Write the filter in the page-aligned filter file format")
+        .def_static("load", [](py::object path) {
+             std::string p = fs_path(path);
+             py::gil_scoped_release release;
+             return BloomFilter::load(p);
+         }, py::arg("path"), "Read a filter written by save()")
         .def_property_readonly("num_bits", &BloomFilter::get_num_bits)
         .def_property_readonly("num_hashes", &BloomFilter::get_num_hashes)
+        .def_property_readonly("layout", [](const BloomFilter &bf) {
+             return filter_layout_name(bf.get_layout());
+         }, "Bit layout: 'standard', 'blocked', 'split_block' or 'partitioned'")
+        .def_property_readonly("hash_scheme", [](const BloomFilter &bf) {
+             return hash_scheme_name(bf.get_hash_scheme());
+         }, "Key hashing: 'xxh64', 'short_key' or 'crc32c'")
         .def(py::pickle(
             [](const BloomFilter &bf) {
-                return py::make_tuple(bf.get_num_bits(), bf.get_num_hashes(), bf.get_raw_bits_vector());
+                return py::make_tuple(bf.get_num_bits(), bf.get_num_hashes(), bf.get_raw_bits_vector(),
+                                      static_cast<int>(bf.get_layout()),
+                                      static_cast<int>(bf.get_hash_scheme()));
+            },
+            [](py::tuple t) {
+                // Older states: three items are standard, four add the layout;
+                // both hash with xxh64
+                if (t.size() < 3 || t.size() > 5) throw std::runtime_error("Invalid pickle state");
+                const auto layout = t.size() >= 4 ? static_cast<FilterLayout>(t[3].cast<uint16_t>())
+                                                  : FilterLayout::Standard;
+                const uint32_t scheme = t.size() == 5 ? t[4].cast<uint32_t>() : 0;
+                if (scheme > static_cast<uint32_t>(HashScheme::Crc32c)) {
+                    throw std::runtime_error("Invalid pickle state");
+                }
+                return BloomFilter(layout, t[0].cast<size_t>(), t[1].cast<size_t>(),
+                                   t[2].cast<std::vector<uint64_t>>(), static_cast<HashScheme>(scheme));
+            }
+        ));
+
+    py::class_<ArrowArrayExport>(m, "_ArrowArrayExport")
+        .def("__arrow_c_array__", [](const ArrowArrayExport &e, py::object) {
+             return py::make_tuple(e.schema_capsule, e.array_capsule);
+         }, py::arg("requested_schema") = py::none());
+
+    py::class_<AdaptiveBloomFilter>(m, "AdaptiveBloomFilter",
+                                    "BloomFilter that learns to reject reported false positives")
+        .def(py::init<size_t, double, size_t>(),
+             py::arg("estimated_num_items"), py::arg("false_positive_rate"),
+             py::arg("max_suppressed") = 4096,
+             "Create filter with optimal parameters and room for ~max_suppressed reported keys")
+        .def(py::init<const BloomFilter&, size_t>(),
+             py::arg("filter"), py::arg("max_suppressed") = 4096,
+             "Wrap a copy of an existing BloomFilter")
+        .def("add", [](AdaptiveBloomFilter &abf, py::object item) {
+             std::string_view view = key_view(item);
+             abf.add(view.data(), view.size());
+         }, py::arg("item"), "Add str or bytes item (clears any suppression for it)")
+        .def("might_contain", [](const AdaptiveBloomFilter &abf, py::object item) {
+             std::string_view view = key_view(item);
+             return abf.might_contain(view.data(), view.size());
+         }, py::arg("item"))
+        .def("__contains__", [](const AdaptiveBloomFilter &abf, py::object item) {
+             std::string_view view = key_view(item);
+             return abf.might_contain(view.data(), view.size());
+         })
+        .def("report_false_positive", [](AdaptiveBloomFilter &abf, py::object item) {
+             std::string_view view = key_view(item);
+             return abf.report_false_positive(view.data(), view.size());
+         }, py::arg("item"),
+             "Record a key the backend confirmed absent; later queries for it return False")
+        .def("clear_suppressed", &AdaptiveBloomFilter::clear_suppressed)
+        .def_property_readonly("filter", [](const AdaptiveBloomFilter &abf) {
+             return BloomFilter(abf.get_filter()); // copy: writes must go through add()
+         })
+        .def_property_readonly("num_suppressed", &AdaptiveBloomFilter::get_num_suppressed)
+        .def_property_readonly("max_suppressed", &AdaptiveBloomFilter::get_max_suppressed)
+        .def(py::pickle(
+            [](const AdaptiveBloomFilter &abf) {
+                const BloomFilter &bf = abf.get_filter();
+                return py::make_tuple(bf.get_num_bits(), bf.get_num_hashes(),
+                                      bf.get_raw_bits_vector(), abf.get_raw_slots_vector(),
+                                      static_cast<int>(bf.get_layout()),
+                                      static_cast<int>(bf.get_hash_scheme()));
+            },
+            [](py::tuple t) {
+                // Older states: four items are standard, five add the layout;
+                // both hash with xxh64
+                if (t.size() < 4 || t.size() > 6) throw std::runtime_error("Invalid pickle state");
+                const auto layout = t.size() >= 5 ? static_cast<FilterLayout>(t[4].cast<uint16_t>())
+                                                  : FilterLayout::Standard;
+                const uint32_t scheme = t.size() == 6 ? t[5].cast<uint32_t>() : 0;
+                if (scheme > static_cast<uint32_t>(HashScheme::Crc32c)) {
+                    throw std::runtime_error("Invalid pickle state");
+                }
+                BloomFilter bf(layout, t[0].cast<size_t>(), t[1].cast<size_t>(),
+                               t[2].cast<std::vector<uint64_t>>(), static_cast<HashScheme>(scheme));
+                return AdaptiveBloomFilter(bf, t[3].cast<std::vector<uint32_t>>());
+            }
+        ));
+
+    py::class_<ParquetBloomFilter>(m, "ParquetBloomFilter",
+                                   "Parquet split-block Bloom filter (read and write)")
+        .def(py::init<size_t>(), py::arg("num_bytes"),
+             "Create an empty filter; num_bytes must be a multiple of 32")
+        .def_static("for_ndv", [](size_t ndv, double fpp) {
+             return ParquetBloomFilter(ParquetBloomFilter::optimal_num_bytes(ndv, fpp));
+         }, py::arg("ndv"), py::arg("fpp") = 0.01,
+             "Create a filter sized like parquet writers size it for ndv distinct values")
+        .def_static("from_bytes", [](py::buffer data, bool has_header) {
+             py::buffer_info info = data.request();
+             return ParquetBloomFilter::from_parquet_bytes(static_cast<const char *>(info.ptr),
+                                                           static_cast<size_t>(info.size * info.itemsize),
+                                                           has_header);
+         }, py::arg("data"), py::arg("has_header") = true,
+             "Parse the bytes at a column chunk's bloom_filter_offset (header + bitset)")
+        .def("to_bytes", [](const ParquetBloomFilter &f, bool with_header) {
+             return py::bytes(f.to_parquet_bytes(with_header));
+         }, py::arg("with_header") = true, "Serialize in the exact Parquet on-disk format")
+        .def("add", [](ParquetBloomFilter &f, py::object value, const std::string &physical_type) {
+             char scratch[8];
+             std::string_view plain = parquet_plain(value, physical_type, scratch);
+             f.insert(plain.data(), plain.size());
+         }, py::arg("value"), py::arg("physical_type") = "",
+             "Insert a value; physical_type picks INT32/INT64/FLOAT/DOUBLE encoding for numbers")
+        .def("might_contain", [](const ParquetBloomFilter &f, py::object value,
+                                 const std::string &physical_type) {
+             char scratch[8];
+             std::string_view plain = parquet_plain(value, physical_type, scratch);
+             return f.check(plain.data(), plain.size());
+         }, py::arg("value"), py::arg("physical_type") = "")
+        .def("__contains__", [](const ParquetBloomFilter &f, py::object value) {
+             char scratch[8];
+             std::string_view plain = parquet_plain(value, "", scratch);
+             return f.check(plain.data(), plain.size());
+         })
+        .def("add_hash", &ParquetBloomFilter::insert_hash, py::arg("hash"))
+        .def("might_contain_hash", &ParquetBloomFilter::check_hash, py::arg("hash"))
+        .def_static("hash", [](py::object value, const std::string &physical_type) {
+             char scratch[8];
+             std::string_view plain = parquet_plain(value, physical_type, scratch);
+             return ParquetBloomFilter::hash(plain.data(), plain.size());
+         }, py::arg("value"), py::arg("physical_type") = "",
+             "XXH64 (seed 0) of the value's PLAIN encoding")
+        .def_property_readonly("num_bytes", &ParquetBloomFilter::get_num_bytes)
+        .def(py::pickle(
+            [](const ParquetBloomFilter &f) { return py::make_tuple(py::bytes(f.to_parquet_bytes(false))); },
+            [](py::tuple t) {
+                if (t.size() != 1) throw std::runtime_error("Invalid pickle state");
+                std::string_view view = py::cast<std::string_view>(t[0]);
+                return ParquetBloomFilter::from_parquet_bytes(view.data(), view.size(), false);
+            }
+        ));
+
+    py::class_<BlockedBloomFilter>(m, "BlockedBloomFilter",
+                                   "Bloom filter whose k probes share one 512-bit block")
+        .def(py::init<size_t, double>(),
+             py::arg("estimated_num_items"), py::arg("false_positive_rate"),
+             "Create filter with optimal parameters based on item count and error rate")
+        .def("add", [](BlockedBloomFilter &bf, py::object item) {
+             std::string_view view = key_view(item);
+             bf.add_hash_concurrent(hash_key(view.data(), view.size()));
+         }, py::arg("item"), "Add a str or bytes item")
+        .def("add_many", [](BlockedBloomFilter &bf, py::iterable items, size_t threads) {
+             KeyBatch keys = to_key_batch(items);
+             py::gil_scoped_release release;
+             parallel_for(keys.size(), 4096, threads, [&](size_t begin, size_t end) {
+                 for (size_t i = begin; i < end; ++i) {
+                     bf.add_hash_concurrent(hash_key(keys.data(i), keys.length(i)));
+                 }
+             });
+         }, py::arg("items"), py::arg("threads") = 0, "Add every item of an iterable")
+        .def("might_contain", [](const BlockedBloomFilter &bf, py::object item) {
+             std::string_view view = key_view(item);
+             return bf.might_contain(view.data(), view.size());
+         }, py::arg("item"), "Check if item might be in the set")
+        .def("__contains__", [](const BlockedBloomFilter &bf, py::object item) {
+             std::string_view view = key_view(item);
+             return bf.might_contain(view.data(), view.size());
+         })
+        .def("save", [](const BlockedBloomFilter &bf, py::object path) {
+             std::string p = fs_path(path);
+             py::gil_scoped_release release;
+             bf.save(p);
+         }, py::arg("path"), "Write the filter in the page-aligned filter file format")
+        .def_static("load", [](py::object path) {
+             std::string p = fs_path(path);
+             py::gil_scoped_release release;
+             return BlockedBloomFilter::load(p);
+         }, py::arg("path"), "Read a filter written by save() into memory")
+        .def_property_readonly("num_bits", &BlockedBloomFilter::get_num_bits)
+        .def_property_readonly("num_blocks", &BlockedBloomFilter::get_num_blocks)
+        .def_property_readonly("num_hashes", &BlockedBloomFilter::get_num_hashes)
+        .def(py::pickle(
+            [](const BlockedBloomFilter &bf) {
+                return py::make_tuple(bf.get_num_blocks(), bf.get_num_hashes(), bf.get_words());
             },
             [](py::tuple t) {
                 if (t.size() != 3) throw std::runtime_error("Invalid pickle state");
-                return BloomFilter(t[0].cast<size_t>(), t[1].cast<size_t>(), t[2].cast<std::vector<uint64_t>>());
+                return BlockedBloomFilter(t[0].cast<size_t>(), t[1].cast<size_t>(),
+                                          t[2].cast<std::vector<uint64_t>>());
+            }
+        ));
+
+#ifdef BLOOM_HAVE_DISK_FILTER
+    py::class_<DiskBloomFilter>(m, "DiskBloomFilter",
+                                "Read-only blocked filter served from disk, one page read per lookup")
+        .def(py::init([](py::object path, size_t cache_pages, unsigned queue_depth) {
+                 return std::make_unique<DiskBloomFilter>(fs_path(path), cache_pages, queue_depth);
+             }),
+             py::arg("path"), py::arg("cache_pages") = 256, py::arg("queue_depth") = 64,
+             "Open a file written by BlockedBloomFilter.save()")
+        .def("might_contain", [](const DiskBloomFilter &df, py::object item) {
+             std::string_view view = key_view(item);
+             const KeyHash hash = df.hash(view.data(), view.size());
+             py::gil_scoped_release release;
+             return df.might_contain_hash(hash);
+         }, py::arg("item"), "Check if item might be in the set (one page read unless cached)")
+        .def("__contains__", [](const DiskBloomFilter &df, py::object item) {
+             std::string_view view = key_view(item);
+             const KeyHash hash = df.hash(view.data(), view.size());
+             py::gil_scoped_release release;
+             return df.might_contain_hash(hash);
+         })
+        .def("contains_many", [](const DiskBloomFilter &df, py::iterable items) {
+             std::vector<KeyHash> hashes;
+             for (py::handle item : items) {
+                 std::string_view view = key_view(item);
+                 hashes.push_back(df.hash(view.data(), view.size()));
+             }
+             std::vector<uint8_t> out(hashes.size());
+             {
+                 py::gil_scoped_release release;
+                 df.might_contain_many(hashes.data(), hashes.size(), out.data());
+             }
+             py::list result(out.size());
+             for (size_t i = 0; i < out.size(); ++i) result[i] = py::bool_(out[i] != 0);
+             return result;
+         }, py::arg("items"), "Batch membership test; all page reads are in flight together")
+        .def_property_readonly("io_backend", [](const DiskBloomFilter &df) {
+             return df.uses_io_uring() ? "io_uring" : "pread";
+         })
+        .def_property_readonly("direct_io", &DiskBloomFilter::uses_direct_io)
+        .def_property_readonly("num_blocks", &DiskBloomFilter::get_num_blocks)
+        .def_property_readonly("num_hashes", &DiskBloomFilter::get_num_hashes);
+#endif
+
+#ifdef BLOOM_HAVE_FILTER_MERGE
+    m.def("merge_files", [](py::iterable paths, py::object out_path, size_t threads,
+                            size_t memory_bytes) {
+             std::vector<std::string> inputs;
+             for (py::handle path : paths) inputs.push_back(fs_path(path));
+             std::string out = fs_path(out_path);
+             py::gil_scoped_release release;
+             merge_filter_files(inputs, out, threads, memory_bytes);
+         }, py::arg("paths"), py::arg("out_path"), py::arg("threads") = 0,
+          py::arg("memory_bytes") = 0,
+          "OR saved filter files with identical parameters into out_path, streaming them in "
+          "stripes within memory_bytes (0 = 256 MB)");
+#endif
+
+    py::class_<TieredBloomFilter>(m, "TieredBloomFilter",
+                                  "Cache-resident level-one filter in front of a full-size filter")
+        .def(py::init<size_t, double, size_t>(),
+             py::arg("estimated_num_items"), py::arg("false_positive_rate"),
+             py::arg("level1_bytes") = 0,
+             "Create with overall error rate p; level1_bytes=0 uses half the L2 cache")
+        .def("add", [](TieredBloomFilter &tbf, py::object item) {
+             std::string_view view = key_view(item);
+             tbf.add_hash_concurrent(hash_key(view.data(), view.size()));
+         }, py::arg("item"), "Add str or bytes item to both levels")
+        .def("might_contain", [](const TieredBloomFilter &tbf, py::object item) {
+             std::string_view view = key_view(item);
+             return tbf.might_contain(view.data(), view.size());
+         }, py::arg("item"))
+        .def("__contains__", [](const TieredBloomFilter &tbf, py::object item) {
+             std::string_view view = key_view(item);
+             return tbf.might_contain(view.data(), view.size());
+         })
+        .def_property_readonly("level1", [](const TieredBloomFilter &tbf) {
+             return BloomFilter(tbf.get_level1());
+         }, "Copy of the level-one filter")
+        .def_property_readonly("level2", [](const TieredBloomFilter &tbf) {
+             return BloomFilter(tbf.get_level2());
+         }, "Copy of the level-two filter")
+        .def(py::pickle(
+            [](const TieredBloomFilter &tbf) {
+                const BloomFilter &l1 = tbf.get_level1();
+                const BloomFilter &l2 = tbf.get_level2();
+                return py::make_tuple(l1.get_num_bits(), l1.get_num_hashes(), l1.get_raw_bits_vector(),
+                                      l2.get_num_bits(), l2.get_num_hashes(), l2.get_raw_bits_vector());
+            },
+            [](py::tuple t) {
+                if (t.size() != 6) throw std::runtime_error("Invalid pickle state");
+                return TieredBloomFilter(
+                    BloomFilter(t[0].cast<size_t>(), t[1].cast<size_t>(), t[2].cast<std::vector<uint64_t>>()),
+                    BloomFilter(t[3].cast<size_t>(), t[4].cast<size_t>(), t[5].cast<std::vector<uint64_t>>()));
+            }
+        ));
+
+    py::class_<BloomierFilter>(m, "BloomierFilter",
+                               "Static key -> small value map without key storage")
+        .def(py::init([](py::iterable keys, std::vector<uint64_t> values, unsigned value_bits) {
+             return BloomierFilter(to_key_batch(keys), values, value_bits);
+         }), py::arg("keys"), py::arg("values"), py::arg("value_bits") = 8,
+             "Build from parallel key and value sequences; values must fit in value_bits")
+        .def("get", [](const BloomierFilter &bf, py::object key) {
+             std::string_view view = key_view(key);
+             return bf.get(view.data(), view.size());
+         }, py::arg("key"), "Value stored for key (arbitrary for keys not in the build set)")
+        .def("__getitem__", [](const BloomierFilter &bf, py::object key) {
+             std::string_view view = key_view(key);
+             return bf.get(view.data(), view.size());
+         })
+        .def("get_many", [](const BloomierFilter &bf, py::iterable keys) {
+             std::vector<uint64_t> out;
+             for (py::handle key : keys) {
+                 std::string_view view = key_view(key);
+                 out.push_back(bf.get(view.data(), view.size()));
+             }
+             return out;
+         }, py::arg("keys"), "Look up every key in an iterable")
+        .def_property_readonly("value_bits", &BloomierFilter::get_value_bits)
+        .def_property_readonly("num_cells", &BloomierFilter::get_num_cells)
+        .def_property_readonly("size_in_bytes", &BloomierFilter::size_in_bytes)
+        .def(py::pickle(
+            [](const BloomierFilter &bf) {
+                return py::make_tuple(bf.get_value_bits(), bf.get_segment_length(),
+                                      bf.get_seed(), bf.get_raw_cells_vector());
+            },
+            [](py::tuple t) {
+                if (t.size() != 4) throw std::runtime_error("Invalid pickle state");
+                return BloomierFilter(t[0].cast<unsigned>(), t[1].cast<size_t>(),
+                                      t[2].cast<uint64_t>(), t[3].cast<std::vector<uint64_t>>());
+            }
+        ));
+
+    py::class_<CountMinSketch>(m, "CountMinSketch",
+                               "Count-Min frequency sketch sharing BloomFilter's hashing")
+        .def(py::init<size_t, size_t, bool>(),
+             py::arg("width"), py::arg("depth"), py::arg("conservative") = true,
+             "Create sketch with explicit row width and number of rows")
+        .def(py::init<double, double, bool>(),
+             py::arg("epsilon"), py::arg("delta"), py::arg("conservative") = true,
+             "Create sketch whose overestimate is <= epsilon * total with probability 1 - delta")
+        .def("add", [](CountMinSketch &cms, py::object item, uint32_t count, BloomFilter *bloom) {
+             std::string_view view = key_view(item);
+             if (bloom) CountMinSketch::check_shared_hashing(*bloom);
+             const KeyHash hash = hash_key(view.data(), view.size());
+             if (bloom) bloom->add_hash_concurrent(hash);
+             cms.add_hash_concurrent(hash, count);
+         }, py::arg("item"), py::arg("count") = 1, py::arg("bloom") = nullptr,
+             "Count item; also insert it into `bloom` from the same hash computation")
+        .def("add_many", [](CountMinSketch &cms, py::iterable items,
+                            std::optional<std::vector<uint32_t>> counts, BloomFilter *bloom,
+                            bool concurrent) {
+             KeyBatch keys = to_key_batch(items);
+             if (counts && counts->size() != keys.size()) {
+                 throw py::value_error("counts must have the same length as items");
+             }
+             const uint32_t *count_ptr = counts ? counts->data() : nullptr;
+             if (concurrent) {
+                 py::gil_scoped_release release;
+                 cms.add_many(keys, count_ptr, bloom, true);
+             } else {
+                 cms.add_many(keys, count_ptr, bloom, false);
+             }
+         }, py::arg("items"), py::arg("counts") = py::none(), py::arg("bloom") = nullptr,
+             py::arg("concurrent") = false,
+             "Batch add; concurrent=True releases the GIL and uses atomic updates. "
+             "Pass it from every thread that ingests into the same sketch at once")
+        .def("estimate", [](const CountMinSketch &cms, py::object item) {
+             std::string_view view = key_view(item);
+             return cms.estimate(view.data(), view.size());
+         }, py::arg("item"), "Estimated count (never below the true count)")
+        .def("__getitem__", [](const CountMinSketch &cms, py::object item) {
+             std::string_view view = key_view(item);
+             return cms.estimate(view.data(), view.size());
+         })
+        .def("estimate_many", [](const CountMinSketch &cms, py::iterable items) {
+             KeyBatch keys = to_key_batch(items);
+             std::vector<uint32_t> out(keys.size());
+             {
+                 py::gil_scoped_release release;
+                 cms.estimate_many(keys, out.data());
+             }
+             return out;
+         }, py::arg("items"))
+        .def_property_readonly("width", &CountMinSketch::get_width)
+        .def_property_readonly("depth", &CountMinSketch::get_depth)
+        .def_property_readonly("conservative", &CountMinSketch::is_conservative)
+        .def_property_readonly("total_count", &CountMinSketch::get_total_count)
+        .def(py::pickle(
+            [](const CountMinSketch &cms) {
+                return py::make_tuple(cms.get_width(), cms.get_depth(), cms.is_conservative(),
+                                      cms.get_total_count(), cms.get_raw_counters_vector());
+            },
+            [](py::tuple t) {
+                if (t.size() != 5) throw std::runtime_error("Invalid pickle state");
+                return CountMinSketch(t[0].cast<size_t>(), t[1].cast<size_t>(), t[2].cast<bool>(),
+                                      t[3].cast<uint64_t>(), t[4].cast<std::vector<uint32_t>>());
+            }
+        ));
+
+    using IBLT = InvertibleBloomLookupTable;
+    py::class_<IBLT>(m, "IBLT", "Invertible Bloom Lookup Table for set reconciliation")
+        .def(py::init<size_t, size_t>(), py::arg("num_cells"), py::arg("num_hashes") = 3,
+             "Create an empty table; decoding succeeds while the difference stays below ~num_cells / 1.3")
+        .def_static("for_difference", [](size_t max_difference, size_t num_hashes) {
+             return IBLT(static_cast<size_t>(1.5 * static_cast<double>(max_difference)) + 30, num_hashes);
+         }, py::arg("max_difference"), py::arg("num_hashes") = 3,
+             "Create a table sized to decode up to max_difference keys")
+        .def_static("key_id", [](py::object item) { return iblt_key(item); }, py::arg("item"),
+             "64-bit id under which a str/bytes key is stored (ints are their own id)")
+        .def("add", [](IBLT &t, py::object item) { t.insert(iblt_key(item)); }, py::arg("item"),
+             "Insert a str, bytes or 64-bit int key")
+        .def("remove", [](IBLT &t, py::object item) { t.erase(iblt_key(item)); }, py::arg("item"),
+             "Remove a key (may drive counts negative)")
+        .def("add_many", [](IBLT &t, py::iterable items) {
+             std::vector<uint64_t> keys = iblt_keys(items);
+             py::gil_scoped_release release;
+             t.insert_many(keys.data(), keys.size());
+         }, py::arg("items"), "Insert every key in an iterable")
+        .def("remove_many", [](IBLT &t, py::iterable items) {
+             std::vector<uint64_t> keys = iblt_keys(items);
+             py::gil_scoped_release release;
+             t.erase_many(keys.data(), keys.size());
+         }, py::arg("items"), "Remove every key in an iterable")
+        .def("subtract", &IBLT::subtract, py::arg("other"), "In-place self -= other")
+        .def("__sub__", [](const IBLT &a, const IBLT &b) {
+             IBLT diff(a);
+             diff.subtract(b);
+             return diff;
+         })
+        .def("decode", [](const IBLT &t) {
+             std::vector<uint64_t> positive, negative;
+             bool ok;
+             {
+                 py::gil_scoped_release release;
+                 ok = t.decode(positive, negative);
+             }
+             if (!ok) throw std::runtime_error("IBLT decode failed: difference exceeds table capacity");
+             return py::make_tuple(positive, negative);
+         }, "Peel the table into (ids only in self, ids only in other)")
+        .def("to_bytes", [](const IBLT &t) { return py::bytes(t.serialize()); })
+        .def_static("from_bytes", [](py::bytes data) {
+             std::string_view view = py::cast<std::string_view>(data);
+             return IBLT::deserialize(view.data(), view.size());
+         }, py::arg("data"))
+        .def_property_readonly("num_cells", &IBLT::get_num_cells)
+        .def_property_readonly("num_hashes", &IBLT::get_num_hashes)
+        .def(py::pickle(
+            [](const IBLT &t) { return py::make_tuple(py::bytes(t.serialize())); },
+            [](py::tuple t) {
+                if (t.size() != 1) throw std::runtime_error("Invalid pickle state");
+                std::string_view view = py::cast<std::string_view>(t[0]);
+                return IBLT::deserialize(view.data(), view.size());
+            }
+        ));
+
+    py::class_<BlockIndex>(m, "BlockIndex", "Per-block Bloom filters for skipping data blocks, stored bit-sliced")
+        .def(py::init<size_t, size_t, size_t>(),
+             py::arg("num_blocks"), py::arg("bits_per_block"), py::arg("num_hashes"),
+             "Create an empty index of num_blocks filters with explicit parameters")
+        .def_static("build", [](py::buffer data, std::vector<uint64_t> block_ends,
+                                size_t keys_per_block, double false_positive_rate,
+                                const std::string &delimiters, size_t threads) {
+             py::buffer_info info = data.request();
+             if (info.ndim != 1 || info.strides[0] != info.itemsize) {
+                 throw py::value_error("data must be a contiguous bytes-like object");
+             }
+             BlockIndex index = BlockIndex::for_rate(block_ends.size(), keys_per_block,
+                                                     false_positive_rate);
+             Tokenizer tokenizer(delimiters);
+             py::gil_scoped_release release;
+             index.build(static_cast<const char *>(info.ptr),
+                         static_cast<size_t>(info.size * info.itemsize),
+                         block_ends.data(), tokenizer, threads);
+             return index;
+         }, py::arg("data"), py::arg("block_ends"), py::arg("keys_per_block"),
+             py::arg("false_positive_rate") = 0.01,
+             py::arg("delimiters") = std::string(Tokenizer::DEFAULT_DELIMITERS), py::arg("threads") = 0,
+             "Tokenize each block data[block_ends[i-1]:block_ends[i]] and index its tokens in parallel")
+        .def("add", [](BlockIndex &index, size_t block, py::object key) {
+             std::string_view view = key_view(key);
+             index.add_hash(block, hash_key(view.data(), view.size()));
+         }, py::arg("block"), py::arg("key"), "Add a str or bytes key to one block's filter")
+        .def("candidate_blocks", [](const BlockIndex &index, py::object key) {
+             std::string_view view = key_view(key);
+             const KeyHash hash = hash_key(view.data(), view.size());
+             return index.candidate_blocks(&hash, 1, true);
+         }, py::arg("key"), "Ids of the blocks that might contain key")
+        .def("candidate_blocks_all", [](const BlockIndex &index, py::iterable keys) {
+             std::vector<KeyHash> hashes;
+             for (py::handle key : keys) {
+                 std::string_view view = key_view(key);
+                 hashes.push_back(hash_key(view.data(), view.size()));
+             }
+             py::gil_scoped_release release;
+             return index.candidate_blocks(hashes.data(), hashes.size(), true);
+         }, py::arg("keys"), "Ids of the blocks that might contain every key")
+        .def("candidate_blocks_any", [](const BlockIndex &index, py::iterable keys) {
+             std::vector<KeyHash> hashes;
+             for (py::handle key : keys) {
+                 std::string_view view = key_view(key);
+                 hashes.push_back(hash_key(view.data(), view.size()));
+             }
+             py::gil_scoped_release release;
+             return index.candidate_blocks(hashes.data(), hashes.size(), false);
+         }, py::arg("keys"), "Ids of the blocks that might contain at least one key")
+        .def("to_bytes", [](const BlockIndex &index) { return py::bytes(index.serialize()); })
+        .def_static("from_bytes", [](py::bytes data) {
+             std::string_view view = py::cast<std::string_view>(data);
+             return BlockIndex::deserialize(view.data(), view.size());
+         }, py::arg("data"))
+        .def_property_readonly("num_blocks", &BlockIndex::get_num_blocks)
+        .def_property_readonly("bits_per_block", &BlockIndex::get_bits_per_block)
+        .def_property_readonly("num_hashes", &BlockIndex::get_num_hashes)
+        .def(py::pickle(
+            [](const BlockIndex &index) { return py::make_tuple(py::bytes(index.serialize())); },
+            [](py::tuple t) {
+                if (t.size() != 1) throw std::runtime_error("Invalid pickle state");
+                std::string_view view = py::cast<std::string_view>(t[0]);
+                return BlockIndex::deserialize(view.data(), view.size());
             }
         ));
 
+    py::class_<FilterArray>(m, "FilterArray",
+                            "Many equally sized Bloom filters in one contiguous slab, addressed by id")
+        .def(py::init([](size_t num_filters, size_t bits_per_filter, size_t num_hashes,
+                         const std::string &layout, const std::string &hash) {
+                 return FilterArray(num_filters, bits_per_filter, num_hashes,
+                                    parse_filter_layout(layout), parse_hash_scheme(hash));
+             }),
+             py::arg("num_filters"), py::arg("bits_per_filter"), py::arg("num_hashes"),
+             py::arg("layout") = "standard", py::arg("hash") = "xxh64",
+             "Create num_filters empty filters with explicit parameters")
+        .def_static("for_rate", [](size_t num_filters, size_t items_per_filter, double p,
+                                   const std::string &hash) {
+             return FilterArray::for_rate(num_filters, items_per_filter, p, parse_hash_scheme(hash));
+         }, py::arg("num_filters"), py::arg("items_per_filter"),
+             py::arg("false_positive_rate") = 0.01, py::arg("hash") = "xxh64",
+             "Filters sized for items_per_filter keys at the given false positive rate")
+        .def("add", [](FilterArray &fa, size_t id, py::object item) {
+             std::string_view view = key_view(item);
+             fa.add(id, view.data(), view.size());
+         }, py::arg("id"), py::arg("item"), "Add a str or bytes item to filter id")
+        .def("might_contain", [](const FilterArray &fa, size_t id, py::object item) {
+             std::string_view view = key_view(item);
+             return fa.might_contain(id, view.data(), view.size());
+         }, py::arg("id"), py::arg("item"), "Test if filter id might contain item")
+        .def("add_many", [](FilterArray &fa, std::vector<uint64_t> ids, py::iterable items,
+                            size_t threads) {
+             KeyBatch keys = to_key_batch(items);
+             if (ids.size() != keys.size()) {
+                 throw py::value_error("ids and items must have the same length");
+             }
+             py::gil_scoped_release release;
+             fa.add_many(ids.data(), keys, threads);
+         }, py::arg("ids"), py::arg("items"), py::arg("threads") = 0,
+             "Add items[i] to filter ids[i] for every i (GIL released, multithreaded)")
+        .def("contains_many", [](const FilterArray &fa, std::vector<uint64_t> ids,
+                                 py::iterable items, size_t threads) {
+             KeyBatch keys = to_key_batch(items);
+             if (ids.size() != keys.size()) {
+                 throw py::value_error("ids and items must have the same length");
+             }
+             std::vector<uint8_t> found(keys.size());
+             {
+                 py::gil_scoped_release release;
+                 fa.might_contain_many(ids.data(), keys, found.data(), threads);
+             }
+             py::list out(found.size());
+             for (size_t i = 0; i < found.size(); ++i) {
+                 out[i] = py::bool_(found[i] != 0);
+             }
+             return out;
+         }, py::arg("ids"), py::arg("items"), py::arg("threads") = 0,
+             "Test items[i] against filter ids[i]; returns a list of bools")
+        .def("clear", &FilterArray::clear, py::arg("id"), "Reset filter id to empty")
+        .def("to_filter", &FilterArray::to_filter, py::arg("id"),
+             "Copy of filter id as a standalone BloomFilter")
+        .def("to_bytes", [](const FilterArray &fa) { return py::bytes(fa.serialize()); })
+        .def_static("from_bytes", [](py::bytes data) {
+             std::string_view view = py::cast<std::string_view>(data);
+             return FilterArray::deserialize(view.data(), view.size());
+         }, py::arg("data"))
+        .def("save", [](const FilterArray &fa, py::object path) {
+             std::string p = fs_path(path);
+             py::gil_scoped_release release;
+             fa.save(p);
+         }, py::arg("path"), "Write every filter to one file (the to_bytes format)")
+        .def_static("load", [](py::object path) {
+             std::string p = fs_path(path);
+             py::gil_scoped_release release;
+             return FilterArray::load(p);
+         }, py::arg("path"), "Read an array written by save()")
+        .def("__len__", &FilterArray::get_num_filters)
+        .def_property_readonly("num_filters", &FilterArray::get_num_filters)
+        .def_property_readonly("bits_per_filter", &FilterArray::get_bits_per_filter)
+        .def_property_readonly("num_hashes", &FilterArray::get_num_hashes)
+        .def_property_readonly("size_in_bytes", &FilterArray::size_in_bytes)
+        .def_property_readonly("layout", [](const FilterArray &fa) {
+             return filter_layout_name(fa.get_layout());
+         })
+        .def_property_readonly("hash_scheme", [](const FilterArray &fa) {
+             return hash_scheme_name(fa.get_hash_scheme());
+         })
+        .def(py::pickle(
+            [](const FilterArray &fa) { return py::make_tuple(py::bytes(fa.serialize())); },
+            [](py::tuple t) {
+                if (t.size() != 1) throw std::runtime_error("Invalid pickle state");
+                std::string_view view = py::cast<std::string_view>(t[0]);
+                return FilterArray::deserialize(view.data(), view.size());
+            }
+        ));
+
+    // The old pool may be joined here, and its queued async tasks need the GIL
+    m.def("set_num_threads", [](size_t n) { ThreadPool::set_global_size(n); }, py::arg("n"),
+          py::call_guard<py::gil_scoped_release>(),
+          "Threads used by batch operations when threads=0 (0 restores all cores)");
+    m.def("metrics_text", []() {
+#ifdef BLOOMFILTER_METRICS
+        return FilterMetrics::prometheus_text();
+#else
+        return std::string();
+#endif
+    }, "Counters of every live BloomFilter in the Prometheus text exposition format");
+#ifdef BLOOMFILTER_METRICS
+    m.attr("METRICS_ENABLED") = true;
+#else
+    m.attr("METRICS_ENABLED") = false;
+#endif
+    m.def("get_num_threads", []() { return ThreadPool::global_size(); });
+
     #ifdef VERSION_INFO
         m.attr("__version__") = MACRO_STRINGIFY(VERSION_INFO);
     #else
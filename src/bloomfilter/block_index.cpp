@@ -0,0 +1,157 @@
+#include "block_index.h"
+#include "bloom_filter.h"
+#include "byte_io.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <stdexcept>
+
+namespace {
+
+constexpr char BLOCK_INDEX_MAGIC[4] = {'B', 'S', 'K', 'I'};
+constexpr uint8_t BLOCK_INDEX_VERSION = 1;
+constexpr size_t BLOCK_INDEX_HEADER_SIZE = 24; // magic, version, k, pad, blocks, bits
+
+inline unsigned ctz64(uint64_t x) {
+#if defined(_MSC_VER) && !defined(__clang__)
+  unsigned long i;
+  _BitScanForward64(&i, x);
+  return static_cast<unsigned>(i);
+#else
+  return static_cast<unsigned>(__builtin_ctzll(x));
+#endif
+}
+
+} // namespace
+
+BlockIndex::BlockIndex(size_t num_blocks, size_t bits_per_block,
+                       size_t num_hashes)
+    : num_blocks_(num_blocks), num_bits_(bits_per_block),
+      num_hashes_(num_hashes), words_per_row_((num_blocks + 63) / 64) {
+  if (num_blocks_ == 0 || num_bits_ == 0 || num_hashes_ == 0 ||
+      num_hashes_ > 255) {
+    throw std::invalid_argument(
+        "Invalid parameters: blocks, bits and hashes must be > 0");
+  }
+  rows_.assign(num_bits_ * words_per_row_, 0);
+}
+
+BlockIndex BlockIndex::for_rate(size_t num_blocks, size_t keys_per_block,
+                                double p) {
+  const auto sizing = BloomFilter::optimal_layout(keys_per_block, p);
+  return BlockIndex(num_blocks, sizing.num_bits(), sizing.num_hashes());
+}
+
+// Same enhanced double hashing sequence as BloomFilter
+template <typename Fn>
+void BlockIndex::for_each_row(const KeyHash &hash, Fn &&fn) const {
+  uint64_t current_probe_hash = hash.h1;
+  uint64_t current_step_val = hash.h2;
+
+  for (size_t i = 0; i < num_hashes_; ++i) {
+    current_step_val += i;
+    fn(current_probe_hash % num_bits_);
+    current_probe_hash += current_step_val;
+  }
+}
+
+void BlockIndex::add_hash(size_t block, const KeyHash &hash) {
+  if (block >= num_blocks_) {
+    throw std::out_of_range("Block id out of range");
+  }
+  const uint64_t mask = 1ULL << (block & 63);
+  uint64_t *column = rows_.data() + (block >> 6);
+  for_each_row(hash, [&](size_t row) { column[row * words_per_row_] |= mask; });
+}
+
+void BlockIndex::build(const char *data, size_t len, const uint64_t *block_ends,
+                       const Tokenizer &tokenizer, size_t threads) {
+  for (size_t b = 0; b < num_blocks_; ++b) {
+    if (block_ends[b] > len || (b > 0 && block_ends[b] < block_ends[b - 1])) {
+      throw std::invalid_argument(
+          "Block ends must be ascending and within the data");
+    }
+  }
+  // A task owns one word column (64 blocks), so no two tasks share a word
+  parallel_for(words_per_row_, 1, threads, [&](size_t begin, size_t end) {
+    for (size_t w = begin; w < end; ++w) {
+      const size_t last = std::min(num_blocks_, (w + 1) * 64);
+      for (size_t b = w * 64; b < last; ++b) {
+        const size_t start = b == 0 ? 0 : block_ends[b - 1];
+        const uint64_t mask = 1ULL << (b & 63);
+        uint64_t *column = rows_.data() + w;
+        tokenizer.for_each_token(
+            data + start, block_ends[b] - start, [&](std::string_view token) {
+              for_each_row(hash_key(token.data(), token.size()), [&](size_t row) {
+                column[row * words_per_row_] |= mask;
+              });
+            });
+      }
+    }
+  });
+}
+
+std::vector<uint64_t> BlockIndex::candidates(const KeyHash *hashes, size_t n,
+                                             bool match_all) const {
+  std::vector<uint64_t> result(words_per_row_, match_all ? ~0ULL : 0);
+  std::vector<uint64_t> key_bits(words_per_row_);
+  for (size_t i = 0; i < n; ++i) {
+    key_bits.assign(words_per_row_, ~0ULL);
+    for_each_row(hashes[i], [&](size_t row) {
+      const uint64_t *r = rows_.data() + row * words_per_row_;
+      for (size_t w = 0; w < words_per_row_; ++w) key_bits[w] &= r[w];
+    });
+    for (size_t w = 0; w < words_per_row_; ++w) {
+      result[w] = match_all ? (result[w] & key_bits[w]) : (result[w] | key_bits[w]);
+    }
+  }
+  if (num_blocks_ & 63) {
+    result.back() &= (1ULL << (num_blocks_ & 63)) - 1;
+  }
+  return result;
+}
+
+std::vector<size_t> BlockIndex::candidate_blocks(const KeyHash *hashes, size_t n,
+                                                 bool match_all) const {
+  const std::vector<uint64_t> bitmap = candidates(hashes, n, match_all);
+  std::vector<size_t> blocks;
+  for (size_t w = 0; w < bitmap.size(); ++w) {
+    for (uint64_t bits = bitmap[w]; bits; bits &= bits - 1) {
+      blocks.push_back(w * 64 + ctz64(bits));
+    }
+  }
+  return blocks;
+}
+
+std::string BlockIndex::serialize() const {
+  std::string out;
+  out.reserve(BLOCK_INDEX_HEADER_SIZE + rows_.size() * 8);
+  out.append(BLOCK_INDEX_MAGIC, sizeof(BLOCK_INDEX_MAGIC));
+  write_le<uint8_t>(out, BLOCK_INDEX_VERSION);
+  write_le<uint8_t>(out, static_cast<uint8_t>(num_hashes_));
+  write_le<uint16_t>(out, 0);
+  write_le<uint64_t>(out, num_blocks_);
+  write_le<uint64_t>(out, num_bits_);
+  for (uint64_t v : rows_) write_le(out, v);
+  return out;
+}
+
+BlockIndex BlockIndex::deserialize(const char *data, size_t len) {
+  if (len < BLOCK_INDEX_HEADER_SIZE ||
+      std::string(data, 4) != std::string(BLOCK_INDEX_MAGIC, 4) ||
+      read_le<uint8_t>(data + 4) != BLOCK_INDEX_VERSION) {
+    throw std::invalid_argument("Invalid data for BlockIndex restoration");
+  }
+  const size_t num_hashes = read_le<uint8_t>(data + 5);
+  const uint64_t num_blocks = read_le<uint64_t>(data + 8);
+  const uint64_t num_bits = read_le<uint64_t>(data + 16);
+  const uint64_t words_per_row = (num_blocks + 63) / 64;
+  if (num_hashes == 0 || num_blocks == 0 || num_bits == 0 ||
+      words_per_row > (len - BLOCK_INDEX_HEADER_SIZE) / 8 / num_bits ||
+      len != BLOCK_INDEX_HEADER_SIZE + num_bits * words_per_row * 8) {
+    throw std::invalid_argument("Invalid data for BlockIndex restoration");
+  }
+  BlockIndex index(num_blocks, num_bits, num_hashes);
+  const char *p = data + BLOCK_INDEX_HEADER_SIZE;
+  for (auto &v : index.rows_) { v = read_le<uint64_t>(p); p += 8; }
+  return index;
+}
@@ -0,0 +1,55 @@
+#ifndef BLOCK_INDEX_H
+#define BLOCK_INDEX_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "hashing.h"
+#include "tokenizer.h"
+
+// Skip index holding one Bloom filter per data block, stored bit-sliced:
+// row j is the j-th bit of every block's filter, packed one bit per block.
+// A query hashes the key once and ANDs its num_hashes rows, yielding the
+// candidate blocks for all filters at the same time.
+class BlockIndex {
+public:
+    BlockIndex(size_t num_blocks, size_t bits_per_block, size_t num_hashes);
+
+    // Per-block filters sized like BloomFilter(keys_per_block, p)
+    static BlockIndex for_rate(size_t num_blocks, size_t keys_per_block, double p);
+
+    // Tokenize every block [block_ends[b-1], block_ends[b]) of data (the
+    // first starts at 0) and add its tokens; blocks are built in parallel
+    void build(const char* data, size_t len, const uint64_t* block_ends,
+               const Tokenizer& tokenizer, size_t threads = 0);
+
+    void add_hash(size_t block, const KeyHash& hash);
+
+    // Bitmap (one bit per block) of the blocks that might contain all keys
+    // (match_all) or any of them
+    std::vector<uint64_t> candidates(const KeyHash* hashes, size_t n, bool match_all) const;
+    // Same, as ascending block ids
+    std::vector<size_t> candidate_blocks(const KeyHash* hashes, size_t n, bool match_all) const;
+
+    std::string serialize() const;
+    static BlockIndex deserialize(const char* data, size_t len);
+
+    // Accessors
+    size_t get_num_blocks() const { return num_blocks_; }
+    size_t get_bits_per_block() const { return num_bits_; }
+    size_t get_num_hashes() const { return num_hashes_; }
+
+private:
+    template <typename Fn>
+    void for_each_row(const KeyHash& hash, Fn&& fn) const;
+
+    size_t num_blocks_;
+    size_t num_bits_;
+    size_t num_hashes_;
+    size_t words_per_row_;
+    std::vector<uint64_t> rows_; // num_bits_ rows of words_per_row_ words
+};
+
+#endif // BLOCK_INDEX_H
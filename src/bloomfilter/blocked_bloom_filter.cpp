@@ -0,0 +1,79 @@
+#include "blocked_bloom_filter.h"
+#include "atomics.h"
+#include "filter_file.h"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+BlockedBloomFilter::BlockedBloomFilter(size_t estimated_num_items,
+                                       double false_positive_rate) {
+  if (estimated_num_items == 0 || false_positive_rate <= 0.0 ||
+      false_positive_rate >= 1.0) {
+    throw std::invalid_argument(
+        "Invalid parameters: n must be > 0, p must be between 0 and 1");
+  }
+  // Same m and k as BloomFilter, rounded up to whole blocks
+  static constexpr double LN2 = 0.693147180559945;
+  const double m_bits = -static_cast<double>(estimated_num_items) *
+                        std::log(false_positive_rate) / (LN2 * LN2);
+  num_blocks_ = std::max<size_t>(
+      1, static_cast<size_t>(std::ceil(m_bits / BLOCK_BITS)));
+  num_hashes_ = std::clamp<size_t>(
+      static_cast<size_t>(std::ceil(m_bits / estimated_num_items * LN2)), 1, 16);
+  words_.assign(num_blocks_ * BLOCK_WORDS, 0);
+}
+
+BlockedBloomFilter::BlockedBloomFilter(size_t num_blocks, size_t num_hashes,
+                                       std::vector<uint64_t> words)
+    : num_blocks_(num_blocks), num_hashes_(num_hashes), words_(std::move(words)) {
+  if (num_blocks_ == 0 || num_hashes_ == 0 ||
+      words_.size() != num_blocks_ * BLOCK_WORDS) {
+    throw std::invalid_argument("Invalid data for BlockedBloomFilter restoration");
+  }
+}
+
+void BlockedBloomFilter::add_hash(const KeyHash &hash) {
+  uint64_t *block = &words_[block_index(hash) * BLOCK_WORDS];
+  for_each_block_bit(hash, num_hashes_, [block](uint32_t bit) {
+    block[bit >> 6] |= 1ULL << (bit & 63);
+  });
+}
+
+void BlockedBloomFilter::add_hash_concurrent(const KeyHash &hash) {
+  uint64_t *block = &words_[block_index(hash) * BLOCK_WORDS];
+  for_each_block_bit(hash, num_hashes_, [block](uint32_t bit) {
+    const uint64_t mask = 1ULL << (bit & 63);
+    if (!(atomic_load_relaxed(&block[bit >> 6]) & mask)) atomic_or_relaxed(&block[bit >> 6], mask);
+  });
+}
+
+bool BlockedBloomFilter::block_contains(const uint64_t *block, const KeyHash &hash,
+                                        size_t num_hashes) {
+  bool found = true;
+  for_each_block_bit(hash, num_hashes, [block, &found](uint32_t bit) {
+    found &= (block[bit >> 6] >> (bit & 63)) & 1;
+  });
+  return found;
+}
+
+void BlockedBloomFilter::save(const std::string &path) const {
+  FilterFileHeader header;
+  header.layout = FilterLayout::Blocked;
+  header.num_hashes = static_cast<uint32_t>(num_hashes_);
+  header.num_bits = get_num_bits();
+  write_filter_file(path, header, words_);
+}
+
+BlockedBloomFilter BlockedBloomFilter::load(const std::string &path) {
+  FilterFileHeader header;
+  std::vector<uint64_t> words = read_filter_file(path, header);
+  if (header.layout != FilterLayout::Blocked || header.num_bits % BLOCK_BITS != 0) {
+    throw std::invalid_argument(path + " does not hold a blocked filter");
+  }
+  if (header.hash_scheme != HashScheme::Xxh64) {
+    throw std::invalid_argument(path + " uses the '" + hash_scheme_name(header.hash_scheme) +
+                                "' hash scheme, which BlockedBloomFilter does not support");
+  }
+  return BlockedBloomFilter(header.num_bits / BLOCK_BITS, header.num_hashes,
+                            std::move(words));
+}
@@ -0,0 +1,56 @@
+#ifndef BLOCKED_BLOOM_FILTER_H
+#define BLOCKED_BLOOM_FILTER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "filter_layout.h"
+#include "hashing.h"
+
+// Cache-line blocked Bloom filter: h1 picks one 512-bit block and all k
+// probes (derived from h2) fall inside it, so a lookup touches one cache
+// line in memory and one 4 KB page on disk. Costs a slightly higher false
+// positive rate than BloomFilter at the same size.
+class BlockedBloomFilter {
+public:
+    static constexpr size_t BLOCK_BITS = BLOCKED_LAYOUT_BITS;
+    static constexpr size_t BLOCK_WORDS = BLOCK_BITS / 64;
+
+    BlockedBloomFilter(size_t estimated_num_items, double false_positive_rate);
+    // Constructor for deserialization
+    BlockedBloomFilter(size_t num_blocks, size_t num_hashes, std::vector<uint64_t> words);
+
+    void add(const char* data, size_t len) { add_hash(hash_key(data, len)); }
+    bool might_contain(const char* data, size_t len) const {
+        return might_contain_hash(hash_key(data, len));
+    }
+
+    void add_hash(const KeyHash& hash);
+    void add_hash_concurrent(const KeyHash& hash);
+    bool might_contain_hash(const KeyHash& hash) const {
+        return block_contains(&words_[block_index(hash) * BLOCK_WORDS], hash, num_hashes_);
+    }
+
+    size_t block_index(const KeyHash& hash) const { return reduce64(hash.h1, num_blocks_); }
+    // Membership test against one block's words; shared with DiskBloomFilter
+    static bool block_contains(const uint64_t* block, const KeyHash& hash, size_t num_hashes);
+
+    // Blocked layout of the filter file format (see filter_file.h)
+    void save(const std::string& path) const;
+    static BlockedBloomFilter load(const std::string& path);
+
+    // Accessors
+    size_t get_num_blocks() const { return num_blocks_; }
+    size_t get_num_bits() const { return num_blocks_ * BLOCK_BITS; }
+    size_t get_num_hashes() const { return num_hashes_; }
+    const std::vector<uint64_t>& get_words() const { return words_; }
+
+private:
+    size_t num_blocks_;
+    size_t num_hashes_;
+    std::vector<uint64_t> words_;
+};
+
+#endif // BLOCKED_BLOOM_FILTER_H
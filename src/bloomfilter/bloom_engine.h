@@ -0,0 +1,312 @@
+#ifndef BLOOM_ENGINE_H
+#define BLOOM_ENGINE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "atomics.h"
+#include "filter_layout.h"
+#include "hash_schemes.h"
+#include "hashing.h"
+#include "prefetch.h"
+
+// Header-only core of the Bloom filters, assembled from four policies:
+//
+//   Hash         key bytes -> KeyHash (h1, h2)
+//   Layout       KeyHash -> k bit positions, using an Index policy to map
+//                hashes onto ranges
+//   Word         storage word (uint64_t or uint32_t); the array has the
+//                same bytes either way on little-endian hosts
+//   Concurrency  plain or relaxed-atomic bit setting
+//
+// Each BloomEngine<Hash, Layout, Word, Concurrency> compiles to its own
+// inlined probe loop with no virtual calls. BloomFilter (bloom_filter.h) is
+// the runtime-configured wrapper. It picks a specialization once per call
+// or batch from its layout and hash scheme, using the default Index and Word
+// policies that its files and pickles assume.
+
+// ------- hash policies -------------------------------------------------
+
+// XXH64 under HASH_SEED1 and HASH_SEED2 (hashing.h)
+struct Xxh64PairHash {
+    static constexpr HashScheme ID = HashScheme::Xxh64;
+    static KeyHash hash(const char* data, size_t len) { return hash_key(data, len); }
+};
+
+// Inline short-key paths up to 32 bytes (hash_schemes.h)
+struct ShortKeyHash {
+    static constexpr HashScheme ID = HashScheme::ShortKey;
+    static KeyHash hash(const char* data, size_t len) { return short_key_hash(data, len); }
+};
+
+struct Crc32cHash {
+    static constexpr HashScheme ID = HashScheme::Crc32c;
+    static KeyHash hash(const char* data, size_t len) { return crc32c_hash(data, len); }
+};
+
+// Calls fn with the hash policy of a runtime scheme
+template <typename Fn>
+decltype(auto) visit_hash_scheme(HashScheme scheme, Fn&& fn) {
+    switch (scheme) {
+    case HashScheme::ShortKey: return fn(ShortKeyHash{});
+    case HashScheme::Crc32c: return fn(Crc32cHash{});
+    default: return fn(Xxh64PairHash{});
+    }
+}
+
+// ------- index policies: map a 64-bit hash onto [0, n) -----------------
+
+struct ModuloIndex {
+    static bool valid(uint64_t n) { return n > 0; }
+    static uint64_t map(uint64_t hash, uint64_t n) { return hash % n; }
+};
+
+// Multiply-shift (Lemire): no division; uses the high bits of the hash
+struct FastRangeIndex {
+    static bool valid(uint64_t n) { return n > 0; }
+    static uint64_t map(uint64_t hash, uint64_t n) { return reduce64(hash, n); }
+};
+
+// n must be a power of two
+struct MaskIndex {
+    static bool valid(uint64_t n) { return n > 0 && (n & (n - 1)) == 0; }
+    static uint64_t map(uint64_t hash, uint64_t n) { return hash & (n - 1); }
+};
+
+// ------- layout policies -----------------------------------------------
+//
+// for_each_bit(hash, fn) calls fn(bit) for each of the key's bit positions.
+// It stops when fn returns false, and then returns false. The block layouts
+// always visit every probe, since they all share one cache line.
+
+namespace layout_detail {
+
+inline void check(bool ok, const std::string& what) {
+    if (!ok) throw std::invalid_argument(what);
+}
+
+inline void check_hashes(size_t num_bits, size_t num_hashes) {
+    check(num_bits > 0 && num_hashes > 0, "Invalid parameters: bits and hashes must be > 0");
+}
+
+inline void check_granule(FilterLayout layout, size_t num_bits, size_t granule) {
+    check(num_bits % granule == 0, "num_bits must be a multiple of " + std::to_string(granule) +
+                                       " for the " + filter_layout_name(layout) + " layout");
+}
+
+} // namespace layout_detail
+
+// k probes anywhere, by enhanced double hashing (see README.md)
+template <class Index = ModuloIndex>
+class StandardLayout {
+public:
+    static constexpr FilterLayout ID = FilterLayout::Standard;
+
+    StandardLayout(size_t num_bits, size_t num_hashes) : num_bits_(num_bits), num_hashes_(num_hashes) {
+        layout_detail::check_hashes(num_bits, num_hashes);
+        layout_detail::check(Index::valid(num_bits), "num_bits is invalid for this index policy");
+    }
+
+    size_t num_bits() const { return num_bits_; }
+    size_t num_hashes() const { return num_hashes_; }
+
+    template <typename Fn>
+    bool for_each_bit(const KeyHash& hash, Fn&& fn) const {
+        uint64_t probe = hash.h1;
+        uint64_t step = hash.h2;
+        for (size_t i = 0; i < num_hashes_; ++i) {
+            step += i;
+            if (!fn(Index::map(probe, num_bits_))) return false;
+            probe += step;
+        }
+        return true;
+    }
+
+private:
+    size_t num_bits_;
+    size_t num_hashes_;
+};
+
+// Probe i inside partition i of num_bits / k bits
+template <class Index = FastRangeIndex>
+class PartitionedLayout {
+public:
+    static constexpr FilterLayout ID = FilterLayout::Partitioned;
+
+    PartitionedLayout(size_t num_bits, size_t num_hashes)
+        : num_bits_(num_bits), num_hashes_(num_hashes) {
+        layout_detail::check_hashes(num_bits, num_hashes);
+        layout_detail::check_granule(ID, num_bits, num_hashes);
+        partition_bits_ = num_bits / num_hashes;
+        layout_detail::check(Index::valid(partition_bits_), "partition size is invalid for this index policy");
+    }
+
+    size_t num_bits() const { return num_bits_; }
+    size_t num_hashes() const { return num_hashes_; }
+
+    template <typename Fn>
+    bool for_each_bit(const KeyHash& hash, Fn&& fn) const {
+        uint64_t probe = hash.h1;
+        uint64_t step = hash.h2;
+        for (size_t i = 0; i < num_hashes_; ++i) {
+            step += i;
+            if (!fn(i * partition_bits_ + Index::map(probe, partition_bits_))) return false;
+            probe += step;
+        }
+        return true;
+    }
+
+private:
+    size_t num_bits_;
+    size_t num_hashes_;
+    size_t partition_bits_;
+};
+
+// h1 picks a 512-bit block, k bits inside it from h2 (BlockedBloomFilter)
+template <class Index = FastRangeIndex>
+class BlockedLayout {
+public:
+    static constexpr FilterLayout ID = FilterLayout::Blocked;
+
+    BlockedLayout(size_t num_bits, size_t num_hashes) : num_bits_(num_bits), num_hashes_(num_hashes) {
+        layout_detail::check_hashes(num_bits, num_hashes);
+        layout_detail::check_granule(ID, num_bits, BLOCKED_LAYOUT_BITS);
+        num_blocks_ = num_bits / BLOCKED_LAYOUT_BITS;
+        layout_detail::check(Index::valid(num_blocks_), "block count is invalid for this index policy");
+    }
+
+    size_t num_bits() const { return num_bits_; }
+    size_t num_hashes() const { return num_hashes_; }
+
+    template <typename Fn>
+    bool for_each_bit(const KeyHash& hash, Fn&& fn) const {
+        const uint64_t base = Index::map(hash.h1, num_blocks_) * BLOCKED_LAYOUT_BITS;
+        bool more = true;
+        for_each_block_bit(hash, num_hashes_, [&](uint32_t bit) { more &= fn(base + bit); });
+        return more;
+    }
+
+private:
+    size_t num_bits_;
+    size_t num_hashes_;
+    size_t num_blocks_;
+};
+
+// h1 picks a 256-bit block; one bit in each of its eight 32-bit words (Parquet's salts)
+template <class Index = FastRangeIndex>
+class SplitBlockLayout {
+public:
+    static constexpr FilterLayout ID = FilterLayout::SplitBlock;
+
+    SplitBlockLayout(size_t num_bits, size_t num_hashes) : num_bits_(num_bits) {
+        layout_detail::check_hashes(num_bits, num_hashes);
+        layout_detail::check(num_hashes == SPLIT_BLOCK_LAYOUT_HASHES,
+                             "The split_block layout always uses 8 hashes");
+        layout_detail::check_granule(ID, num_bits, SPLIT_BLOCK_LAYOUT_BITS);
+        num_blocks_ = num_bits / SPLIT_BLOCK_LAYOUT_BITS;
+        layout_detail::check(Index::valid(num_blocks_), "block count is invalid for this index policy");
+    }
+
+    size_t num_bits() const { return num_bits_; }
+    size_t num_hashes() const { return SPLIT_BLOCK_LAYOUT_HASHES; }
+
+    template <typename Fn>
+    bool for_each_bit(const KeyHash& hash, Fn&& fn) const {
+        const uint64_t base = Index::map(hash.h1, num_blocks_) * SPLIT_BLOCK_LAYOUT_BITS;
+        const uint32_t key = static_cast<uint32_t>(hash.h2);
+        bool more = true;
+        for (size_t i = 0; i < SPLIT_BLOCK_LAYOUT_HASHES; ++i) {
+            more &= fn(base + i * 32 + ((key * SPLIT_BLOCK_SALT[i]) >> 27));
+        }
+        return more;
+    }
+
+private:
+    size_t num_bits_;
+    size_t num_blocks_;
+};
+
+// ------- concurrency policies: set one bit, true if it was clear -------
+
+struct SingleThreaded {
+    template <typename Word>
+    static bool set(Word* word, Word mask) {
+        const bool fresh = !(*word & mask);
+        *word |= mask;
+        return fresh;
+    }
+};
+
+// Relaxed atomic OR, skipped when the bit is already set (common once filled)
+struct Concurrent {
+    template <typename Word>
+    static bool set(Word* word, Word mask) {
+        return !(atomic_load_relaxed(word) & mask) && !(atomic_or_relaxed(word, mask) & mask);
+    }
+};
+
+// ------- engine --------------------------------------------------------
+
+template <class Hash = Xxh64PairHash, class Layout = StandardLayout<>, class Word = uint64_t,
+          class Concurrency = SingleThreaded>
+class BloomEngine {
+    static_assert(std::is_same_v<Word, uint64_t> || std::is_same_v<Word, uint32_t>,
+                  "Word must be uint64_t or uint32_t");
+
+public:
+    static constexpr size_t WORD_BITS = sizeof(Word) * 8;
+
+    explicit BloomEngine(const Layout& layout)
+        : layout_(layout), words_(words_for(layout.num_bits()), 0) {}
+    BloomEngine(size_t num_bits, size_t num_hashes) : BloomEngine(Layout(num_bits, num_hashes)) {}
+
+    void add(const char* data, size_t len) { add_hash(Hash::hash(data, len)); }
+    bool might_contain(const char* data, size_t len) const {
+        return might_contain_hash(Hash::hash(data, len));
+    }
+    // Returns the number of bits this call set
+    unsigned add_hash(const KeyHash& hash) { return insert(layout_, words_.data(), hash); }
+    bool might_contain_hash(const KeyHash& hash) const { return test(layout_, words_.data(), hash); }
+    void prefetch_hash(const KeyHash& hash) const { prefetch(layout_, words_.data(), hash); }
+
+    const Layout& layout() const { return layout_; }
+    const std::vector<Word>& words() const { return words_; }
+
+    // Kernels over caller-owned storage of words_for(layout.num_bits()) words;
+    // the BloomFilter wrapper runs these on its own bit array
+    static size_t words_for(size_t num_bits) { return (num_bits + WORD_BITS - 1) / WORD_BITS; }
+
+    static KeyHash hash(const char* data, size_t len) { return Hash::hash(data, len); }
+
+    static unsigned insert(const Layout& layout, Word* words, const KeyHash& hash) {
+        unsigned fresh = 0;
+        layout.for_each_bit(hash, [&](uint64_t bit) {
+            fresh += Concurrency::set(&words[bit / WORD_BITS], Word{1} << (bit % WORD_BITS));
+            return true;
+        });
+        return fresh;
+    }
+
+    static bool test(const Layout& layout, const Word* words, const KeyHash& hash) {
+        return layout.for_each_bit(hash, [words](uint64_t bit) {
+            return ((words[bit / WORD_BITS] >> (bit % WORD_BITS)) & 1) != 0;
+        });
+    }
+
+    static void prefetch(const Layout& layout, const Word* words, const KeyHash& hash) {
+        layout.for_each_bit(hash, [words](uint64_t bit) {
+            prefetch_read(&words[bit / WORD_BITS]);
+            return true;
+        });
+    }
+
+private:
+    Layout layout_;
+    std::vector<Word> words_;
+};
+
+#endif // BLOOM_ENGINE_H
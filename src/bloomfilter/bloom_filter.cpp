@@ -1,39 +1,274 @@
 #include "bloom_filter.h"
+#include "atomics.h"
+#include "batch_hash.h"
+#include "cpu_info.h"
+#include "filter_file.h"
+#include "thread_pool.h"
+#include <atomic>
+#include <cstring>
 #include <stdexcept>
 
-// Constructor for optimal m and k
-BloomFilter::BloomFilter(size_t estimated_num_items,
-                         double false_positive_rate) {
-  if (estimated_num_items == 0 || false_positive_rate <= 0.0 ||
-      false_positive_rate >= 1.0) {
-    throw std::invalid_argument(
-        "Invalid parameters: n must be > 0, p must be between 0 and 1");
+#if (defined(__GNUC__) || defined(__clang__)) && defined(__SSE2__)
+#define BLOOM_FILTER_HAVE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+inline unsigned popcount64(uint64_t x) {
+#if defined(_MSC_VER) && !defined(__clang__)
+  return static_cast<unsigned>(__popcnt64(x));
+#else
+  return static_cast<unsigned>(__builtin_popcountll(x));
+#endif
+}
+
+// Keys per scheduling chunk: the chunk's key bytes plus hashes fill about
+// half of L2, leaving the rest for the probed words
+size_t key_grain(const KeyBatch &keys) {
+  const size_t avg_len = keys.empty() ? 0 : keys.num_bytes() / keys.size();
+  return std::max<size_t>(256, l2_cache_bytes() / 2 / (avg_len + sizeof(KeyHash)));
+}
+
+// Words per chunk for whole-array passes over one or two arrays
+size_t word_grain(size_t arrays) {
+  return std::max<size_t>(1024, l2_cache_bytes() / 2 / (arrays * sizeof(uint64_t)));
+}
+
+// The engine specializations behind each layout BloomFilter can hold; the
+// hash policy only matters to the batch paths
+template <class Layout, class Hash = Xxh64PairHash>
+using PlainKernel = BloomEngine<std::decay_t<Hash>, std::decay_t<Layout>, uint64_t, SingleThreaded>;
+template <class Layout, class Hash = Xxh64PairHash>
+using AtomicKernel = BloomEngine<std::decay_t<Hash>, std::decay_t<Layout>, uint64_t, Concurrent>;
+
+// ------- radix-partitioned insert ---------------------------------------
+//
+// Random bit-sets into an array far larger than the caches miss on nearly
+// every probe, and on the TLB. add_many_partitioned first computes a
+// chunk's probe positions and radix-partitions them by region of the bit
+// array. The scatter goes through one 64-byte write-combining buffer per
+// partition, and each full buffer is written out with non-temporal stores.
+// It then applies one partition at a time. A partition is an L2-sized
+// region, or a run of regions that its list is sorted by first, so the
+// bit-sets hit cache.
+
+// Partitions per scatter pass: 1024 buffers of 64 bytes stay in L1 and L2
+constexpr unsigned MAX_PARTITION_SHIFT = 10;
+// 32-bit in-partition offsets per write-combining buffer (one cache line)
+constexpr size_t WC_ENTRIES = 16;
+// Scratch for all workers together, unless the caller passes memory_bytes.
+// Each key in a chunk holds a KeyHash and 4 bytes per probe.
+constexpr size_t DEFAULT_PARTITION_MEMORY = size_t{256} << 20;
+// Fewest keys per worker per pass, so the per-partition work of a pass
+// stays small next to the scatter; this floor may exceed the budget
+constexpr size_t MIN_PARTITION_CHUNK_KEYS = size_t{1} << 16;
+
+unsigned log2_floor(uint64_t x) {
+  unsigned r = 0;
+  while (x >>= 1) ++r;
+  return r;
+}
+
+struct PartitionPlan {
+  unsigned region_shift;    // log2 of the bits in an L2-sized region
+  unsigned partition_shift; // log2 of the bits per scatter partition
+  size_t partitions;
+};
+
+PartitionPlan plan_partitions(size_t num_bits) {
+  PartitionPlan plan;
+  // Half of L2 per region, as for the batch chunks; at least 64 KiB
+  plan.region_shift = log2_floor(std::max<size_t>(l2_cache_bytes() / 2, 64 * 1024) * 8);
+  const unsigned total_shift = num_bits > 1 ? log2_floor(num_bits - 1) + 1 : 0;
+  plan.partition_shift =
+      std::max(plan.region_shift,
+               total_shift > MAX_PARTITION_SHIFT ? total_shift - MAX_PARTITION_SHIFT : 0);
+  plan.partitions = ((num_bits - 1) >> plan.partition_shift) + 1;
+  return plan;
+}
+
+struct alignas(64) WcBuffer {
+  uint32_t entries[WC_ENTRIES];
+};
+
+// One worker's partitioned chunk; the buffers are reused across passes
+struct PartitionedChunk {
+  std::vector<KeyHash> hashes;
+  std::vector<size_t> first; // start of each partition's list
+  std::vector<size_t> end;   // end of each partition's list
+  std::vector<uint32_t> offsets;
+  std::vector<WcBuffer> buffers;
+};
+
+inline void flush_line(uint32_t *dst, const WcBuffer &buffer) {
+#ifdef BLOOM_FILTER_HAVE_SSE2
+  // Lists start 64 bytes apart from a 16-byte aligned base
+  auto *out = reinterpret_cast<__m128i *>(dst);
+  const auto *in = reinterpret_cast<const __m128i *>(buffer.entries);
+  for (int i = 0; i < 4; ++i) _mm_stream_si128(out + i, _mm_load_si128(in + i));
+#else
+  std::memcpy(dst, buffer.entries, sizeof(WcBuffer));
+#endif
+}
+
+// Hash keys [begin, end) and leave their probes' in-partition offsets in
+// per-partition lists of `chunk`
+template <class Hash, class Layout>
+void scatter_probes(const Layout &layout, const PartitionPlan &plan, const KeyBatch &keys,
+                    size_t begin, size_t end, PartitionedChunk &chunk) {
+  const size_t n = end - begin;
+  const unsigned shift = plan.partition_shift;
+  chunk.hashes.resize(n);
+  for (size_t start = 0; start < n; start += HASH_BLOCK) {
+    hash_batch<Hash>(keys, begin + start, std::min(HASH_BLOCK, n - start),
+                     chunk.hashes.data() + start);
+  }
+
+  // Probes per partition. Lists start on whole buffers, so every flush is
+  // one aligned line.
+  std::vector<size_t> &first = chunk.first;
+  first.assign(plan.partitions + 1, 0);
+  for (size_t i = 0; i < n; ++i) {
+    layout.for_each_bit(chunk.hashes[i], [&](uint64_t bit) {
+      ++first[(bit >> shift) + 1];
+      return true;
+    });
+  }
+  for (size_t p = 0; p < plan.partitions; ++p) {
+    first[p + 1] = first[p] + (first[p + 1] + WC_ENTRIES - 1) / WC_ENTRIES * WC_ENTRIES;
+  }
+
+  std::vector<size_t> &cursor = chunk.end;
+  cursor.assign(first.begin(), first.end() - 1);
+  chunk.offsets.resize(first[plan.partitions]);
+  chunk.buffers.resize(plan.partitions);
+  uint32_t *offsets = chunk.offsets.data();
+  WcBuffer *buffers = chunk.buffers.data();
+  const uint64_t mask = (uint64_t{1} << shift) - 1;
+  for (size_t i = 0; i < n; ++i) {
+    layout.for_each_bit(chunk.hashes[i], [&](uint64_t bit) {
+      const size_t p = bit >> shift;
+      const size_t slot = cursor[p]++ % WC_ENTRIES;
+      buffers[p].entries[slot] = static_cast<uint32_t>(bit & mask);
+      if (slot == WC_ENTRIES - 1) flush_line(offsets + cursor[p] - WC_ENTRIES, buffers[p]);
+      return true;
+    });
+  }
+#ifdef BLOOM_FILTER_HAVE_SSE2
+  _mm_sfence();
+#endif
+  for (size_t p = 0; p < plan.partitions; ++p) {
+    const size_t tail = cursor[p] % WC_ENTRIES;
+    if (tail) std::memcpy(offsets + cursor[p] - tail, buffers[p].entries, tail * sizeof(uint32_t));
   }
-  calculate_optimal_params(estimated_num_items, false_positive_rate);
-  initialize_bits();
 }
 
-// Constructor for explicit m and k
-BloomFilter::BloomFilter(size_t num_bits, size_t num_hashes)
-    : num_bits_(num_bits), num_hashes_(num_hashes) {
-  if (num_bits_ == 0 || num_hashes_ == 0) {
-    throw std::invalid_argument(
-        "Invalid parameters: bits and hashes must be > 0");
+// Set the bits at `offsets` (relative to `words`); returns the number newly
+// set. The caller owns the partition, so plain ORs suffice.
+uint64_t apply_offsets(uint64_t *words, const uint32_t *offsets, size_t count) {
+  uint64_t fresh = 0;
+  for (size_t i = 0; i < count; ++i) {
+    fresh += SingleThreaded::set(&words[offsets[i] / 64], uint64_t{1} << (offsets[i] % 64));
   }
-  initialize_bits();
+  return fresh;
 }
 
+} // namespace
+
+// Constructor for optimal m and k
+BloomFilter::BloomFilter(size_t estimated_num_items,
+                         double false_positive_rate, HashScheme hash_scheme)
+    : BloomFilter(optimal_layout(estimated_num_items, false_positive_rate), {}, hash_scheme) {}
+
+// Constructor for explicit m and k
+BloomFilter::BloomFilter(size_t num_bits, size_t num_hashes, HashScheme hash_scheme)
+    : BloomFilter(FilterLayout::Standard, num_bits, num_hashes, hash_scheme) {}
+
 // Constructor for deserialization
 BloomFilter::BloomFilter(size_t num_bits, size_t num_hashes,
                          const std::vector<uint64_t> &bits_data)
-    : num_bits_(num_bits), num_hashes_(num_hashes), bits_(bits_data) {
-  if (num_bits_ == 0 || num_hashes_ == 0 ||
-      bits_data.size() != (num_bits_ + 63) / 64) {
+    : BloomFilter(FilterLayout::Standard, num_bits, num_hashes, bits_data) {}
+
+BloomFilter::BloomFilter(FilterLayout layout, size_t num_bits, size_t num_hashes,
+                         HashScheme hash_scheme)
+    : BloomFilter(make_layout(layout, num_bits, num_hashes), {}, hash_scheme) {}
+
+BloomFilter::BloomFilter(FilterLayout layout, size_t num_bits, size_t num_hashes,
+                         const std::vector<uint64_t> &bits_data, HashScheme hash_scheme)
+    : BloomFilter(make_layout(layout, num_bits, num_hashes), bits_data, hash_scheme) {
+  if (bits_data.empty()) {
     throw std::invalid_argument("Invalid data for BloomFilter restoration");
   }
 }
 
-void BloomFilter::calculate_optimal_params(size_t n, double p) {
+// Every constructor ends here; empty bits means a new, clear filter
+BloomFilter::BloomFilter(const Layout &layout, std::vector<uint64_t> bits,
+                         HashScheme hash_scheme)
+    : layout_(layout), hash_scheme_(hash_scheme), bits_(std::move(bits)) {
+  std::visit([this](const auto &l) {
+    num_bits_ = l.num_bits();
+    num_hashes_ = l.num_hashes();
+  }, layout_);
+  const size_t words = (num_bits_ + 63) / 64;
+  if (bits_.empty()) {
+    bits_.assign(words, 0);
+    BLOOM_METRIC(metrics_.reset(num_bits_, nullptr);)
+  } else if (bits_.size() != words) {
+    throw std::invalid_argument("Invalid data for BloomFilter restoration");
+  } else {
+    BLOOM_METRIC(metrics_.reset(num_bits_, bits_.data());) // counted on first read
+  }
+}
+
+#ifdef BLOOMFILTER_METRICS
+BloomFilter::BloomFilter(const BloomFilter &other)
+    : layout_(other.layout_), hash_scheme_(other.hash_scheme_), bits_(other.bits_),
+      num_bits_(other.num_bits_), num_hashes_(other.num_hashes_) {
+  metrics_.reset(num_bits_, bits_.data());
+}
+
+BloomFilter &BloomFilter::operator=(const BloomFilter &other) {
+  if (this != &other) *this = BloomFilter(other);
+  return *this;
+}
+
+// The old counters unregister before the bit array they read is freed
+BloomFilter &BloomFilter::operator=(BloomFilter &&other) noexcept {
+  metrics_ = std::move(other.metrics_);
+  layout_ = std::move(other.layout_);
+  hash_scheme_ = other.hash_scheme_;
+  bits_ = std::move(other.bits_);
+  num_bits_ = other.num_bits_;
+  num_hashes_ = other.num_hashes_;
+  return *this;
+}
+#endif
+
+BloomFilter::Layout BloomFilter::make_layout(FilterLayout layout, size_t num_bits,
+                                             size_t num_hashes) {
+  switch (layout) {
+  case FilterLayout::Standard: return StandardLayout<>(num_bits, num_hashes);
+  case FilterLayout::Blocked: return BlockedLayout<>(num_bits, num_hashes);
+  case FilterLayout::SplitBlock: return SplitBlockLayout<>(num_bits, num_hashes);
+  case FilterLayout::Partitioned: return PartitionedLayout<>(num_bits, num_hashes);
+  }
+  throw std::invalid_argument("Unknown filter layout");
+}
+
+BloomFilter BloomFilter::tuned(size_t estimated_num_items, size_t memory_bytes,
+                               double false_positive_rate, TuneObjective objective,
+                               HashScheme hash_scheme) {
+  const TunedConfig config =
+      tune_filter(estimated_num_items, memory_bytes, false_positive_rate, objective);
+  return BloomFilter(config.layout, config.num_bits, config.num_hashes, hash_scheme);
+}
+
+StandardLayout<> BloomFilter::optimal_layout(size_t n, double p) {
+  if (n == 0 || p <= 0.0 || p >= 1.0) {
+    throw std::invalid_argument(
+        "Invalid parameters: n must be > 0, p must be between 0 and 1");
+  }
   // Optimal bits: m = -n*ln(p)/(ln(2)²)
   static constexpr double LN2_SQUARED = 0.480453013918201; // ln(2)²
   double m_bits = -static_cast<double>(n) * std::log(p) / LN2_SQUARED;
@@ -42,21 +277,21 @@ void BloomFilter::calculate_optimal_params(size_t n, double p) {
     throw std::overflow_error("Required bits exceeds size_t limit");
   }
 
-  num_bits_ = static_cast<size_t>(std::ceil(m_bits));
-  num_bits_ = std::max<size_t>(1, num_bits_);
+  size_t num_bits = static_cast<size_t>(std::ceil(m_bits));
+  num_bits = std::max<size_t>(1, num_bits);
 
   // Optimal hash functions: k = (m/n)*ln(2)
   static constexpr double LN2 = 0.693147180559945; // ln(2)
-  double k_hashes = (static_cast<double>(num_bits_) / n) * LN2;
+  double k_hashes = (static_cast<double>(num_bits) / n) * LN2;
 
-  num_hashes_ = static_cast<size_t>(std::ceil(k_hashes));
-  num_hashes_ = std::clamp<size_t>(num_hashes_, 1,
-                                   16); // Cap at 16 for practical efficiency
+  size_t num_hashes = static_cast<size_t>(std::ceil(k_hashes));
+  num_hashes = std::clamp<size_t>(num_hashes, 1,
+                                  16); // Cap at 16 for practical efficiency
+  return StandardLayout<>(num_bits, num_hashes);
 }
 
-void BloomFilter::initialize_bits() {
-  size_t num_blocks = (num_bits_ + 63) / 64;
-  bits_.assign(num_blocks, 0);
+FilterLayout BloomFilter::get_layout() const {
+  return std::visit([](const auto &l) { return std::decay_t<decltype(l)>::ID; }, layout_);
 }
 
 void BloomFilter::add(const std::string &item) {
@@ -64,25 +299,33 @@ void BloomFilter::add(const std::string &item) {
 }
 
 void BloomFilter::add(const char *data, size_t len) {
-  const uint64_t h1_initial = XXH64(data, len, SEED1);
-  const uint64_t h2_initial = XXH64(data, len, SEED2);
-
-  uint64_t current_probe_hash = h1_initial;
-  uint64_t current_step_val = h2_initial;
+  add_hash(hash(data, len));
+}
 
-  for (size_t i = 0; i < num_hashes_; ++i) {
-    // Enhanced double hashing (see README.md)
-    // 1. Update delta (current_step_val)
-    current_step_val += i; // accumulates 'i' in each iteration
+void BloomFilter::add_hash(const KeyHash &hash) {
+  const unsigned new_bits = std::visit([&](const auto &layout) {
+    return PlainKernel<decltype(layout)>::insert(layout, bits_.data(), hash);
+  }, layout_);
+  BLOOM_METRIC(metrics_->on_adds(1, new_bits);)
+  (void)new_bits;
+}
 
-    const size_t bit_index = current_probe_hash % num_bits_;
+bool BloomFilter::add_hash_concurrent(const KeyHash &hash) {
+  const unsigned new_bits = set_bits_concurrent(hash);
+  BLOOM_METRIC(metrics_->on_adds(1, new_bits);)
+  return new_bits != 0;
+}
 
-    // Set the bit
-    bits_[bit_index >> 6] |= (1ULL << (bit_index & 63));
+unsigned BloomFilter::set_bits_concurrent(const KeyHash &hash) {
+  return std::visit([&](const auto &layout) {
+    return AtomicKernel<decltype(layout)>::insert(layout, bits_.data(), hash);
+  }, layout_);
+}
 
-    // Update probe hash for the next iteration
-    current_probe_hash += current_step_val;
-  }
+void BloomFilter::prefetch_hash(const KeyHash &hash) const {
+  std::visit([&](const auto &layout) {
+    PlainKernel<decltype(layout)>::prefetch(layout, bits_.data(), hash);
+  }, layout_);
 }
 
 bool BloomFilter::might_contain(const std::string &item) const {
@@ -90,26 +333,174 @@ bool BloomFilter::might_contain(const std::string &item) const {
 }
 
 bool BloomFilter::might_contain(const char *data, size_t len) const {
-  const uint64_t h1_initial = XXH64(data, len, SEED1);
-  const uint64_t h2_initial = XXH64(data, len, SEED2);
+  return might_contain_hash(hash(data, len));
+}
 
-  uint64_t current_probe_hash = h1_initial;
-  uint64_t current_step_val = h2_initial; // This is the 'delta'
+bool BloomFilter::might_contain_hash(const KeyHash &hash) const {
+  const bool found = test_bits(hash);
+  BLOOM_METRIC(metrics_->on_queries(1, found);)
+  return found;
+}
 
-  for (size_t i = 0; i < num_hashes_; ++i) {
-    // Enhanced double hashing: update delta (current_step_val)
-    current_step_val += i;
+bool BloomFilter::test_bits(const KeyHash &hash) const {
+  return std::visit([&](const auto &layout) {
+    return PlainKernel<decltype(layout)>::test(layout, bits_.data(), hash);
+  }, layout_);
+}
 
-    const size_t bit_index = current_probe_hash % num_bits_;
-    const size_t block_index = bit_index >> 6; // / 64
-    const size_t bit_offset = bit_index & 63;  // % 64
+// Batches dispatch on the layout and hash scheme once, outside the per-key loop
+void BloomFilter::add_many(const KeyBatch &keys, size_t threads) {
+  BLOOM_METRIC(FilterMetrics::BatchScope scope(*metrics_, FilterMetrics::ADD_BATCH, keys.size());)
+  visit_hash_scheme(hash_scheme_, [&](auto hash_policy) {
+    std::visit([&](const auto &layout) {
+      using Kernel = AtomicKernel<decltype(layout), decltype(hash_policy)>;
+      uint64_t *bits = bits_.data();
+      parallel_for(keys.size(), key_grain(keys), threads, [&](size_t begin, size_t end) {
+        uint64_t new_bits = 0;
+        KeyHash hashes[HASH_BLOCK];
+        for (size_t start = begin; start < end; start += HASH_BLOCK) {
+          const size_t m = std::min(HASH_BLOCK, end - start);
+          hash_batch<decltype(hash_policy)>(keys, start, m, hashes);
+          for (size_t j = 0; j < m; ++j) new_bits += Kernel::insert(layout, bits, hashes[j]);
+        }
+        BLOOM_METRIC(metrics_->on_adds(end - begin, new_bits);)
+        (void)new_bits;
+      });
+    }, layout_);
+  });
+}
 
-    if (!(bits_[block_index] & (1ULL << bit_offset))) {
-      return false; // Early exit
-    }
+void BloomFilter::add_many_partitioned(const KeyBatch &keys, size_t threads,
+                                       size_t memory_bytes) {
+  BLOOM_METRIC(FilterMetrics::BatchScope scope(*metrics_, FilterMetrics::ADD_BATCH, keys.size());)
+  const PartitionPlan plan = plan_partitions(num_bits_);
+  const size_t workers = resolve_threads(threads);
+  // Split the scratch budget between the workers, and give no worker more
+  // keys than its share of the batch
+  const size_t budget = memory_bytes ? memory_bytes : DEFAULT_PARTITION_MEMORY;
+  const size_t key_bytes = sizeof(KeyHash) + num_hashes_ * sizeof(uint32_t);
+  const size_t chunk_keys =
+      std::max<size_t>(1, std::min(std::max(MIN_PARTITION_CHUNK_KEYS, budget / workers / key_bytes),
+                                   (keys.size() + workers - 1) / workers));
+  std::vector<PartitionedChunk> chunks(workers);
+  visit_hash_scheme(hash_scheme_, [&](auto hash_policy) {
+    std::visit([&](const auto &layout) {
+      uint64_t *bits = bits_.data();
+      for (size_t base = 0; base < keys.size(); base += workers * chunk_keys) {
+        const size_t pass_end = std::min(keys.size(), base + workers * chunk_keys);
+        const size_t used = (pass_end - base + chunk_keys - 1) / chunk_keys;
+        parallel_for(used, 1, threads, [&](size_t w_begin, size_t w_end) {
+          for (size_t w = w_begin; w < w_end; ++w) {
+            const size_t begin = base + w * chunk_keys;
+            scatter_probes<decltype(hash_policy)>(layout, plan, keys, begin,
+                                                  std::min(pass_end, begin + chunk_keys),
+                                                  chunks[w]);
+          }
+        });
+        // Each partition is applied by one thread, from every worker's list
+        const size_t sub_regions = size_t{1} << (plan.partition_shift - plan.region_shift);
+        parallel_for(plan.partitions, 1, threads, [&](size_t p_begin, size_t p_end) {
+          std::vector<size_t> sub_first(sub_regions + 1);
+          std::vector<uint32_t> sorted;
+          uint64_t new_bits = 0;
+          for (size_t p = p_begin; p < p_end; ++p) {
+            uint64_t *words = bits + (uint64_t{p} << plan.partition_shift) / 64;
+            for (size_t w = 0; w < used; ++w) {
+              const uint32_t *list = chunks[w].offsets.data() + chunks[w].first[p];
+              const size_t count = chunks[w].end[p] - chunks[w].first[p];
+              if (sub_regions == 1) {
+                new_bits += apply_offsets(words, list, count);
+                continue;
+              }
+              // A partition spanning several regions is sorted by region first
+              std::fill(sub_first.begin(), sub_first.end(), 0);
+              for (size_t i = 0; i < count; ++i) ++sub_first[(list[i] >> plan.region_shift) + 1];
+              for (size_t r = 0; r < sub_regions; ++r) sub_first[r + 1] += sub_first[r];
+              sorted.resize(count);
+              for (size_t i = 0; i < count; ++i) {
+                sorted[sub_first[list[i] >> plan.region_shift]++] = list[i];
+              }
+              new_bits += apply_offsets(words, sorted.data(), count);
+            }
+          }
+          BLOOM_METRIC(metrics_->on_new_bits(new_bits);)
+          (void)new_bits;
+        });
+        BLOOM_METRIC(metrics_->on_adds(pass_end - base, 0);)
+      }
+    }, layout_);
+  });
+}
 
-    // Update probe hash for the next iteration
-    current_probe_hash += current_step_val;
+void BloomFilter::might_contain_many(const KeyBatch &keys, uint8_t *out,
+                                     size_t threads) const {
+  BLOOM_METRIC(FilterMetrics::BatchScope scope(*metrics_, FilterMetrics::QUERY_BATCH, keys.size());)
+  visit_hash_scheme(hash_scheme_, [&](auto hash_policy) {
+    std::visit([&](const auto &layout) {
+      using Kernel = PlainKernel<decltype(layout), decltype(hash_policy)>;
+      const uint64_t *bits = bits_.data();
+      parallel_for(keys.size(), key_grain(keys), threads, [&](size_t begin, size_t end) {
+        uint64_t positives = 0;
+        KeyHash hashes[HASH_BLOCK];
+        for (size_t start = begin; start < end; start += HASH_BLOCK) {
+          const size_t m = std::min(HASH_BLOCK, end - start);
+          hash_batch<decltype(hash_policy)>(keys, start, m, hashes);
+          for (size_t j = 0; j < m; ++j) {
+            out[start + j] = Kernel::test(layout, bits, hashes[j]);
+            positives += out[start + j];
+          }
+        }
+        BLOOM_METRIC(metrics_->on_queries(end - begin, positives);)
+        (void)positives;
+      });
+    }, layout_);
+  });
+}
+
+void BloomFilter::union_with(const BloomFilter &other, size_t threads) {
+  if (layout_.index() != other.layout_.index() || hash_scheme_ != other.hash_scheme_ ||
+      num_bits_ != other.num_bits_ || num_hashes_ != other.num_hashes_) {
+    throw std::invalid_argument(
+        "Cannot union BloomFilters with different parameters");
   }
-  return true;
+  uint64_t *dst = bits_.data();
+  const uint64_t *src = other.bits_.data();
+  parallel_for(bits_.size(), word_grain(2), threads, [&](size_t begin, size_t end) {
+    uint64_t new_bits = 0;
+    for (size_t w = begin; w < end; ++w) {
+      // Atomic only where new bits arrive: concurrent add_many stays safe
+      if (src[w] & ~atomic_load_relaxed(&dst[w])) {
+        new_bits += popcount64(src[w] & ~atomic_or_relaxed(&dst[w], src[w]));
+      }
+    }
+    BLOOM_METRIC(metrics_->on_new_bits(new_bits);)
+    (void)new_bits;
+  });
+}
+
+size_t BloomFilter::count_set_bits(size_t threads) const {
+  std::atomic<size_t> total{0};
+  const uint64_t *words = bits_.data();
+  parallel_for(bits_.size(), word_grain(1), threads, [&](size_t begin, size_t end) {
+    size_t count = 0;
+    for (size_t w = begin; w < end; ++w) count += popcount64(words[w]);
+    total.fetch_add(count, std::memory_order_relaxed);
+  });
+  return total.load();
+}
+
+void BloomFilter::save(const std::string &path) const {
+  FilterFileHeader header;
+  header.layout = get_layout();
+  header.hash_scheme = hash_scheme_;
+  header.num_hashes = static_cast<uint32_t>(num_hashes_);
+  header.num_bits = num_bits_;
+  write_filter_file(path, header, bits_);
+}
+
+BloomFilter BloomFilter::load(const std::string &path) {
+  FilterFileHeader header;
+  std::vector<uint64_t> words = read_filter_file(path, header);
+  return BloomFilter(header.layout, header.num_bits, header.num_hashes, words,
+                     header.hash_scheme);
 }
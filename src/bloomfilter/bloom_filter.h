@@ -8,15 +8,49 @@
 #include <cmath>
 #include <limits>
 #include <algorithm> // For std::clamp
+#include <variant>
 
-#include "xxhash.h"
+#include "bloom_engine.h"
+#include "filter_layout.h"
+#include "hash_schemes.h"
+#include "hashing.h"
+#include "key_batch.h"
+#include "metrics.h"
+#include "tuner.h"
 
+// Runtime-configured filter over the policy engine (bloom_engine.h): the
+// layout is chosen at construction, and each call or batch dispatches once
+// to that layout's inlined kernels
 class BloomFilter {
 public:
-    // Constructors with original signatures preserved
-    BloomFilter(size_t estimated_num_items, double false_positive_rate);
-    BloomFilter(size_t num_bits, size_t num_hashes);
+    // Layouts a BloomFilter can hold, with the default index policies
+    using Layout = std::variant<StandardLayout<>, BlockedLayout<>, SplitBlockLayout<>,
+                                PartitionedLayout<>>;
+
+    // Constructors with original signatures preserved. The hash scheme (see
+    // hash_schemes.h) defaults to the XXH64 pair every other structure uses.
+    BloomFilter(size_t estimated_num_items, double false_positive_rate,
+                HashScheme hash_scheme = HashScheme::Xxh64);
+    BloomFilter(size_t num_bits, size_t num_hashes, HashScheme hash_scheme = HashScheme::Xxh64);
     BloomFilter(size_t num_bits, size_t num_hashes, const std::vector<uint64_t>& bits_data);
+    // Explicit layout; num_bits must suit it (see layout_granule in filter_layout.h)
+    BloomFilter(FilterLayout layout, size_t num_bits, size_t num_hashes,
+                HashScheme hash_scheme = HashScheme::Xxh64);
+    BloomFilter(FilterLayout layout, size_t num_bits, size_t num_hashes,
+                const std::vector<uint64_t>& bits_data, HashScheme hash_scheme = HashScheme::Xxh64);
+
+#ifdef BLOOMFILTER_METRICS
+    // A copy gets fresh counters over its own bits
+    BloomFilter(const BloomFilter& other);
+    BloomFilter& operator=(const BloomFilter& other);
+    BloomFilter(BloomFilter&&) = default;
+    BloomFilter& operator=(BloomFilter&& other) noexcept;
+#endif
+
+    // Layout, k and size picked by tune_filter (see tuner.h) for this host
+    static BloomFilter tuned(size_t estimated_num_items, size_t memory_bytes,
+                             double false_positive_rate, TuneObjective objective,
+                             HashScheme hash_scheme = HashScheme::Xxh64);
 
     // Core methods
     void add(const std::string& item);
@@ -24,21 +58,78 @@ public:
     bool might_contain(const std::string& item) const;
     bool might_contain(const char* data, size_t len) const;
 
+    // The filter's base hashes of a key, under its hash scheme
+    KeyHash hash(const char* data, size_t len) const {
+        return hash_with_scheme(hash_scheme_, data, len);
+    }
+
+    // Same operations from precomputed base hashes (see hashing.h), so other
+    // structures can share one hash computation with the filter. Hashes must
+    // come from hash() unless the scheme is HashScheme::Xxh64 (hash_key).
+    void add_hash(const KeyHash& hash);
+    bool might_contain_hash(const KeyHash& hash) const;
+    // Safe against other threads adding to the same filter at the same time.
+    // Returns true if this call set at least one bit (the key was new).
+    bool add_hash_concurrent(const KeyHash& hash);
+    // Start loading the words probed for `hash`; batch kernels issue this a
+    // group of keys ahead so the misses overlap
+    void prefetch_hash(const KeyHash& hash) const;
+
+    // Batch operations, spread over the thread pool. `threads` follows
+    // parallel_for: 0 = global setting (set_num_threads), 1 = caller only.
+    // add_many sets bits atomically, so concurrent calls on one filter are safe.
+    void add_many(const KeyBatch& keys, size_t threads = 0);
+    // Bulk load for filters much larger than the last-level cache. Probe
+    // positions are radix-partitioned by L2-sized region of the bit array,
+    // then set region by region, so random DRAM writes become cache hits.
+    // Sets the same bits as add_many. Each region has a single writer and
+    // plain ORs, so no other thread may add to the filter during the call.
+    // Keys go through in passes; all workers' scratch together takes about
+    // (16 + 4 * num_hashes) bytes per key in a pass and stays within
+    // memory_bytes (0 = 256 MB), but never below 64K keys per worker.
+    void add_many_partitioned(const KeyBatch& keys, size_t threads = 0,
+                              size_t memory_bytes = 0);
+    void might_contain_many(const KeyBatch& keys, uint8_t* out, size_t threads = 0) const;
+    // this |= other; both filters must share layout, hash scheme, num_bits
+    // and num_hashes
+    void union_with(const BloomFilter& other, size_t threads = 0);
+    size_t count_set_bits(size_t threads = 0) const;
+
+    // Filter file format (see filter_file.h), tagged with the filter's layout
+    // and hash scheme
+    void save(const std::string& path) const;
+    static BloomFilter load(const std::string& path);
+
     // Accessors 
+    FilterLayout get_layout() const;
+    HashScheme get_hash_scheme() const { return hash_scheme_; }
     size_t get_num_bits() const { return num_bits_; }
     size_t get_num_hashes() const { return num_hashes_; }
     const std::vector<uint64_t>& get_raw_bits_vector() const { return bits_; }
 
-private:
-    void calculate_optimal_params(size_t n, double p);
-    void initialize_bits();
+#ifdef BLOOMFILTER_METRICS
+    FilterMetrics& metrics() const { return *metrics_; }
+#endif
 
-    static constexpr uint64_t SEED1 = 0x5F0D42B1A956789FULL;
-    static constexpr uint64_t SEED2 = 0x9B1A75C3E0D6F2A7ULL;
+    // Layout policy for a runtime layout id; throws std::invalid_argument
+    // if num_bits or num_hashes do not suit it
+    static Layout make_layout(FilterLayout layout, size_t num_bits, size_t num_hashes);
+    // Standard layout of m bits and k hashes for n items at false positive
+    // rate p, as used by BloomFilter(n, p); allocates nothing
+    static StandardLayout<> optimal_layout(size_t n, double p);
+
+private:
+    BloomFilter(const Layout& layout, std::vector<uint64_t> bits, HashScheme hash_scheme);
+    // Uninstrumented probes shared by the single-key and batch paths
+    bool test_bits(const KeyHash& hash) const;
+    unsigned set_bits_concurrent(const KeyHash& hash); // returns bits newly set
 
+    Layout layout_;
+    HashScheme hash_scheme_;
     std::vector<uint64_t> bits_;
     size_t num_bits_;
     size_t num_hashes_;
+    BLOOM_METRIC(MetricsHandle metrics_;)
 };
 
 #endif // BLOOM_FILTER_H
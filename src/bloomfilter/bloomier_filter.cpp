@@ -0,0 +1,189 @@
+#include "bloomier_filter.h"
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+
+namespace {
+
+uint64_t rotl64(uint64_t x, unsigned r) { return (x << r) | (x >> (64 - r)); }
+
+// splitmix64 step, yields the per-attempt seeds deterministically
+uint64_t next_seed(uint64_t &state) {
+  uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+  return z ^ (z >> 31);
+}
+
+} // namespace
+
+BloomierFilter::BloomierFilter(const KeyBatch &keys,
+                               const std::vector<uint64_t> &values,
+                               unsigned value_bits)
+    : value_bits_(value_bits), seed_(0) {
+  if (value_bits_ == 0 || value_bits_ > 64) {
+    throw std::invalid_argument("value_bits must be between 1 and 64");
+  }
+  if (keys.size() != values.size()) {
+    throw std::invalid_argument("keys and values must have the same length");
+  }
+  value_mask_ = value_bits_ == 64 ? ~0ULL : (1ULL << value_bits_) - 1;
+
+  // Lookups see only a key's h1, so keys sharing an h1 share their three
+  // cells and can be stored once. Sorting by it drops exact duplicates;
+  // the key bytes tell a key given twice with different values from two
+  // distinct keys whose h1 collides.
+  std::vector<std::pair<uint64_t, uint64_t>> entries(keys.size());
+  std::vector<size_t> order(keys.size());
+  for (size_t i = 0; i < keys.size(); ++i) {
+    if (values[i] & ~value_mask_) {
+      throw std::invalid_argument("Value does not fit in value_bits");
+    }
+    entries[i] = {XXH64(keys.data(i), keys.length(i), HASH_SEED1), values[i]};
+    order[i] = i;
+  }
+  std::sort(order.begin(), order.end(),
+            [&](size_t a, size_t b) { return entries[a] < entries[b]; });
+  std::vector<std::pair<uint64_t, uint64_t>> sorted;
+  sorted.reserve(entries.size());
+  size_t first = 0; // key index of the entry sorted.back() came from
+  for (size_t i : order) {
+    if (!sorted.empty() && sorted.back().first == entries[i].first) {
+      if (sorted.back().second == entries[i].second) continue;
+      throw std::invalid_argument(keys[first] == keys[i]
+                                      ? "Duplicate key with conflicting values"
+                                      : "Distinct keys with colliding hashes need the same value");
+    }
+    sorted.push_back(entries[i]);
+    first = i;
+  }
+  entries = std::move(sorted);
+
+  const size_t n = entries.size();
+  // 1.23n cells suffice for the 3-hypergraph to peel with high probability
+  const size_t capacity = 32 + static_cast<size_t>(1.23 * static_cast<double>(n));
+  segment_length_ = (capacity + 2) / 3;
+  if (segment_length_ > std::numeric_limits<uint32_t>::max()) {
+    throw std::overflow_error("Too many keys for BloomierFilter");
+  }
+  const size_t num_cells = 3 * segment_length_;
+
+  // Per cell: number of keys touching it and xor of their entry indices.
+  // Once the count drops to 1 the xor *is* the remaining key.
+  std::vector<uint32_t> counts(num_cells);
+  std::vector<uint64_t> xors(num_cells);
+  std::vector<size_t> queue;
+  std::vector<std::pair<size_t, uint32_t>> stack; // (entry, cell it owns)
+  queue.reserve(num_cells);
+  stack.reserve(n);
+
+  uint64_t seed_state = HASH_SEED2;
+  for (int attempt = 0; attempt < MAX_BUILD_ATTEMPTS; ++attempt) {
+    seed_ = next_seed(seed_state);
+    std::fill(counts.begin(), counts.end(), 0);
+    std::fill(xors.begin(), xors.end(), 0);
+    queue.clear();
+    stack.clear();
+
+    for (size_t e = 0; e < n; ++e) {
+      const Slots s = slots(entries[e].first);
+      for (uint32_t c : {s.s0, s.s1, s.s2}) {
+        ++counts[c];
+        xors[c] ^= e;
+      }
+    }
+    for (size_t c = 0; c < num_cells; ++c) {
+      if (counts[c] == 1) queue.push_back(c);
+    }
+
+    while (!queue.empty()) {
+      const size_t c = queue.back();
+      queue.pop_back();
+      if (counts[c] != 1) continue; // already peeled via another cell
+      const size_t e = xors[c];
+      stack.emplace_back(e, static_cast<uint32_t>(c));
+      const Slots s = slots(entries[e].first);
+      for (uint32_t other : {s.s0, s.s1, s.s2}) {
+        --counts[other];
+        xors[other] ^= e;
+        if (counts[other] == 1) queue.push_back(other);
+      }
+    }
+
+    if (stack.size() != n) continue; // cyclic core left, retry with new seed
+
+    cells_.assign(words_for(num_cells, value_bits_), 0);
+    // Reverse peel order: each key's owned cell is the last of its three
+    // to be assigned, so it absorbs the xor of the other two (xor-ing the
+    // owned cell in again cancels its own contribution).
+    for (auto it = stack.rbegin(); it != stack.rend(); ++it) {
+      const Slots s = slots(entries[it->first].first);
+      write_cell(it->second, entries[it->first].second ^ read_cell(s.s0) ^
+                                 read_cell(s.s1) ^ read_cell(s.s2) ^
+                                 read_cell(it->second));
+    }
+    return;
+  }
+  throw std::runtime_error("BloomierFilter construction failed to converge");
+}
+
+// Constructor for deserialization
+BloomierFilter::BloomierFilter(unsigned value_bits, size_t segment_length,
+                               uint64_t seed,
+                               const std::vector<uint64_t> &cells_data)
+    : cells_(cells_data), value_bits_(value_bits),
+      segment_length_(segment_length), seed_(seed) {
+  if (value_bits_ == 0 || value_bits_ > 64 || segment_length_ == 0 ||
+      segment_length_ > std::numeric_limits<uint32_t>::max() ||
+      cells_data.size() != words_for(3 * segment_length_, value_bits_)) {
+    throw std::invalid_argument("Invalid data for BloomierFilter restoration");
+  }
+  value_mask_ = value_bits_ == 64 ? ~0ULL : (1ULL << value_bits_) - 1;
+}
+
+uint64_t BloomierFilter::get(const char *data, size_t len) const {
+  return get_hash(XXH64(data, len, HASH_SEED1));
+}
+
+uint64_t BloomierFilter::get_hash(uint64_t key_hash) const {
+  const Slots s = slots(key_hash);
+  return read_cell(s.s0) ^ read_cell(s.s1) ^ read_cell(s.s2);
+}
+
+BloomierFilter::Slots BloomierFilter::slots(uint64_t key_hash) const {
+  const uint64_t h = mix64(key_hash + seed_);
+  const uint32_t len = static_cast<uint32_t>(segment_length_);
+  return {reduce32(static_cast<uint32_t>(h), len),
+          reduce32(static_cast<uint32_t>(rotl64(h, 21)), len) + len,
+          reduce32(static_cast<uint32_t>(rotl64(h, 42)), len) + 2 * len};
+}
+
+size_t BloomierFilter::words_for(size_t num_cells, unsigned value_bits) {
+  // One spare word so a cell straddling the last boundary reads in-bounds
+  return (num_cells * value_bits + 63) / 64 + 1;
+}
+
+uint64_t BloomierFilter::read_cell(size_t i) const {
+  const size_t bit = i * value_bits_;
+  const size_t word = bit >> 6;
+  const unsigned offset = bit & 63;
+  uint64_t v = cells_[word] >> offset;
+  if (offset + value_bits_ > 64) {
+    v |= cells_[word + 1] << (64 - offset);
+  }
+  return v & value_mask_;
+}
+
+void BloomierFilter::write_cell(size_t i, uint64_t value) {
+  const size_t bit = i * value_bits_;
+  const size_t word = bit >> 6;
+  const unsigned offset = bit & 63;
+  value &= value_mask_;
+  cells_[word] = (cells_[word] & ~(value_mask_ << offset)) | (value << offset);
+  if (offset + value_bits_ > 64) {
+    const unsigned spill = 64 - offset;
+    cells_[word + 1] = (cells_[word + 1] & ~(value_mask_ >> spill)) |
+                       (value >> spill);
+  }
+}
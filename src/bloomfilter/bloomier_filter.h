@@ -0,0 +1,54 @@
+#ifndef BLOOMIER_FILTER_H
+#define BLOOMIER_FILTER_H
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+#include "hashing.h"
+#include "key_batch.h"
+
+// Static key -> small value map that stores no keys (xor-based retrieval).
+// Every key maps to three cells, one per segment; its value is the xor of
+// those cells. Uses ~1.23 * value_bits bits per key. Looking up a key that
+// was not in the build set returns an arbitrary value.
+class BloomierFilter {
+public:
+    // Bulk build; values[i] belongs to keys[i] and must fit in value_bits
+    BloomierFilter(const KeyBatch& keys, const std::vector<uint64_t>& values,
+                   unsigned value_bits);
+    // Constructor for deserialization
+    BloomierFilter(unsigned value_bits, size_t segment_length, uint64_t seed,
+                   const std::vector<uint64_t>& cells_data);
+
+    uint64_t get(const char* data, size_t len) const;
+    uint64_t get_hash(uint64_t key_hash) const;
+
+    // Accessors
+    unsigned get_value_bits() const { return value_bits_; }
+    size_t get_segment_length() const { return segment_length_; }
+    size_t get_num_cells() const { return 3 * segment_length_; }
+    uint64_t get_seed() const { return seed_; }
+    size_t size_in_bytes() const { return cells_.size() * sizeof(uint64_t); }
+    const std::vector<uint64_t>& get_raw_cells_vector() const { return cells_; }
+
+private:
+    struct Slots {
+        uint32_t s0, s1, s2;
+    };
+    Slots slots(uint64_t key_hash) const;
+
+    uint64_t read_cell(size_t i) const;
+    void write_cell(size_t i, uint64_t value);
+    static size_t words_for(size_t num_cells, unsigned value_bits);
+
+    static constexpr int MAX_BUILD_ATTEMPTS = 64;
+
+    std::vector<uint64_t> cells_; // value_bits-wide cells, bit-packed
+    unsigned value_bits_;
+    uint64_t value_mask_;
+    size_t segment_length_;
+    uint64_t seed_;
+};
+
+#endif // BLOOMIER_FILTER_H
@@ -0,0 +1,33 @@
+#ifndef BYTE_IO_H
+#define BYTE_IO_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <type_traits>
+
+// Little-endian encoding helpers for the portable serialization formats
+
+template <typename T>
+inline void write_le(std::string& out, T value) {
+    static_assert(std::is_integral<T>::value, "integral types only");
+    using U = typename std::make_unsigned<T>::type;
+    U v = static_cast<U>(value);
+    for (size_t i = 0; i < sizeof(T); ++i) {
+        out.push_back(static_cast<char>(v & 0xFF));
+        v = static_cast<U>(v >> 8);
+    }
+}
+
+template <typename T>
+inline T read_le(const char* data) {
+    static_assert(std::is_integral<T>::value, "integral types only");
+    using U = typename std::make_unsigned<T>::type;
+    U v = 0;
+    for (size_t i = sizeof(T); i-- > 0;) {
+        v = static_cast<U>((v << 8) | static_cast<unsigned char>(data[i]));
+    }
+    return static_cast<T>(v);
+}
+
+#endif // BYTE_IO_H
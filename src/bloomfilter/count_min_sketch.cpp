@@ -0,0 +1,168 @@
+#include "count_min_sketch.h"
+#include "atomics.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <string>
+
+namespace {
+
+uint32_t saturating_add(uint32_t a, uint32_t b) {
+  const uint32_t sum = a + b;
+  return sum < a ? std::numeric_limits<uint32_t>::max() : sum;
+}
+
+} // namespace
+
+CountMinSketch::CountMinSketch(size_t width, size_t depth, bool conservative)
+    : width_(width), depth_(depth), conservative_(conservative), total_count_(0) {
+  if (width_ == 0 || depth_ == 0 || depth_ > MAX_DEPTH) {
+    throw std::invalid_argument(
+        "Invalid parameters: width must be > 0, depth between 1 and 32");
+  }
+  initialize_counters();
+}
+
+CountMinSketch::CountMinSketch(double epsilon, double delta, bool conservative)
+    : conservative_(conservative), total_count_(0) {
+  if (epsilon <= 0.0 || epsilon >= 1.0 || delta <= 0.0 || delta >= 1.0) {
+    throw std::invalid_argument(
+        "Invalid parameters: epsilon and delta must be between 0 and 1");
+  }
+  // w = e / epsilon, d = ln(1 / delta)
+  static constexpr double E = 2.718281828459045;
+  width_ = static_cast<size_t>(std::ceil(E / epsilon));
+  depth_ = std::clamp<size_t>(
+      static_cast<size_t>(std::ceil(std::log(1.0 / delta))), 1, MAX_DEPTH);
+  initialize_counters();
+}
+
+// Constructor for deserialization
+CountMinSketch::CountMinSketch(size_t width, size_t depth, bool conservative,
+                               uint64_t total_count,
+                               const std::vector<uint32_t> &counters_data)
+    : counters_(counters_data), width_(width), depth_(depth),
+      conservative_(conservative), total_count_(total_count) {
+  if (width_ == 0 || depth_ == 0 || depth_ > MAX_DEPTH ||
+      counters_data.size() != width_ * depth_) {
+    throw std::invalid_argument("Invalid data for CountMinSketch restoration");
+  }
+}
+
+void CountMinSketch::initialize_counters() {
+  counters_.assign(width_ * depth_, 0);
+}
+
+void CountMinSketch::row_indices(const KeyHash &hash, size_t *out) const {
+  // Enhanced double hashing, identical probe sequence to BloomFilter
+  uint64_t current_probe_hash = hash.h1;
+  uint64_t current_step_val = hash.h2;
+  for (size_t i = 0; i < depth_; ++i) {
+    current_step_val += i;
+    out[i] = i * width_ + current_probe_hash % width_;
+    current_probe_hash += current_step_val;
+  }
+}
+
+void CountMinSketch::add(const char *data, size_t len, uint32_t count) {
+  add_hash(hash_key(data, len), count);
+}
+
+uint32_t CountMinSketch::estimate(const char *data, size_t len) const {
+  return estimate_hash(hash_key(data, len));
+}
+
+void CountMinSketch::add_with(BloomFilter &bloom, const char *data, size_t len,
+                              uint32_t count) {
+  check_shared_hashing(bloom);
+  const KeyHash hash = hash_key(data, len);
+  bloom.add_hash(hash);
+  add_hash(hash, count);
+}
+
+void CountMinSketch::check_shared_hashing(const BloomFilter &bloom) {
+  if (bloom.get_hash_scheme() != HashScheme::Xxh64) {
+    throw std::invalid_argument(std::string("Cannot share hashes with a BloomFilter using the '") +
+                                hash_scheme_name(bloom.get_hash_scheme()) +
+                                "' hash scheme; only 'xxh64' filters can be passed");
+  }
+}
+
+void CountMinSketch::add_hash(const KeyHash &hash, uint32_t count) {
+  size_t idx[MAX_DEPTH];
+  row_indices(hash, idx);
+  total_count_ += count;
+
+  if (!conservative_) {
+    for (size_t i = 0; i < depth_; ++i) {
+      counters_[idx[i]] = saturating_add(counters_[idx[i]], count);
+    }
+    return;
+  }
+  uint32_t current = std::numeric_limits<uint32_t>::max();
+  for (size_t i = 0; i < depth_; ++i) {
+    current = std::min(current, counters_[idx[i]]);
+  }
+  const uint32_t target = saturating_add(current, count);
+  for (size_t i = 0; i < depth_; ++i) {
+    counters_[idx[i]] = std::max(counters_[idx[i]], target);
+  }
+}
+
+void CountMinSketch::add_hash_concurrent(const KeyHash &hash, uint32_t count) {
+  size_t idx[MAX_DEPTH];
+  row_indices(hash, idx);
+  atomic_add_relaxed(&total_count_, count);
+
+  uint32_t target = 0;
+  if (conservative_) {
+    uint32_t current = std::numeric_limits<uint32_t>::max();
+    for (size_t i = 0; i < depth_; ++i) {
+      current = std::min(current, atomic_load_relaxed(&counters_[idx[i]]));
+    }
+    target = saturating_add(current, count);
+  }
+  for (size_t i = 0; i < depth_; ++i) {
+    uint32_t *counter = &counters_[idx[i]];
+    uint32_t seen = atomic_load_relaxed(counter);
+    for (;;) {
+      const uint32_t desired =
+          conservative_ ? std::max(seen, target) : saturating_add(seen, count);
+      if (desired == seen || atomic_cas_relaxed(counter, seen, desired)) break;
+    }
+  }
+}
+
+uint32_t CountMinSketch::estimate_hash(const KeyHash &hash) const {
+  size_t idx[MAX_DEPTH];
+  row_indices(hash, idx);
+  uint32_t result = std::numeric_limits<uint32_t>::max();
+  for (size_t i = 0; i < depth_; ++i) {
+    result = std::min(result, counters_[idx[i]]);
+  }
+  return result;
+}
+
+void CountMinSketch::add_many(const KeyBatch &keys, const uint32_t *counts,
+                              BloomFilter *bloom, bool concurrent) {
+  if (bloom) check_shared_hashing(*bloom);
+  for (size_t i = 0; i < keys.size(); ++i) {
+    const KeyHash hash = hash_key(keys.data(i), keys.length(i));
+    const uint32_t count = counts ? counts[i] : 1;
+    // The filter may be written by other threads (its own add_many releases
+    // the GIL) whatever `concurrent` says, so its bits are always set atomically
+    if (bloom) bloom->add_hash_concurrent(hash);
+    if (concurrent) {
+      add_hash_concurrent(hash, count);
+    } else {
+      add_hash(hash, count);
+    }
+  }
+}
+
+void CountMinSketch::estimate_many(const KeyBatch &keys, uint32_t *out) const {
+  for (size_t i = 0; i < keys.size(); ++i) {
+    out[i] = estimate_hash(hash_key(keys.data(i), keys.length(i)));
+  }
+}
@@ -0,0 +1,67 @@
+#ifndef COUNT_MIN_SKETCH_H
+#define COUNT_MIN_SKETCH_H
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+#include "bloom_filter.h"
+#include "hashing.h"
+#include "key_batch.h"
+
+// Count-Min sketch whose row indices come from the same h1/h2 enhanced double
+// hashing as BloomFilter, so one hash computation can feed both structures.
+// Conservative update (only raise the counters that hold the current minimum)
+// is on by default and sharply reduces overestimation on skewed streams.
+class CountMinSketch {
+public:
+    // Explicit geometry
+    CountMinSketch(size_t width, size_t depth, bool conservative = true);
+    // Error bounds: estimate <= true + epsilon * total with probability 1 - delta
+    CountMinSketch(double epsilon, double delta, bool conservative = true);
+    // Constructor for deserialization
+    CountMinSketch(size_t width, size_t depth, bool conservative, uint64_t total_count,
+                   const std::vector<uint32_t>& counters_data);
+
+    void add(const char* data, size_t len, uint32_t count = 1);
+    uint32_t estimate(const char* data, size_t len) const;
+
+    // Count the key and insert it into `bloom` from a single hash computation.
+    // The sketch hashes with hash_key, so `bloom` must use HashScheme::Xxh64.
+    void add_with(BloomFilter& bloom, const char* data, size_t len, uint32_t count = 1);
+    // Throws std::invalid_argument unless bloom can share the sketch's hashes
+    static void check_shared_hashing(const BloomFilter& bloom);
+
+    void add_hash(const KeyHash& hash, uint32_t count);
+    uint32_t estimate_hash(const KeyHash& hash) const;
+    // Lock-free variant, safe against concurrent adders on the same sketch
+    void add_hash_concurrent(const KeyHash& hash, uint32_t count);
+
+    // Batch ingest; `counts` may be null (count 1 each), `bloom` may be null.
+    // With `concurrent`, several threads may ingest into the same sketch.
+    // Bits of `bloom` are set atomically either way.
+    void add_many(const KeyBatch& keys, const uint32_t* counts, BloomFilter* bloom,
+                  bool concurrent);
+    void estimate_many(const KeyBatch& keys, uint32_t* out) const;
+
+    // Accessors
+    size_t get_width() const { return width_; }
+    size_t get_depth() const { return depth_; }
+    bool is_conservative() const { return conservative_; }
+    uint64_t get_total_count() const { return total_count_; }
+    const std::vector<uint32_t>& get_raw_counters_vector() const { return counters_; }
+
+private:
+    void initialize_counters();
+    void row_indices(const KeyHash& hash, size_t* out) const;
+
+    static constexpr size_t MAX_DEPTH = 32;
+
+    std::vector<uint32_t> counters_; // depth_ rows of width_ counters
+    size_t width_;
+    size_t depth_;
+    bool conservative_;
+    uint64_t total_count_;
+};
+
+#endif // COUNT_MIN_SKETCH_H
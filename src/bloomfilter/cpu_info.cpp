@@ -0,0 +1,53 @@
+#include "cpu_info.h"
+
+#if defined(__linux__)
+#include <unistd.h>
+#elif defined(__APPLE__)
+#include <sys/sysctl.h>
+#include <sys/types.h>
+#endif
+
+namespace {
+
+constexpr size_t DEFAULT_L2_BYTES = 256 * 1024;
+constexpr size_t DEFAULT_LLC_BYTES = 8 * 1024 * 1024;
+
+size_t detect_l2_cache_bytes() {
+#if defined(__linux__) && defined(_SC_LEVEL2_CACHE_SIZE)
+  const long bytes = sysconf(_SC_LEVEL2_CACHE_SIZE);
+  if (bytes > 0) return static_cast<size_t>(bytes);
+#elif defined(__APPLE__)
+  int64_t bytes = 0;
+  size_t size = sizeof(bytes);
+  if (sysctlbyname("hw.l2cachesize", &bytes, &size, nullptr, 0) == 0 && bytes > 0) {
+    return static_cast<size_t>(bytes);
+  }
+#endif
+  return DEFAULT_L2_BYTES;
+}
+
+size_t detect_llc_cache_bytes() {
+#if defined(__linux__) && defined(_SC_LEVEL3_CACHE_SIZE)
+  const long bytes = sysconf(_SC_LEVEL3_CACHE_SIZE);
+  if (bytes > 0) return static_cast<size_t>(bytes);
+#elif defined(__APPLE__)
+  int64_t bytes = 0;
+  size_t size = sizeof(bytes);
+  if (sysctlbyname("hw.l3cachesize", &bytes, &size, nullptr, 0) == 0 && bytes > 0) {
+    return static_cast<size_t>(bytes);
+  }
+#endif
+  return DEFAULT_LLC_BYTES;
+}
+
+} // namespace
+
+size_t l2_cache_bytes() {
+  static const size_t bytes = detect_l2_cache_bytes();
+  return bytes;
+}
+
+size_t llc_cache_bytes() {
+  static const size_t bytes = detect_llc_cache_bytes();
+  return bytes;
+}
@@ -0,0 +1,11 @@
+#ifndef CPU_INFO_H
+#define CPU_INFO_H
+
+#include <cstddef>
+
+// Per-core L2 cache size in bytes, detected once; 256 KiB if unknown
+size_t l2_cache_bytes();
+// Last-level (L3) cache size in bytes; 8 MiB if unknown
+size_t llc_cache_bytes();
+
+#endif // CPU_INFO_H
@@ -0,0 +1,201 @@
+#include "disk_bloom_filter.h"
+
+#ifdef BLOOM_HAVE_DISK_FILTER
+
+#include "blocked_bloom_filter.h"
+#include "filter_file.h"
+#include "io_uring.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <stdexcept>
+#include <system_error>
+#include <unistd.h>
+
+namespace {
+
+constexpr size_t PAGE = FILTER_FILE_PAGE;
+constexpr size_t BLOCK_BYTES = BlockedBloomFilter::BLOCK_BITS / 8;
+
+char *alloc_pages(size_t n) {
+  void *p = nullptr;
+  if (posix_memalign(&p, PAGE, std::max<size_t>(1, n) * PAGE) != 0) throw std::bad_alloc();
+  return static_cast<char *>(p);
+}
+
+bool check_block(const char *page, uint64_t offset, const KeyHash &hash, size_t k) {
+  uint64_t block[BlockedBloomFilter::BLOCK_WORDS];
+  std::memcpy(block, page + offset, sizeof(block)); // little-endian hosts
+  return BlockedBloomFilter::block_contains(block, hash, k);
+}
+
+} // namespace
+
+void DiskBloomFilter::AlignedFree::operator()(char *p) const { std::free(p); }
+
+DiskBloomFilter::PageCache::PageCache(size_t slots)
+    : pages(slots, ~0ULL), referenced(slots, 0), memory(alloc_pages(slots)) {}
+
+const char *DiskBloomFilter::PageCache::find(uint64_t page) {
+  auto it = slot_of.find(page);
+  if (it == slot_of.end()) return nullptr;
+  referenced[it->second] = 1;
+  return memory.get() + it->second * PAGE;
+}
+
+void DiskBloomFilter::PageCache::insert(uint64_t page, const char *data) {
+  if (pages.empty() || slot_of.count(page)) return;
+  while (referenced[hand]) {
+    referenced[hand] = 0;
+    hand = (hand + 1) % pages.size();
+  }
+  if (pages[hand] != ~0ULL) slot_of.erase(pages[hand]);
+  pages[hand] = page;
+  slot_of[page] = hand;
+  std::memcpy(memory.get() + hand * PAGE, data, PAGE);
+  hand = (hand + 1) % pages.size();
+}
+
+DiskBloomFilter::DiskBloomFilter(const std::string &path, size_t cache_pages,
+                                 unsigned queue_depth)
+    : queue_depth_(std::clamp(queue_depth, 1u, 4096u)), cache_(cache_pages),
+      io_buffers_(alloc_pages(queue_depth_)) {
+#ifdef O_DIRECT
+  fd_ = open(path.c_str(), O_RDONLY | O_CLOEXEC | O_DIRECT);
+  direct_ = fd_ >= 0;
+  if (fd_ < 0 && errno == EINVAL) // filesystem without O_DIRECT (tmpfs)
+#endif
+    fd_ = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd_ < 0) {
+    throw std::system_error(errno, std::generic_category(), "open " + path);
+  }
+  try {
+    pread_page(0, io_buffers_.get());
+    const FilterFileHeader header = parse_filter_header(io_buffers_.get(), PAGE);
+    if (header.layout != FilterLayout::Blocked ||
+        header.num_bits % BlockedBloomFilter::BLOCK_BITS != 0) {
+      throw std::invalid_argument(path + " does not hold a blocked filter");
+    }
+    num_blocks_ = header.num_bits / BlockedBloomFilter::BLOCK_BITS;
+    num_hashes_ = header.num_hashes;
+    hash_scheme_ = header.hash_scheme;
+    data_offset_ = header.data_offset;
+#ifdef BLOOM_HAVE_IO_URING
+    try {
+      ring_ = std::make_unique<IoUring>(queue_depth_);
+    } catch (const std::system_error &) {
+      ring_.reset(); // no io_uring here; use pread
+    }
+#endif
+  } catch (...) {
+    close(fd_);
+    throw;
+  }
+}
+
+DiskBloomFilter::~DiskBloomFilter() {
+  ring_.reset();
+  close(fd_);
+}
+
+void DiskBloomFilter::pread_page(uint64_t page, char *buf) const {
+  size_t done = 0;
+  while (done < PAGE) {
+    const ssize_t r = pread(fd_, buf + done, PAGE - done, static_cast<off_t>(page * PAGE + done));
+    if (r < 0 && errno == EINTR) continue;
+    if (r < 0) throw std::system_error(errno, std::generic_category(), "pread");
+    if (r == 0) throw std::runtime_error("Filter file is truncated");
+    done += static_cast<size_t>(r);
+  }
+}
+
+bool DiskBloomFilter::might_contain_hash(const KeyHash &hash) const {
+  uint8_t out;
+  might_contain_many(&hash, 1, &out);
+  return out;
+}
+
+void DiskBloomFilter::might_contain_many(const KeyHash *hashes, size_t n,
+                                         uint8_t *out) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  // Answer cached pages now; collect (page, key) for the rest
+  std::vector<std::pair<uint64_t, size_t>> misses;
+  for (size_t i = 0; i < n; ++i) {
+    const uint64_t byte = data_offset_ + reduce64(hashes[i].h1, num_blocks_) * BLOCK_BYTES;
+    if (const char *page = cache_.find(byte / PAGE)) {
+      out[i] = check_block(page, byte % PAGE, hashes[i], num_hashes_);
+    } else {
+      misses.emplace_back(byte / PAGE, i);
+    }
+  }
+  if (misses.empty()) return;
+  std::sort(misses.begin(), misses.end());
+
+  // One read per distinct page; range_begin[r] indexes misses
+  std::vector<uint64_t> pages;
+  std::vector<size_t> range_begin;
+  for (size_t i = 0; i < misses.size(); ++i) {
+    if (i == 0 || misses[i].first != misses[i - 1].first) {
+      pages.push_back(misses[i].first);
+      range_begin.push_back(i);
+    }
+  }
+  range_begin.push_back(misses.size());
+  read_pages(pages, range_begin, misses, hashes, out);
+}
+
+void DiskBloomFilter::read_pages(const std::vector<uint64_t> &pages,
+                                 const std::vector<size_t> &range_begin,
+                                 const std::vector<std::pair<uint64_t, size_t>> &misses,
+                                 const KeyHash *hashes, uint8_t *out) const {
+  auto resolve = [&](size_t r, const char *buf) {
+    for (size_t i = range_begin[r]; i < range_begin[r + 1]; ++i) {
+      const size_t key = misses[i].second;
+      const uint64_t byte = data_offset_ + reduce64(hashes[key].h1, num_blocks_) * BLOCK_BYTES;
+      out[key] = check_block(buf, byte % PAGE, hashes[key], num_hashes_);
+    }
+    cache_.insert(pages[r], buf);
+  };
+
+#ifdef BLOOM_HAVE_IO_URING
+  if (ring_) {
+    const unsigned depth = std::min(queue_depth_, ring_->capacity());
+    std::vector<unsigned> free_slots;
+    for (unsigned s = depth; s-- > 0;) free_slots.push_back(s);
+    size_t next = 0, in_flight = 0;
+    int error = 0;
+    while (next < pages.size() || in_flight > 0) {
+      // Keep the queue full; stop issuing once a read has failed
+      while (!error && next < pages.size() && !free_slots.empty()) {
+        const unsigned slot = free_slots.back();
+        char *buf = io_buffers_.get() + slot * PAGE;
+        if (!ring_->queue_read(fd_, buf, PAGE, pages[next] * PAGE, (next << 16) | slot)) break;
+        free_slots.pop_back();
+        ++next;
+        ++in_flight;
+      }
+      if (in_flight == 0) break;
+      ring_->submit_and_wait(1);
+      in_flight -= ring_->reap([&](uint64_t user_data, int32_t res) {
+        const unsigned slot = static_cast<unsigned>(user_data & 0xFFFF);
+        if (res != static_cast<int32_t>(PAGE)) {
+          if (!error) error = res < 0 ? -res : EIO; // short read: truncated file
+        } else if (!error) {
+          resolve(static_cast<size_t>(user_data >> 16), io_buffers_.get() + slot * PAGE);
+        }
+        free_slots.push_back(slot);
+      });
+    }
+    if (error) throw std::system_error(error, std::generic_category(), "io_uring read");
+    return;
+  }
+#endif
+  for (size_t r = 0; r < pages.size(); ++r) {
+    pread_page(pages[r], io_buffers_.get());
+    resolve(r, io_buffers_.get());
+  }
+}
+
+#endif // BLOOM_HAVE_DISK_FILTER
@@ -0,0 +1,93 @@
+#ifndef DISK_BLOOM_FILTER_H
+#define DISK_BLOOM_FILTER_H
+
+#if defined(__unix__) || defined(__APPLE__)
+#define BLOOM_HAVE_DISK_FILTER 1
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "hash_schemes.h"
+#include "hashing.h"
+
+class IoUring;
+
+// Read-only view of a blocked filter file (BlockedBloomFilter::save) that
+// stays on disk. Every lookup needs exactly one 4 KB page. Batch lookups
+// submit all page reads at once through io_uring, falling back to pread
+// where io_uring is unavailable. Keys are resolved as their page arrives.
+// Reads use O_DIRECT when the filesystem allows it, with a small CLOCK page
+// cache in front. Calls are serialized internally.
+class DiskBloomFilter {
+public:
+    explicit DiskBloomFilter(const std::string& path, size_t cache_pages = 256,
+                             unsigned queue_depth = 64);
+    ~DiskBloomFilter();
+
+    DiskBloomFilter(const DiskBloomFilter&) = delete;
+    DiskBloomFilter& operator=(const DiskBloomFilter&) = delete;
+
+    bool might_contain(const char* data, size_t len) const {
+        return might_contain_hash(hash(data, len));
+    }
+    // Base hashes of a key under the file's hash scheme, for the _hash calls
+    KeyHash hash(const char* data, size_t len) const {
+        return hash_with_scheme(hash_scheme_, data, len);
+    }
+    bool might_contain_hash(const KeyHash& hash) const;
+    void might_contain_many(const KeyHash* hashes, size_t n, uint8_t* out) const;
+
+    // Accessors
+    size_t get_num_blocks() const { return num_blocks_; }
+    size_t get_num_hashes() const { return num_hashes_; }
+    HashScheme get_hash_scheme() const { return hash_scheme_; }
+    bool uses_io_uring() const { return ring_ != nullptr; }
+    bool uses_direct_io() const { return direct_; }
+
+private:
+    struct AlignedFree {
+        void operator()(char* p) const;
+    };
+    using PageBuffer = std::unique_ptr<char, AlignedFree>;
+
+    // CLOCK replacement over cache_pages slots
+    struct PageCache {
+        explicit PageCache(size_t slots);
+        const char* find(uint64_t page);
+        void insert(uint64_t page, const char* data);
+
+        std::vector<uint64_t> pages; // page held by each slot
+        std::vector<uint8_t> referenced;
+        std::unordered_map<uint64_t, size_t> slot_of;
+        PageBuffer memory;
+        size_t hand = 0;
+    };
+
+    void read_pages(const std::vector<uint64_t>& pages,
+                    const std::vector<size_t>& range_begin,
+                    const std::vector<std::pair<uint64_t, size_t>>& misses,
+                    const KeyHash* hashes, uint8_t* out) const;
+    void pread_page(uint64_t page, char* buf) const;
+
+    int fd_ = -1;
+    bool direct_ = false;
+    size_t num_blocks_ = 0;
+    size_t num_hashes_ = 0;
+    HashScheme hash_scheme_ = HashScheme::Xxh64;
+    uint64_t data_offset_ = 0;
+    unsigned queue_depth_;
+
+    mutable std::mutex mutex_;
+    mutable PageCache cache_;
+    mutable PageBuffer io_buffers_; // queue_depth_ pages
+    mutable std::unique_ptr<IoUring> ring_;
+};
+
+#endif // defined(__unix__) || defined(__APPLE__)
+
+#endif // DISK_BLOOM_FILTER_H
@@ -0,0 +1,284 @@
+#include "filter_array.h"
+#include "batch_hash.h"
+#include "bloom_engine.h"
+#include "byte_io.h"
+#include "cpu_info.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+namespace {
+
+//   0  magic "BLMA"        4  u16 version        6  u16 layout (FilterLayout)
+//   8  u32 num_hashes     12  u32 hash scheme   16  u64 num_filters
+//  24  u64 bits_per_filter, then num_filters * words_per_filter LE words
+constexpr char FILTER_ARRAY_MAGIC[4] = {'B', 'L', 'M', 'A'};
+constexpr uint16_t FILTER_ARRAY_VERSION = 1;
+constexpr size_t FILTER_ARRAY_HEADER_SIZE = 32;
+constexpr size_t IO_CHUNK_WORDS = 1 << 16;
+// Keys between issuing a filter's prefetch and probing it
+constexpr size_t PREFETCH_DISTANCE = 16;
+
+template <class Layout, class Hash>
+using PlainKernel = BloomEngine<std::decay_t<Hash>, std::decay_t<Layout>, uint64_t, SingleThreaded>;
+template <class Layout, class Hash>
+using AtomicKernel = BloomEngine<std::decay_t<Hash>, std::decay_t<Layout>, uint64_t, Concurrent>;
+
+// Keys per scheduling chunk, as in BloomFilter's batch operations
+size_t key_grain(const KeyBatch &keys) {
+  const size_t avg_len = keys.empty() ? 0 : keys.num_bytes() / keys.size();
+  return std::max<size_t>(256, l2_cache_bytes() / 2 / (avg_len + sizeof(KeyHash)));
+}
+
+void encode_words(const uint64_t *words, size_t n, char *out) {
+  for (size_t i = 0; i < n; ++i) {
+    for (size_t b = 0; b < 8; ++b) out[i * 8 + b] = static_cast<char>(words[i] >> (8 * b));
+  }
+}
+
+void decode_words(const char *data, size_t n, uint64_t *words) {
+  for (size_t i = 0; i < n; ++i) words[i] = read_le<uint64_t>(data + i * 8);
+}
+
+struct ArrayHeader {
+  FilterLayout layout;
+  size_t num_hashes;
+  HashScheme hash_scheme;
+  uint64_t num_filters;
+  uint64_t num_bits;
+};
+
+ArrayHeader parse_header(const char *data, size_t len) {
+  if (len < FILTER_ARRAY_HEADER_SIZE ||
+      std::memcmp(data, FILTER_ARRAY_MAGIC, sizeof(FILTER_ARRAY_MAGIC)) != 0 ||
+      read_le<uint16_t>(data + 4) != FILTER_ARRAY_VERSION) {
+    throw std::invalid_argument("Invalid data for FilterArray restoration");
+  }
+  const uint16_t layout = read_le<uint16_t>(data + 6);
+  const uint32_t scheme = read_le<uint32_t>(data + 12);
+  if (layout > static_cast<uint16_t>(FilterLayout::Partitioned) ||
+      scheme > static_cast<uint32_t>(HashScheme::Crc32c)) {
+    throw std::invalid_argument("Invalid data for FilterArray restoration");
+  }
+  return {static_cast<FilterLayout>(layout), read_le<uint32_t>(data + 8),
+          static_cast<HashScheme>(scheme), read_le<uint64_t>(data + 16),
+          read_le<uint64_t>(data + 24)};
+}
+
+// Slab words a header describes, or 0 if it is invalid or would overflow
+uint64_t payload_words(const ArrayHeader &h) {
+  const uint64_t words_per_filter = (h.num_bits + 63) / 64;
+  if (h.num_hashes == 0 || h.num_filters == 0 || h.num_bits == 0 ||
+      words_per_filter > ~uint64_t{0} / 8 / h.num_filters) {
+    return 0;
+  }
+  return words_per_filter * h.num_filters;
+}
+
+} // namespace
+
+FilterArray::FilterArray(size_t num_filters, size_t bits_per_filter, size_t num_hashes,
+                         FilterLayout layout, HashScheme hash_scheme)
+    : layout_(BloomFilter::make_layout(layout, bits_per_filter, num_hashes)),
+      hash_scheme_(hash_scheme), num_filters_(num_filters), num_bits_(bits_per_filter),
+      num_hashes_(std::visit([](const auto &l) { return l.num_hashes(); }, layout_)),
+      words_per_filter_((bits_per_filter + 63) / 64) {
+  if (num_filters_ == 0) {
+    throw std::invalid_argument("Invalid parameters: num_filters must be > 0");
+  }
+  words_.assign(num_filters_ * words_per_filter_, 0);
+}
+
+FilterArray FilterArray::for_rate(size_t num_filters, size_t items_per_filter, double p,
+                                  HashScheme hash_scheme) {
+  const auto sizing = BloomFilter::optimal_layout(items_per_filter, p);
+  return FilterArray(num_filters, sizing.num_bits(), sizing.num_hashes(),
+                     FilterLayout::Standard, hash_scheme);
+}
+
+void FilterArray::check_id(uint64_t id) const {
+  if (id >= num_filters_) {
+    throw std::out_of_range("Filter id out of range");
+  }
+}
+
+FilterLayout FilterArray::get_layout() const {
+  return std::visit([](const auto &l) { return std::decay_t<decltype(l)>::ID; }, layout_);
+}
+
+void FilterArray::add(size_t id, const char *data, size_t len) {
+  add_hash(id, hash(data, len));
+}
+
+bool FilterArray::might_contain(size_t id, const char *data, size_t len) const {
+  return might_contain_hash(id, hash(data, len));
+}
+
+void FilterArray::add_hash(size_t id, const KeyHash &hash) {
+  check_id(id);
+  uint64_t *words = words_.data() + id * words_per_filter_;
+  std::visit([&](const auto &layout) {
+    AtomicKernel<decltype(layout), Xxh64PairHash>::insert(layout, words, hash);
+  }, layout_);
+}
+
+bool FilterArray::might_contain_hash(size_t id, const KeyHash &hash) const {
+  check_id(id);
+  const uint64_t *words = words_.data() + id * words_per_filter_;
+  return std::visit([&](const auto &layout) {
+    return PlainKernel<decltype(layout), Xxh64PairHash>::test(layout, words, hash);
+  }, layout_);
+}
+
+// Dispatch once per batch, like BloomFilter. Keys are hashed a block at a
+// time; once the slab outgrows L2, each key's filter is prefetched
+// PREFETCH_DISTANCE keys before it is probed.
+void FilterArray::add_many(const uint64_t *ids, const KeyBatch &keys, size_t threads) {
+  for (size_t i = 0; i < keys.size(); ++i) check_id(ids[i]);
+  const bool prefetch = size_in_bytes() > l2_cache_bytes();
+  visit_hash_scheme(hash_scheme_, [&](auto hash_policy) {
+    std::visit([&](const auto &layout) {
+      using Kernel = AtomicKernel<decltype(layout), decltype(hash_policy)>;
+      uint64_t *slab = words_.data();
+      const size_t stride = words_per_filter_;
+      parallel_for(keys.size(), key_grain(keys), threads, [&](size_t begin, size_t end) {
+        KeyHash hashes[HASH_BLOCK];
+        for (size_t start = begin; start < end; start += HASH_BLOCK) {
+          const size_t m = std::min(HASH_BLOCK, end - start);
+          hash_batch<decltype(hash_policy)>(keys, start, m, hashes);
+          const uint64_t *block_ids = ids + start;
+          for (size_t j = 0; prefetch && j < std::min(m, PREFETCH_DISTANCE); ++j) {
+            Kernel::prefetch(layout, slab + block_ids[j] * stride, hashes[j]);
+          }
+          for (size_t j = 0; j < m; ++j) {
+            if (prefetch && j + PREFETCH_DISTANCE < m) {
+              const size_t ahead = j + PREFETCH_DISTANCE;
+              Kernel::prefetch(layout, slab + block_ids[ahead] * stride, hashes[ahead]);
+            }
+            Kernel::insert(layout, slab + block_ids[j] * stride, hashes[j]);
+          }
+        }
+      });
+    }, layout_);
+  });
+}
+
+void FilterArray::might_contain_many(const uint64_t *ids, const KeyBatch &keys, uint8_t *out,
+                                     size_t threads) const {
+  for (size_t i = 0; i < keys.size(); ++i) check_id(ids[i]);
+  const bool prefetch = size_in_bytes() > l2_cache_bytes();
+  visit_hash_scheme(hash_scheme_, [&](auto hash_policy) {
+    std::visit([&](const auto &layout) {
+      using Kernel = PlainKernel<decltype(layout), decltype(hash_policy)>;
+      const uint64_t *slab = words_.data();
+      const size_t stride = words_per_filter_;
+      parallel_for(keys.size(), key_grain(keys), threads, [&](size_t begin, size_t end) {
+        KeyHash hashes[HASH_BLOCK];
+        for (size_t start = begin; start < end; start += HASH_BLOCK) {
+          const size_t m = std::min(HASH_BLOCK, end - start);
+          hash_batch<decltype(hash_policy)>(keys, start, m, hashes);
+          const uint64_t *block_ids = ids + start;
+          for (size_t j = 0; prefetch && j < std::min(m, PREFETCH_DISTANCE); ++j) {
+            Kernel::prefetch(layout, slab + block_ids[j] * stride, hashes[j]);
+          }
+          for (size_t j = 0; j < m; ++j) {
+            if (prefetch && j + PREFETCH_DISTANCE < m) {
+              const size_t ahead = j + PREFETCH_DISTANCE;
+              Kernel::prefetch(layout, slab + block_ids[ahead] * stride, hashes[ahead]);
+            }
+            out[start + j] = Kernel::test(layout, slab + block_ids[j] * stride, hashes[j]);
+          }
+        }
+      });
+    }, layout_);
+  });
+}
+
+void FilterArray::clear(size_t id) {
+  check_id(id);
+  std::fill_n(words_.data() + id * words_per_filter_, words_per_filter_, 0);
+}
+
+BloomFilter FilterArray::to_filter(size_t id) const {
+  check_id(id);
+  const uint64_t *words = words_.data() + id * words_per_filter_;
+  return BloomFilter(get_layout(), num_bits_, num_hashes_,
+                     std::vector<uint64_t>(words, words + words_per_filter_), hash_scheme_);
+}
+
+std::string FilterArray::header() const {
+  std::string out;
+  out.append(FILTER_ARRAY_MAGIC, sizeof(FILTER_ARRAY_MAGIC));
+  write_le<uint16_t>(out, FILTER_ARRAY_VERSION);
+  write_le<uint16_t>(out, static_cast<uint16_t>(get_layout()));
+  write_le<uint32_t>(out, static_cast<uint32_t>(num_hashes_));
+  write_le<uint32_t>(out, static_cast<uint32_t>(hash_scheme_));
+  write_le<uint64_t>(out, num_filters_);
+  write_le<uint64_t>(out, num_bits_);
+  return out;
+}
+
+std::string FilterArray::serialize() const {
+  std::string out = header();
+  out.resize(FILTER_ARRAY_HEADER_SIZE + words_.size() * 8);
+  encode_words(words_.data(), words_.size(), &out[FILTER_ARRAY_HEADER_SIZE]);
+  return out;
+}
+
+FilterArray FilterArray::deserialize(const char *data, size_t len) {
+  const ArrayHeader h = parse_header(data, len);
+  const uint64_t words = payload_words(h);
+  if (words == 0 || len - FILTER_ARRAY_HEADER_SIZE != words * 8) {
+    throw std::invalid_argument("Invalid data for FilterArray restoration");
+  }
+  FilterArray array(h.num_filters, h.num_bits, h.num_hashes, h.layout, h.hash_scheme);
+  decode_words(data + FILTER_ARRAY_HEADER_SIZE, words, array.words_.data());
+  return array;
+}
+
+void FilterArray::save(const std::string &path) const {
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  if (!out) throw std::runtime_error("Cannot open " + path + " for writing");
+  const std::string head = header();
+  out.write(head.data(), static_cast<std::streamsize>(head.size()));
+  std::string chunk;
+  for (size_t i = 0; i < words_.size(); i += IO_CHUNK_WORDS) {
+    const size_t n = std::min(words_.size() - i, IO_CHUNK_WORDS);
+    chunk.resize(n * 8);
+    encode_words(words_.data() + i, n, &chunk[0]);
+    out.write(chunk.data(), static_cast<std::streamsize>(chunk.size()));
+  }
+  if (!out.flush()) throw std::runtime_error("Error writing " + path);
+}
+
+FilterArray FilterArray::load(const std::string &path) {
+  std::ifstream in(path, std::ios::binary);
+  if (!in) throw std::runtime_error("Cannot open " + path);
+  char head[FILTER_ARRAY_HEADER_SIZE];
+  if (!in.read(head, sizeof(head))) throw std::runtime_error("Truncated filter array " + path);
+  const ArrayHeader h = parse_header(head, sizeof(head));
+  const uint64_t words = payload_words(h);
+  if (words == 0) throw std::invalid_argument("Invalid filter array header");
+  // Check the claimed slab is in the file before allocating it
+  in.seekg(0, std::ios::end);
+  const std::streamoff size = in.tellg();
+  if (size < 0) throw std::runtime_error("Error reading " + path);
+  if (static_cast<uint64_t>(size) - FILTER_ARRAY_HEADER_SIZE < words * 8) {
+    throw std::runtime_error("Truncated filter array " + path);
+  }
+  in.seekg(FILTER_ARRAY_HEADER_SIZE);
+
+  FilterArray array(h.num_filters, h.num_bits, h.num_hashes, h.layout, h.hash_scheme);
+  std::string chunk;
+  for (size_t i = 0; i < words; i += IO_CHUNK_WORDS) {
+    const size_t n = std::min<size_t>(words - i, IO_CHUNK_WORDS);
+    chunk.resize(n * 8);
+    if (!in.read(&chunk[0], static_cast<std::streamsize>(chunk.size()))) {
+      throw std::runtime_error("Truncated filter array " + path);
+    }
+    decode_words(chunk.data(), n, array.words_.data() + i);
+  }
+  return array;
+}
@@ -0,0 +1,106 @@
+#ifndef FILTER_ARRAY_H
+#define FILTER_ARRAY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "bloom_filter.h"
+#include "filter_layout.h"
+#include "hash_schemes.h"
+#include "hashing.h"
+#include "key_batch.h"
+
+// Allocator for 64-byte aligned words (C++17 aligned new)
+template <typename T>
+struct CacheLineAllocator {
+    using value_type = T;
+    static constexpr std::align_val_t ALIGNMENT{64};
+
+    CacheLineAllocator() = default;
+    template <typename U>
+    CacheLineAllocator(const CacheLineAllocator<U>&) {}
+
+    T* allocate(size_t n) { return static_cast<T*>(::operator new(n * sizeof(T), ALIGNMENT)); }
+    void deallocate(T* p, size_t) { ::operator delete(p, ALIGNMENT); }
+
+    template <typename U>
+    bool operator==(const CacheLineAllocator<U>&) const { return true; }
+    template <typename U>
+    bool operator!=(const CacheLineAllocator<U>&) const { return false; }
+};
+
+// N Bloom filters with the same layout, size, k and hash scheme, addressed
+// by integer id. Filter i occupies words [i * words_per_filter, (i + 1) *
+// words_per_filter) of one 64-byte aligned slab, so millions of small
+// filters cost their bits and nothing else. Filters of a multiple of 512
+// bits each start on a cache line. A filter's bits equal those of a
+// BloomFilter built with the same parameters and keys (see to_filter).
+class FilterArray {
+public:
+    // bits_per_filter must suit the layout (see layout_granule in filter_layout.h)
+    FilterArray(size_t num_filters, size_t bits_per_filter, size_t num_hashes,
+                FilterLayout layout = FilterLayout::Standard,
+                HashScheme hash_scheme = HashScheme::Xxh64);
+
+    // Standard-layout filters sized like BloomFilter(items_per_filter, p)
+    static FilterArray for_rate(size_t num_filters, size_t items_per_filter, double p,
+                                HashScheme hash_scheme = HashScheme::Xxh64);
+
+    // Single-key operations; ids >= get_num_filters() throw std::out_of_range.
+    // Bits are set atomically, so adds may run alongside add_many.
+    void add(size_t id, const char* data, size_t len);
+    bool might_contain(size_t id, const char* data, size_t len) const;
+    void add_hash(size_t id, const KeyHash& hash);
+    bool might_contain_hash(size_t id, const KeyHash& hash) const;
+
+    // The array's base hashes of a key, under its hash scheme
+    KeyHash hash(const char* data, size_t len) const {
+        return hash_with_scheme(hash_scheme_, data, len);
+    }
+
+    // Key i goes to (or is tested against) filter ids[i]; ids holds
+    // keys.size() entries and is checked before any bit is touched. Spread
+    // over the thread pool like BloomFilter's batch operations.
+    void add_many(const uint64_t* ids, const KeyBatch& keys, size_t threads = 0);
+    void might_contain_many(const uint64_t* ids, const KeyBatch& keys, uint8_t* out,
+                            size_t threads = 0) const;
+
+    void clear(size_t id);
+    // Copy of one filter as a standalone BloomFilter
+    BloomFilter to_filter(size_t id) const;
+
+    // One buffer: a 32-byte header, then every filter's words in id order
+    std::string serialize() const;
+    static FilterArray deserialize(const char* data, size_t len);
+    // Same bytes as serialize(), written and read without a second copy of
+    // the slab; throws std::runtime_error on I/O errors
+    void save(const std::string& path) const;
+    static FilterArray load(const std::string& path);
+
+    // Accessors
+    size_t get_num_filters() const { return num_filters_; }
+    size_t get_bits_per_filter() const { return num_bits_; }
+    size_t get_num_hashes() const { return num_hashes_; }
+    size_t get_words_per_filter() const { return words_per_filter_; }
+    FilterLayout get_layout() const;
+    HashScheme get_hash_scheme() const { return hash_scheme_; }
+    size_t size_in_bytes() const { return words_.size() * sizeof(uint64_t); }
+
+private:
+    void check_id(uint64_t id) const;
+    // Shared with save(): the header fields serialize() writes
+    std::string header() const;
+
+    BloomFilter::Layout layout_;
+    HashScheme hash_scheme_;
+    size_t num_filters_;
+    size_t num_bits_;
+    size_t num_hashes_;
+    size_t words_per_filter_;
+    std::vector<uint64_t, CacheLineAllocator<uint64_t>> words_;
+};
+
+#endif // FILTER_ARRAY_H
@@ -0,0 +1,113 @@
+#include "filter_file.h"
+#include "byte_io.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+namespace {
+
+constexpr char FILTER_FILE_MAGIC[4] = {'B', 'L', 'M', 'F'};
+constexpr uint16_t FILTER_FILE_VERSION = 1;
+constexpr size_t FILTER_FILE_HEADER_SIZE = 40;
+constexpr size_t IO_CHUNK_WORDS = 1 << 16;
+
+} // namespace
+
+FilterFileHeader parse_filter_header(const char *page, size_t len) {
+  if (len < FILTER_FILE_HEADER_SIZE ||
+      std::memcmp(page, FILTER_FILE_MAGIC, sizeof(FILTER_FILE_MAGIC)) != 0 ||
+      read_le<uint16_t>(page + 4) != FILTER_FILE_VERSION) {
+    throw std::invalid_argument("Not a filter file (bad magic or version)");
+  }
+  FilterFileHeader header;
+  const uint16_t layout = read_le<uint16_t>(page + 6);
+  if (layout > static_cast<uint16_t>(FilterLayout::Partitioned)) {
+    throw std::invalid_argument("Unknown filter file layout");
+  }
+  header.layout = static_cast<FilterLayout>(layout);
+  header.num_hashes = read_le<uint32_t>(page + 8);
+  const uint32_t scheme = read_le<uint32_t>(page + 12);
+  if (scheme > static_cast<uint32_t>(HashScheme::Crc32c)) {
+    throw std::invalid_argument("Unknown filter file hash scheme");
+  }
+  header.hash_scheme = static_cast<HashScheme>(scheme);
+  header.num_bits = read_le<uint64_t>(page + 16);
+  header.data_offset = read_le<uint64_t>(page + 24);
+  header.data_bytes = read_le<uint64_t>(page + 32);
+  if (header.num_hashes == 0 || header.num_bits == 0 ||
+      header.data_offset % FILTER_FILE_PAGE != 0 || header.data_offset == 0 ||
+      header.data_bytes != (header.num_bits + 63) / 64 * 8) {
+    throw std::invalid_argument("Invalid filter file header");
+  }
+  return header;
+}
+
+std::string filter_header_page(const FilterFileHeader &header) {
+  std::string page;
+  page.append(FILTER_FILE_MAGIC, sizeof(FILTER_FILE_MAGIC));
+  write_le<uint16_t>(page, FILTER_FILE_VERSION);
+  write_le<uint16_t>(page, static_cast<uint16_t>(header.layout));
+  write_le<uint32_t>(page, header.num_hashes);
+  write_le<uint32_t>(page, static_cast<uint32_t>(header.hash_scheme));
+  write_le<uint64_t>(page, header.num_bits);
+  write_le<uint64_t>(page, header.data_offset);
+  write_le<uint64_t>(page, header.data_bytes);
+  page.resize(FILTER_FILE_PAGE, '\0');
+  return page;
+}
+
+void write_filter_file(const std::string &path, FilterFileHeader header,
+                       const std::vector<uint64_t> &words) {
+  header.data_offset = FILTER_FILE_PAGE;
+  header.data_bytes = words.size() * 8;
+  const std::string page = filter_header_page(header);
+
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  if (!out) throw std::runtime_error("Cannot open " + path + " for writing");
+  out.write(page.data(), static_cast<std::streamsize>(page.size()));
+  std::string chunk;
+  for (size_t i = 0; i < words.size(); i += IO_CHUNK_WORDS) {
+    chunk.clear();
+    const size_t end = std::min(words.size(), i + IO_CHUNK_WORDS);
+    for (size_t w = i; w < end; ++w) write_le(chunk, words[w]);
+    out.write(chunk.data(), static_cast<std::streamsize>(chunk.size()));
+  }
+  const size_t tail = header.data_bytes % FILTER_FILE_PAGE;
+  if (tail) {
+    const std::string pad(FILTER_FILE_PAGE - tail, '\0');
+    out.write(pad.data(), static_cast<std::streamsize>(pad.size()));
+  }
+  if (!out.flush()) throw std::runtime_error("Error writing " + path);
+}
+
+std::vector<uint64_t> read_filter_file(const std::string &path, FilterFileHeader &header) {
+  std::ifstream in(path, std::ios::binary);
+  if (!in) throw std::runtime_error("Cannot open " + path);
+  char page[FILTER_FILE_PAGE];
+  if (!in.read(page, sizeof(page))) throw std::runtime_error("Truncated filter file " + path);
+  header = parse_filter_header(page, sizeof(page));
+
+  // The header is untrusted: check the data it claims is really there
+  // before allocating for it
+  in.seekg(0, std::ios::end);
+  const std::streamoff size = in.tellg();
+  if (size < 0) throw std::runtime_error("Error reading " + path);
+  const uint64_t file_bytes = static_cast<uint64_t>(size);
+  if (header.data_offset > file_bytes || header.data_bytes > file_bytes - header.data_offset) {
+    throw std::runtime_error("Truncated filter file " + path);
+  }
+
+  std::vector<uint64_t> words(header.data_bytes / 8);
+  in.seekg(static_cast<std::streamoff>(header.data_offset));
+  std::string chunk;
+  for (size_t i = 0; i < words.size(); i += IO_CHUNK_WORDS) {
+    const size_t n = std::min(words.size() - i, IO_CHUNK_WORDS);
+    chunk.resize(n * 8);
+    if (!in.read(&chunk[0], static_cast<std::streamsize>(chunk.size()))) {
+      throw std::runtime_error("Truncated filter file " + path);
+    }
+    for (size_t w = 0; w < n; ++w) words[i + w] = read_le<uint64_t>(chunk.data() + w * 8);
+  }
+  return words;
+}
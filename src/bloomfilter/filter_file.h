@@ -0,0 +1,42 @@
+#ifndef FILTER_FILE_H
+#define FILTER_FILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "filter_layout.h"
+#include "hash_schemes.h"
+
+// On-disk filter format. Page 0 holds the header, the bit array starts at
+// data_offset (page aligned, for O_DIRECT) as little-endian 64-bit words,
+// and the file is padded to a whole number of pages.
+//
+//   0  magic "BLMF"        4  u16 version        6  u16 layout (FilterLayout)
+//   8  u32 num_hashes     12  u32 hash scheme (HashScheme; 0 in older files)
+//  16  u64 num_bits       24  u64 data_offset    32  u64 data_bytes
+
+inline constexpr size_t FILTER_FILE_PAGE = 4096;
+
+struct FilterFileHeader {
+    FilterLayout layout = FilterLayout::Standard;
+    uint32_t num_hashes = 0;
+    HashScheme hash_scheme = HashScheme::Xxh64;
+    uint64_t num_bits = 0;
+    uint64_t data_offset = FILTER_FILE_PAGE;
+    uint64_t data_bytes = 0;
+};
+
+// Throws std::invalid_argument on a malformed header
+FilterFileHeader parse_filter_header(const char* page, size_t len);
+
+// Page 0 of a file with this header
+std::string filter_header_page(const FilterFileHeader& header);
+
+void write_filter_file(const std::string& path, FilterFileHeader header,
+                       const std::vector<uint64_t>& words);
+// Reads header and words; throws std::runtime_error on I/O errors
+std::vector<uint64_t> read_filter_file(const std::string& path, FilterFileHeader& header);
+
+#endif // FILTER_FILE_H
@@ -0,0 +1,71 @@
+#ifndef FILTER_LAYOUT_H
+#define FILTER_LAYOUT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+
+#include "hashing.h"
+
+// How a filter maps a key's k probes onto its bit array (the layout policies
+// in bloom_engine.h). The value is stored in filter files (see filter_file.h)
+// and pickles.
+enum class FilterLayout : uint16_t {
+    Standard = 0,    // k probes anywhere: bit = probe % num_bits
+    Blocked = 1,     // k probes inside one 512-bit block (BlockedBloomFilter)
+    SplitBlock = 2,  // 256-bit block, one bit in each of its eight 32-bit words
+    Partitioned = 3, // probe i inside partition i of num_bits / k bits
+};
+
+inline constexpr size_t BLOCKED_LAYOUT_BITS = 512;
+inline constexpr size_t SPLIT_BLOCK_LAYOUT_BITS = 256;
+inline constexpr size_t SPLIT_BLOCK_LAYOUT_HASHES = 8;
+
+// Apache Parquet's split-block salts (parquet-format BloomFilter.md)
+inline constexpr uint32_t SPLIT_BLOCK_SALT[8] = {0x47b6137bU, 0x44974d91U, 0x8824ad5bU,
+                                                 0xa2b7289dU, 0x705495c7U, 0x2df1424bU,
+                                                 0x9efc4947U, 0x5c6bfb31U};
+
+inline const char* filter_layout_name(FilterLayout layout) {
+    switch (layout) {
+    case FilterLayout::Standard: return "standard";
+    case FilterLayout::Blocked: return "blocked";
+    case FilterLayout::SplitBlock: return "split_block";
+    case FilterLayout::Partitioned: return "partitioned";
+    }
+    return "unknown";
+}
+
+inline FilterLayout parse_filter_layout(const std::string& name) {
+    for (uint16_t v = 0; v <= static_cast<uint16_t>(FilterLayout::Partitioned); ++v) {
+        if (name == filter_layout_name(static_cast<FilterLayout>(v))) {
+            return static_cast<FilterLayout>(v);
+        }
+    }
+    throw std::invalid_argument("Unknown filter layout '" + name + "'");
+}
+
+// num_bits must be a multiple of this for the layout
+inline size_t layout_granule(FilterLayout layout, size_t num_hashes) {
+    switch (layout) {
+    case FilterLayout::Blocked: return BLOCKED_LAYOUT_BITS;
+    case FilterLayout::SplitBlock: return SPLIT_BLOCK_LAYOUT_BITS;
+    case FilterLayout::Partitioned: return num_hashes;
+    default: return 1;
+    }
+}
+
+// Bit i of a 512-bit block: 32-bit enhanced double hashing on h2
+template <typename Fn>
+inline void for_each_block_bit(const KeyHash& hash, size_t num_hashes, Fn&& fn) {
+    uint32_t x = static_cast<uint32_t>(hash.h2);
+    uint32_t y = static_cast<uint32_t>(hash.h2 >> 32);
+    for (size_t i = 0; i < num_hashes; ++i) {
+        fn(x & (BLOCKED_LAYOUT_BITS - 1));
+        y += static_cast<uint32_t>(i);
+        x += y;
+    }
+}
+
+#endif // FILTER_LAYOUT_H
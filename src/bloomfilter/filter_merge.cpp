@@ -0,0 +1,237 @@
+#include "filter_merge.h"
+
+#ifdef BLOOM_HAVE_FILTER_MERGE
+
+#include "thread_pool.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <memory>
+#include <stdexcept>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define FILTER_MERGE_HAVE_AVX2 1
+#include <immintrin.h>
+#endif
+
+namespace {
+
+constexpr size_t PAGE = FILTER_FILE_PAGE;
+constexpr size_t DEFAULT_MERGE_MEMORY = size_t{256} << 20;
+
+size_t round_up(size_t n, size_t to) { return (n + to - 1) / to * to; }
+
+// An open file descriptor, closed on scope exit
+class File {
+public:
+  File(const std::string &path, int flags)
+      : path_(path), fd_(open(path.c_str(), flags | O_CLOEXEC, 0644)) {
+    if (fd_ < 0) throw std::runtime_error("Cannot open " + path + ": " + std::strerror(errno));
+  }
+  ~File() { close(fd_); }
+
+  File(const File &) = delete;
+  File &operator=(const File &) = delete;
+
+  void read_at(char *buf, size_t len, uint64_t offset) const {
+    for (size_t done = 0; done < len;) {
+      const ssize_t r = pread(fd_, buf + done, len - done, static_cast<off_t>(offset + done));
+      if (r < 0 && errno == EINTR) continue;
+      if (r < 0) throw std::runtime_error("Error reading " + path_ + ": " + std::strerror(errno));
+      if (r == 0) throw std::runtime_error("Truncated filter file " + path_);
+      done += static_cast<size_t>(r);
+    }
+  }
+
+  void write_at(const char *buf, size_t len, uint64_t offset) const {
+    for (size_t done = 0; done < len;) {
+      const ssize_t r = pwrite(fd_, buf + done, len - done, static_cast<off_t>(offset + done));
+      if (r < 0 && errno == EINTR) continue;
+      if (r < 0) throw std::runtime_error("Error writing " + path_ + ": " + std::strerror(errno));
+      done += static_cast<size_t>(r);
+    }
+  }
+
+  void resize(uint64_t size) const {
+    if (ftruncate(fd_, static_cast<off_t>(size)) != 0) {
+      throw std::runtime_error("Error writing " + path_ + ": " + std::strerror(errno));
+    }
+  }
+
+  // Page cache hints: start reading a range ahead of use, or drop a range
+  // that has been consumed. No-ops where posix_fadvise is missing (macOS).
+  void will_need(uint64_t offset, size_t len) const { advise(offset, len, true); }
+  void done_with(uint64_t offset, size_t len) const { advise(offset, len, false); }
+
+  uint64_t size() const {
+    struct stat st;
+    if (fstat(fd_, &st) != 0) {
+      throw std::runtime_error("Error reading " + path_ + ": " + std::strerror(errno));
+    }
+    return static_cast<uint64_t>(st.st_size);
+  }
+
+  bool same_file(const struct stat &other) const {
+    struct stat st;
+    return fstat(fd_, &st) == 0 && st.st_dev == other.st_dev && st.st_ino == other.st_ino;
+  }
+
+private:
+  void advise(uint64_t offset, size_t len, bool need) const {
+#ifdef POSIX_FADV_WILLNEED
+    posix_fadvise(fd_, static_cast<off_t>(offset), static_cast<off_t>(len),
+                  need ? POSIX_FADV_WILLNEED : POSIX_FADV_DONTNEED);
+#else
+    (void)offset, (void)len, (void)need;
+#endif
+  }
+
+  std::string path_;
+  int fd_;
+};
+
+void or_words_scalar(uint64_t *dst, const uint64_t *src, size_t n) {
+  for (size_t i = 0; i < n; ++i) dst[i] |= src[i];
+}
+
+#ifdef FILTER_MERGE_HAVE_AVX2
+__attribute__((target("avx2"))) void or_words_avx2(uint64_t *dst, const uint64_t *src,
+                                                   size_t n) {
+  size_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    for (size_t j = 0; j < 16; j += 4) {
+      __m256i *d = reinterpret_cast<__m256i *>(dst + i + j);
+      const __m256i s = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i + j));
+      _mm256_storeu_si256(d, _mm256_or_si256(_mm256_loadu_si256(d), s));
+    }
+  }
+  or_words_scalar(dst + i, src + i, n - i);
+}
+#endif
+
+using OrWords = void (*)(uint64_t *, const uint64_t *, size_t);
+
+OrWords select_or_words() {
+#ifdef FILTER_MERGE_HAVE_AVX2
+  if (__builtin_cpu_supports("avx2")) return or_words_avx2;
+#endif
+  return or_words_scalar;
+}
+
+// dst |= src over n words
+void or_words(uint64_t *dst, const uint64_t *src, size_t n) {
+  static const OrWords fn = select_or_words();
+  fn(dst, src, n);
+}
+
+FilterFileHeader read_header(const File &file) {
+  char page[PAGE];
+  file.read_at(page, sizeof(page), 0);
+  return parse_filter_header(page, sizeof(page));
+}
+
+bool same_parameters(const FilterFileHeader &a, const FilterFileHeader &b) {
+  return a.layout == b.layout && a.num_hashes == b.num_hashes &&
+         a.hash_scheme == b.hash_scheme && a.num_bits == b.num_bits;
+}
+
+} // namespace
+
+FilterFileHeader merge_filter_files(const std::vector<std::string> &paths,
+                                    const std::string &out_path, size_t threads,
+                                    size_t memory_bytes) {
+  if (paths.empty()) throw std::invalid_argument("merge_files needs at least one input");
+
+  // Check every input before the output is created. It is written to
+  // out_path + ".tmp" and renamed over out_path only once complete, so a
+  // failed merge never leaves a partial filter that loads as valid.
+  const std::string tmp_path = out_path + ".tmp";
+  std::vector<uint64_t> data_offsets(paths.size());
+  FilterFileHeader header;
+  struct stat out_stat, tmp_stat;
+  const bool out_exists = stat(out_path.c_str(), &out_stat) == 0;
+  const bool tmp_exists = stat(tmp_path.c_str(), &tmp_stat) == 0;
+  for (size_t i = 0; i < paths.size(); ++i) {
+    const File input(paths[i], O_RDONLY);
+    const FilterFileHeader h = read_header(input);
+    if (i == 0) header = h;
+    if (!same_parameters(header, h)) {
+      throw std::invalid_argument("Cannot merge filter files with different parameters: " +
+                                  paths[0] + ", " + paths[i]);
+    }
+    if ((out_exists && input.same_file(out_stat)) || (tmp_exists && input.same_file(tmp_stat))) {
+      throw std::invalid_argument("merge_files output is also an input: " + out_path);
+    }
+    const uint64_t size = input.size();
+    if (h.data_offset > size || h.data_bytes > size - h.data_offset) {
+      throw std::runtime_error("Truncated filter file " + paths[i]);
+    }
+    data_offsets[i] = h.data_offset;
+  }
+  header.data_offset = PAGE;
+
+  // Half the memory for the output stripe, half for the workers' read
+  // buffers; each worker owns one page-aligned slice of the stripe
+  const uint64_t data_bytes = header.data_bytes;
+  const size_t workers = resolve_threads(threads);
+  const size_t budget = memory_bytes ? memory_bytes : DEFAULT_MERGE_MEMORY;
+  size_t slice = std::max(PAGE, budget / 2 / workers / PAGE * PAGE);
+  slice = std::min<size_t>(slice, round_up((data_bytes + workers - 1) / workers, PAGE));
+  const size_t stripe = slice * workers;
+  std::vector<uint64_t> acc(stripe / 8);
+  std::vector<uint64_t> buffers(stripe / 8);
+
+  try {
+    const File out(tmp_path, O_WRONLY | O_CREAT | O_TRUNC);
+    const std::string page = filter_header_page(header);
+    out.write_at(page.data(), page.size(), 0);
+    out.resize(PAGE + round_up(data_bytes, PAGE));
+
+    for (uint64_t base = 0; base < data_bytes; base += stripe) {
+      const size_t len = static_cast<size_t>(std::min<uint64_t>(stripe, data_bytes - base));
+      const size_t slices = (len + slice - 1) / slice;
+      auto open_input = [&](size_t i) {
+        auto file = std::make_unique<File>(paths[i], O_RDONLY);
+        file->will_need(data_offsets[i] + base, len);
+        return file;
+      };
+
+      std::unique_ptr<File> next = open_input(0);
+      for (size_t i = 0; i < paths.size(); ++i) {
+        const std::unique_ptr<File> input = std::move(next);
+        if (i + 1 < paths.size()) next = open_input(i + 1);
+        const uint64_t offset = data_offsets[i] + base;
+        parallel_for(slices, 1, threads, [&](size_t begin, size_t end) {
+          for (size_t s = begin; s < end; ++s) {
+            const size_t from = s * slice;
+            const size_t n = std::min(slice, len - from);
+            // The first input is read straight into the stripe
+            uint64_t *dst = acc.data() + from / 8;
+            uint64_t *buf = i == 0 ? dst : buffers.data() + from / 8;
+            input->read_at(reinterpret_cast<char *>(buf), n, offset + from);
+            if (i > 0) or_words(dst, buf, n / 8);
+          }
+        });
+        input->done_with(offset, len);
+      }
+      out.write_at(reinterpret_cast<const char *>(acc.data()), len, PAGE + base);
+    }
+  } catch (...) {
+    unlink(tmp_path.c_str());
+    throw;
+  }
+  if (rename(tmp_path.c_str(), out_path.c_str()) != 0) {
+    const int err = errno;
+    unlink(tmp_path.c_str());
+    throw std::runtime_error("Cannot rename " + tmp_path + " to " + out_path + ": " +
+                             std::strerror(err));
+  }
+  return header;
+}
+
+#endif // BLOOM_HAVE_FILTER_MERGE
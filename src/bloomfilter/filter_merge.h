@@ -0,0 +1,36 @@
+#ifndef FILTER_MERGE_H
+#define FILTER_MERGE_H
+
+#if defined(__unix__) || defined(__APPLE__)
+#define BLOOM_HAVE_FILTER_MERGE 1
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "filter_file.h"
+
+// Union of filter files (filter_file.h) written straight to out_path,
+// without loading any input whole. Every input must have the same layout,
+// hash scheme, k and num_bits; the output gets that header.
+//
+// The output is built one stripe at a time. For each input in turn, every
+// worker preads its page-aligned slice of the stripe and ORs it in (AVX2
+// where available), while the kernel reads ahead into the next input.
+// Stripe plus read buffers stay within memory_bytes (0 = 256 MB) whatever
+// the number of inputs, and at most two inputs are open at once.
+//
+// The output is written to out_path + ".tmp" and renamed over out_path
+// once complete; on failure the temporary file is removed and an existing
+// out_path is left untouched. Inputs shorter than their header claims are
+// rejected before anything is written.
+//
+// Throws std::invalid_argument for mismatched or malformed inputs, and
+// std::runtime_error on I/O errors.
+FilterFileHeader merge_filter_files(const std::vector<std::string>& paths,
+                                    const std::string& out_path, size_t threads = 0,
+                                    size_t memory_bytes = 0);
+
+#endif // defined(__unix__) || defined(__APPLE__)
+
+#endif // FILTER_MERGE_H
@@ -0,0 +1,161 @@
+#ifndef FIXED_BLOOM_FILTER_H
+#define FIXED_BLOOM_FILTER_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <string_view>
+#include <utility>
+
+#include "atomics.h"
+#include "hashing.h"
+
+// Header-only Bloom filter whose size and k are template parameters, for
+// filters embedded in other structures (per page, per bucket). The words are
+// stored inline, so sizeof is the bit array rounded up to whole words, and
+// the k probes are unrolled at compile time. Probes and bits are identical to
+// BloomFilter(Bits, K), and insert/query are constexpr, so static tables can
+// be built at compile time:
+//
+//   constexpr FixedBloomFilter<512, 4> RESERVED{"select", "from", "where"};
+//   static_assert(RESERVED.might_contain("from"));
+template <size_t Bits, size_t K>
+class FixedBloomFilter {
+    static_assert(Bits > 0, "FixedBloomFilter needs at least one bit");
+    static_assert(K > 0 && K <= 32, "FixedBloomFilter supports 1 to 32 hashes");
+
+public:
+    static constexpr size_t NUM_BITS = Bits;
+    static constexpr size_t NUM_HASHES = K;
+    static constexpr size_t NUM_WORDS = (Bits + 63) / 64;
+
+    constexpr FixedBloomFilter() = default;
+    constexpr FixedBloomFilter(std::initializer_list<std::string_view> keys) {
+        for (std::string_view key : keys) add(key);
+    }
+
+    void add(const char* data, size_t len) { add_hash(hash_key(data, len)); }
+    bool might_contain(const char* data, size_t len) const {
+        return might_contain_hash(hash_key(data, len));
+    }
+    constexpr void add(std::string_view key) { add_hash(hash_of(key)); }
+    constexpr bool might_contain(std::string_view key) const {
+        return might_contain_hash(hash_of(key));
+    }
+
+    constexpr void add_hash(const KeyHash& hash) {
+        add_probes(hash, std::make_index_sequence<K>{});
+    }
+    constexpr bool might_contain_hash(const KeyHash& hash) const {
+        return test_probes(hash, std::make_index_sequence<K>{});
+    }
+    // Safe against other threads adding to the same filter at the same time
+    void add_hash_concurrent(const KeyHash& hash) {
+        add_probes_concurrent(hash, std::make_index_sequence<K>{});
+    }
+
+    constexpr FixedBloomFilter& operator|=(const FixedBloomFilter& other) {
+        for (size_t w = 0; w < NUM_WORDS; ++w) words_[w] |= other.words_[w];
+        return *this;
+    }
+    constexpr bool operator==(const FixedBloomFilter& other) const {
+        for (size_t w = 0; w < NUM_WORDS; ++w) {
+            if (words_[w] != other.words_[w]) return false;
+        }
+        return true;
+    }
+    constexpr bool operator!=(const FixedBloomFilter& other) const { return !(*this == other); }
+
+    constexpr void clear() {
+        for (uint64_t& w : words_) w = 0;
+    }
+    constexpr size_t count_set_bits() const {
+        size_t count = 0;
+        for (uint64_t w : words_) {
+            for (; w; w &= w - 1) ++count;
+        }
+        return count;
+    }
+
+    // Same layout as BloomFilter::get_raw_bits_vector()
+    constexpr const std::array<uint64_t, NUM_WORDS>& words() const { return words_; }
+
+private:
+    static constexpr KeyHash hash_of(std::string_view key) {
+#if defined(__has_builtin)
+#if __has_builtin(__builtin_is_constant_evaluated)
+        if (!__builtin_is_constant_evaluated()) return hash_key(key.data(), key.size());
+#endif
+#endif
+        return hash_key_constexpr(key);
+    }
+
+    // Enhanced double hashing (see README.md) in closed form: probe i is
+    // h1 + i*h2 + (i^3 - i)/6, so the unrolled probes share no dependency chain
+    template <size_t I>
+    static constexpr size_t bit(const KeyHash& hash) {
+        constexpr uint64_t tetra = (uint64_t{I} * I * I - I) / 6;
+        return static_cast<size_t>((hash.h1 + I * hash.h2 + tetra) % Bits);
+    }
+
+    template <size_t... I>
+    constexpr void add_probes(const KeyHash& hash, std::index_sequence<I...>) {
+        ((words_[bit<I>(hash) >> 6] |= uint64_t{1} << (bit<I>(hash) & 63)), ...);
+    }
+
+    // Branch-free: a filter this size is cache resident, so all k loads are cheap
+    template <size_t... I>
+    constexpr bool test_probes(const KeyHash& hash, std::index_sequence<I...>) const {
+        return ((words_[bit<I>(hash) >> 6] >> (bit<I>(hash) & 63)) & ... & uint64_t{1}) != 0;
+    }
+
+    template <size_t... I>
+    void add_probes_concurrent(const KeyHash& hash, std::index_sequence<I...>) {
+        (atomic_or_relaxed(&words_[bit<I>(hash) >> 6], uint64_t{1} << (bit<I>(hash) & 63)), ...);
+    }
+
+    std::array<uint64_t, NUM_WORDS> words_{};
+};
+
+// Compile-time sizing for n items at a false positive rate of 1/OneIn:
+// BloomFilter(n, p)'s formulas, with the bit array rounded up to whole words
+namespace fixed_filter_params {
+
+inline constexpr double LN2 = 0.693147180559945;
+
+constexpr double ln(double x) {
+    int exponent = 0;
+    while (x > 2.0) { x /= 2.0; ++exponent; }
+    while (x < 1.0) { x *= 2.0; --exponent; }
+    // ln(x) = 2 atanh((x - 1) / (x + 1)), converging fast on [1, 2]
+    const double y = (x - 1.0) / (x + 1.0);
+    double term = y, sum = 0.0;
+    for (int i = 1; i < 64; i += 2) {
+        sum += term / i;
+        term *= y * y;
+    }
+    return 2.0 * sum + exponent * LN2;
+}
+
+constexpr size_t bits(size_t n, size_t one_in) {
+    const double m = static_cast<double>(n) * ln(static_cast<double>(one_in)) / (LN2 * LN2);
+    const size_t whole = static_cast<size_t>(m);
+    const size_t rounded = whole + (static_cast<double>(whole) < m);
+    return rounded < 64 ? 64 : (rounded + 63) / 64 * 64;
+}
+
+constexpr size_t hashes(size_t n, size_t one_in) {
+    const double k = static_cast<double>(bits(n, one_in)) / static_cast<double>(n) * LN2;
+    const size_t whole = static_cast<size_t>(k);
+    const size_t rounded = whole + (static_cast<double>(whole) < k);
+    return rounded < 1 ? 1 : rounded > 16 ? 16 : rounded;
+}
+
+} // namespace fixed_filter_params
+
+template <size_t N, size_t OneIn>
+using FixedBloomFilterFor =
+    FixedBloomFilter<fixed_filter_params::bits(N, OneIn), fixed_filter_params::hashes(N, OneIn)>;
+
+#endif // FIXED_BLOOM_FILTER_H
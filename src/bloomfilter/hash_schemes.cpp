@@ -0,0 +1,133 @@
+#include "hash_schemes.h"
+
+#if (defined(__GNUC__) || defined(__clang__)) && defined(__x86_64__)
+#define HASH_SCHEMES_HAVE_SSE42 1
+#include <nmmintrin.h>
+#elif defined(__ARM_FEATURE_CRC32)
+#define HASH_SCHEMES_HAVE_ARM_CRC 1
+#include <arm_acle.h>
+#endif
+
+namespace {
+
+using short_key_detail::load32;
+using short_key_detail::load64;
+using short_key_detail::load_upto3;
+
+// Odd multiplier of the second lane (2^64 / golden ratio)
+constexpr uint64_t LANE2_MULTIPLIER = 0x9E3779B97F4A7C15ULL;
+
+// The last 1..7 bytes as one little-endian word. At least 8 bytes in total:
+// reread the final 8 and shift out the ones already consumed.
+inline uint64_t tail_word(const char *data, size_t len, size_t rest) {
+  if (len >= 8) return load64(data + len - 8) >> (8 * (8 - rest));
+  if (rest >= 4) return load32(data) | (load32(data + rest - 4) << 32);
+  return load_upto3(data, rest);
+}
+
+inline KeyHash finish(uint32_t a, uint32_t b) {
+  const uint64_t x = (uint64_t{a} << 32) | b;
+  return {mix64(x ^ HASH_SEED1), mix64(x ^ HASH_SEED2)};
+}
+
+// Reflected CRC32C (Castagnoli) polynomial, one byte per table step
+struct Crc32cTable {
+  uint32_t entries[256];
+  constexpr Crc32cTable() : entries() {
+    for (uint32_t i = 0; i < 256; ++i) {
+      uint32_t crc = i;
+      for (int bit = 0; bit < 8; ++bit) crc = (crc >> 1) ^ (0x82F63B78U & (0U - (crc & 1)));
+      entries[i] = crc;
+    }
+  }
+};
+
+constexpr Crc32cTable CRC32C_TABLE;
+
+// Same result as the _mm_crc32_u64 instruction
+inline uint32_t crc32c_word_sw(uint32_t crc, uint64_t word) {
+  for (int i = 0; i < 8; ++i) {
+    crc = CRC32C_TABLE.entries[(crc ^ word) & 0xFF] ^ (crc >> 8);
+    word >>= 8;
+  }
+  return crc;
+}
+
+// The lanes start from the seeds, with the length folded into the first so
+// that zero-padded tails of different lengths differ
+KeyHash crc32c_hash_sw(const char *data, size_t len) {
+  uint32_t a = static_cast<uint32_t>(HASH_SEED1 ^ len);
+  uint32_t b = static_cast<uint32_t>(HASH_SEED2);
+  size_t i = 0;
+  for (; i + 8 <= len; i += 8) {
+    const uint64_t w = load64(data + i);
+    a = crc32c_word_sw(a, w);
+    b = crc32c_word_sw(b, w * LANE2_MULTIPLIER);
+  }
+  if (i < len) {
+    const uint64_t w = tail_word(data, len, len - i);
+    a = crc32c_word_sw(a, w);
+    b = crc32c_word_sw(b, w * LANE2_MULTIPLIER);
+  }
+  return finish(a, b);
+}
+
+#ifdef HASH_SCHEMES_HAVE_SSE42
+__attribute__((target("sse4.2"))) KeyHash crc32c_hash_sse42(const char *data, size_t len) {
+  uint32_t a = static_cast<uint32_t>(HASH_SEED1 ^ len);
+  uint32_t b = static_cast<uint32_t>(HASH_SEED2);
+  size_t i = 0;
+  for (; i + 8 <= len; i += 8) {
+    const uint64_t w = load64(data + i);
+    a = static_cast<uint32_t>(_mm_crc32_u64(a, w));
+    b = static_cast<uint32_t>(_mm_crc32_u64(b, w * LANE2_MULTIPLIER));
+  }
+  if (i < len) {
+    const uint64_t w = tail_word(data, len, len - i);
+    a = static_cast<uint32_t>(_mm_crc32_u64(a, w));
+    b = static_cast<uint32_t>(_mm_crc32_u64(b, w * LANE2_MULTIPLIER));
+  }
+  return finish(a, b);
+}
+#endif
+
+#ifdef HASH_SCHEMES_HAVE_ARM_CRC
+KeyHash crc32c_hash_arm(const char *data, size_t len) {
+  uint32_t a = static_cast<uint32_t>(HASH_SEED1 ^ len);
+  uint32_t b = static_cast<uint32_t>(HASH_SEED2);
+  size_t i = 0;
+  for (; i + 8 <= len; i += 8) {
+    const uint64_t w = load64(data + i);
+    a = __crc32cd(a, w);
+    b = __crc32cd(b, w * LANE2_MULTIPLIER);
+  }
+  if (i < len) {
+    const uint64_t w = tail_word(data, len, len - i);
+    a = __crc32cd(a, w);
+    b = __crc32cd(b, w * LANE2_MULTIPLIER);
+  }
+  return finish(a, b);
+}
+#endif
+
+using Crc32cFn = KeyHash (*)(const char *, size_t);
+
+Crc32cFn select_crc32c() {
+#if defined(HASH_SCHEMES_HAVE_SSE42)
+  if (__builtin_cpu_supports("sse4.2")) return crc32c_hash_sse42;
+#elif defined(HASH_SCHEMES_HAVE_ARM_CRC)
+  return crc32c_hash_arm;
+#endif
+  return crc32c_hash_sw;
+}
+
+Crc32cFn crc32c_impl() {
+  static const Crc32cFn impl = select_crc32c();
+  return impl;
+}
+
+} // namespace
+
+KeyHash crc32c_hash(const char *data, size_t len) { return crc32c_impl()(data, len); }
+
+bool crc32c_hardware() { return crc32c_impl() != crc32c_hash_sw; }
@@ -0,0 +1,139 @@
+#ifndef HASH_SCHEMES_H
+#define HASH_SCHEMES_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#include "hashing.h"
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+
+// How a BloomFilter turns key bytes into its base hashes (h1, h2). The value
+// is stored in filter files (see filter_file.h) and pickles. Every scheme
+// gives different bits, so a filter is only ever probed with its own.
+enum class HashScheme : uint32_t {
+    Xxh64 = 0,    // hash_key: XXH64 under HASH_SEED1 and HASH_SEED2
+    ShortKey = 1, // wyhash-style multiply-mix up to 32 bytes, Xxh64 beyond
+    Crc32c = 2,   // CRC32C (SSE4.2 / ARMv8 CRC when present) plus a final mix
+};
+
+inline const char* hash_scheme_name(HashScheme scheme) {
+    switch (scheme) {
+    case HashScheme::Xxh64: return "xxh64";
+    case HashScheme::ShortKey: return "short_key";
+    case HashScheme::Crc32c: return "crc32c";
+    }
+    return "unknown";
+}
+
+inline HashScheme parse_hash_scheme(const std::string& name) {
+    for (uint32_t v = 0; v <= static_cast<uint32_t>(HashScheme::Crc32c); ++v) {
+        if (name == hash_scheme_name(static_cast<HashScheme>(v))) {
+            return static_cast<HashScheme>(v);
+        }
+    }
+    throw std::invalid_argument("Unknown hash scheme '" + name + "'");
+}
+
+// Little-endian loads, so hashes (and persisted filters) match across hosts
+namespace short_key_detail {
+
+inline uint64_t load64(const char* p) {
+    uint64_t v;
+    std::memcpy(&v, p, 8);
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    v = __builtin_bswap64(v);
+#endif
+    return v;
+}
+
+inline uint64_t load32(const char* p) {
+    uint32_t v;
+    std::memcpy(&v, p, 4);
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    v = __builtin_bswap32(v);
+#endif
+    return v;
+}
+
+// 1..3 bytes: first, middle and last byte (the same byte when len is 1)
+inline uint64_t load_upto3(const char* p, size_t len) {
+    const auto* u = reinterpret_cast<const unsigned char*>(p);
+    return (uint64_t{u[0]} << 16) | (uint64_t{u[len >> 1]} << 8) | u[len - 1];
+}
+
+// Full 64x64 -> 128-bit product, returned as lo and hi
+inline void mul128(uint64_t& a, uint64_t& b) {
+#if defined(_MSC_VER) && !defined(__clang__)
+    a = _umul128(a, b, &b);
+#else
+    const unsigned __int128 r = static_cast<unsigned __int128>(a) * b;
+    a = static_cast<uint64_t>(r);
+    b = static_cast<uint64_t>(r >> 64);
+#endif
+}
+
+inline uint64_t mix(uint64_t a, uint64_t b) {
+    mul128(a, b);
+    return a ^ b;
+}
+
+// wyhash's default secrets
+inline constexpr uint64_t SECRET0 = 0xa0761d6478bd642fULL;
+inline constexpr uint64_t SECRET1 = 0xe7037ed1a0b428dbULL;
+inline constexpr uint64_t SECRET2 = 0x8ebc6af09c88c6e3ULL;
+inline constexpr uint64_t SECRET3 = 0x589965cc75374cc3ULL;
+
+} // namespace short_key_detail
+
+// Keys up to 16 bytes are read with at most four overlapping loads and keys
+// of 17 to 32 bytes with four 8-byte loads, so neither path has a loop or a
+// per-byte branch. One 128-bit multiply folds the key; h1 and h2 each take
+// one more. Longer keys use hash_key, where XXH64's stripes pay off.
+inline KeyHash short_key_hash(const char* p, size_t len) {
+    using namespace short_key_detail;
+    if (len > 32) return hash_key(p, len);
+    uint64_t seed = HASH_SEED1;
+    uint64_t a, b;
+    if (len <= 16) {
+        if (len >= 4) {
+            const size_t mid = (len >> 3) << 2; // 0 below 8 bytes, else 4
+            a = (load32(p) << 32) | load32(p + mid);
+            b = (load32(p + len - 4) << 32) | load32(p + len - 4 - mid);
+        } else {
+            a = len ? load_upto3(p, len) : 0;
+            b = 0;
+        }
+    } else {
+        seed = mix(load64(p) ^ SECRET1, load64(p + 8) ^ seed);
+        a = load64(p + len - 16);
+        b = load64(p + len - 8);
+    }
+    a ^= SECRET1;
+    b ^= seed;
+    mul128(a, b);
+    return {mix(a ^ SECRET0 ^ len, b ^ SECRET1), mix(a ^ SECRET2, b ^ SECRET3 ^ len)};
+}
+
+// CRC32C runs over the key's 8-byte words in two lanes, the second over the
+// words times an odd constant so the pair is not a linear function of the
+// key. The lanes form a 64-bit value that mix64 spreads into h1 and h2.
+// Uses the CRC32 instructions when the CPU has them (checked once), or an
+// equivalent table otherwise.
+KeyHash crc32c_hash(const char* data, size_t len);
+bool crc32c_hardware();
+
+inline KeyHash hash_with_scheme(HashScheme scheme, const char* data, size_t len) {
+    switch (scheme) {
+    case HashScheme::ShortKey: return short_key_hash(data, len);
+    case HashScheme::Crc32c: return crc32c_hash(data, len);
+    default: return hash_key(data, len);
+    }
+}
+
+#endif // HASH_SCHEMES_H
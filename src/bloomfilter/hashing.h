@@ -0,0 +1,114 @@
+#ifndef BLOOM_HASHING_H
+#define BLOOM_HASHING_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+#include "xxhash.h"
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+
+// Seeds of the two base hashes h1/h2. Every structure in this package derives
+// its probes from them, so changing either invalidates persisted filters.
+inline constexpr uint64_t HASH_SEED1 = 0x5F0D42B1A956789FULL;
+inline constexpr uint64_t HASH_SEED2 = 0x9B1A75C3E0D6F2A7ULL;
+
+// The two base hashes fed to enhanced double hashing (see README.md)
+struct KeyHash {
+    uint64_t h1;
+    uint64_t h2;
+};
+
+inline KeyHash hash_key(const char* data, size_t len) {
+    return {XXH64(data, len, HASH_SEED1), XXH64(data, len, HASH_SEED2)};
+}
+
+// XXH64 as a constant expression, for filters built at compile time. Same
+// output as XXH64(); prefer hash_key() at run time.
+namespace xxh64_constexpr {
+
+inline constexpr uint64_t PRIME1 = 0x9E3779B185EBCA87ULL;
+inline constexpr uint64_t PRIME2 = 0xC2B2AE3D27D4EB4FULL;
+inline constexpr uint64_t PRIME3 = 0x165667B19E3779F9ULL;
+inline constexpr uint64_t PRIME4 = 0x85EBCA77C2B2AE63ULL;
+inline constexpr uint64_t PRIME5 = 0x27D4EB2F165667C5ULL;
+
+constexpr uint64_t rotl(uint64_t x, int r) { return (x << r) | (x >> (64 - r)); }
+
+constexpr uint64_t read_le(const char* p, size_t bytes) {
+    uint64_t v = 0;
+    for (size_t i = 0; i < bytes; ++i) v |= uint64_t{static_cast<unsigned char>(p[i])} << (8 * i);
+    return v;
+}
+
+constexpr uint64_t mix_round(uint64_t acc, uint64_t input) {
+    return rotl(acc + input * PRIME2, 31) * PRIME1;
+}
+
+constexpr uint64_t merge_round(uint64_t acc, uint64_t v) {
+    return (acc ^ mix_round(0, v)) * PRIME1 + PRIME4;
+}
+
+constexpr uint64_t hash(const char* p, size_t len, uint64_t seed) {
+    const char* const end = p + len;
+    uint64_t h = 0;
+    if (len >= 32) {
+        uint64_t v1 = seed + PRIME1 + PRIME2, v2 = seed + PRIME2, v3 = seed, v4 = seed - PRIME1;
+        for (; end - p >= 32; p += 32) {
+            v1 = mix_round(v1, read_le(p, 8));
+            v2 = mix_round(v2, read_le(p + 8, 8));
+            v3 = mix_round(v3, read_le(p + 16, 8));
+            v4 = mix_round(v4, read_le(p + 24, 8));
+        }
+        h = rotl(v1, 1) + rotl(v2, 7) + rotl(v3, 12) + rotl(v4, 18);
+        h = merge_round(merge_round(merge_round(merge_round(h, v1), v2), v3), v4);
+    } else {
+        h = seed + PRIME5;
+    }
+    h += len;
+    for (; end - p >= 8; p += 8) h = rotl(h ^ mix_round(0, read_le(p, 8)), 27) * PRIME1 + PRIME4;
+    if (end - p >= 4) {
+        h = rotl(h ^ (read_le(p, 4) * PRIME1), 23) * PRIME2 + PRIME3;
+        p += 4;
+    }
+    for (; p < end; ++p) h = rotl(h ^ (static_cast<unsigned char>(*p) * PRIME5), 11) * PRIME1;
+    h = (h ^ (h >> 33)) * PRIME2;
+    h = (h ^ (h >> 29)) * PRIME3;
+    return h ^ (h >> 32);
+}
+
+} // namespace xxh64_constexpr
+
+constexpr KeyHash hash_key_constexpr(std::string_view key) {
+    return {xxh64_constexpr::hash(key.data(), key.size(), HASH_SEED1),
+            xxh64_constexpr::hash(key.data(), key.size(), HASH_SEED2)};
+}
+
+// Murmur3 64-bit finalizer: cheap full-avalanche remix of an existing hash
+inline uint64_t mix64(uint64_t h) {
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDULL;
+    h ^= h >> 33;
+    h *= 0xC4CEB9FE1A85EC53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+// Map a 32-bit hash uniformly onto [0, n) without a division (Lemire)
+inline uint32_t reduce32(uint32_t hash, uint32_t n) {
+    return static_cast<uint32_t>((static_cast<uint64_t>(hash) * n) >> 32);
+}
+
+// 64-bit variant of reduce32
+inline uint64_t reduce64(uint64_t hash, uint64_t n) {
+#if defined(_MSC_VER) && !defined(__clang__)
+    return __umulh(hash, n);
+#else
+    return static_cast<uint64_t>((static_cast<unsigned __int128>(hash) * n) >> 64);
+#endif
+}
+
+#endif // BLOOM_HASHING_H
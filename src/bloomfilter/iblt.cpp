@@ -0,0 +1,165 @@
+#include "iblt.h"
+#include "byte_io.h"
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+namespace {
+
+constexpr char IBLT_MAGIC[4] = {'I', 'B', 'L', 'T'};
+constexpr uint8_t IBLT_VERSION = 1;
+constexpr size_t IBLT_HEADER_SIZE = 16; // magic, version, k, pad, num_cells
+constexpr size_t IBLT_CELL_SIZE = 4 + 8 + 8;
+
+} // namespace
+
+InvertibleBloomLookupTable::InvertibleBloomLookupTable(size_t num_cells,
+                                                       size_t num_hashes)
+    : num_hashes_(num_hashes) {
+  if (num_hashes_ < 2 || num_hashes_ > MAX_HASHES) {
+    throw std::invalid_argument("num_hashes must be between 2 and 8");
+  }
+  if (num_cells == 0) {
+    throw std::invalid_argument("num_cells must be > 0");
+  }
+  // Round up so every key touches exactly one cell per subtable
+  subtable_size_ = (num_cells + num_hashes_ - 1) / num_hashes_;
+  if (subtable_size_ > std::numeric_limits<uint32_t>::max()) {
+    throw std::overflow_error("num_cells too large");
+  }
+  const size_t total = subtable_size_ * num_hashes_;
+  counts_.assign(total, 0);
+  key_sums_.assign(total, 0);
+  hash_sums_.assign(total, 0);
+}
+
+void InvertibleBloomLookupTable::cell_indices(uint64_t key, size_t *out) const {
+  // Enhanced double hashing (see README.md) over a remix of the key id
+  uint64_t probe = mix64(key ^ HASH_SEED1);
+  uint64_t step = checksum(key);
+  const uint32_t len = static_cast<uint32_t>(subtable_size_);
+  for (size_t j = 0; j < num_hashes_; ++j) {
+    step += j;
+    out[j] = j * subtable_size_ + reduce32(static_cast<uint32_t>(probe >> 32), len);
+    probe += step;
+  }
+}
+
+void InvertibleBloomLookupTable::update(uint64_t key, int32_t delta) {
+  size_t idx[MAX_HASHES];
+  cell_indices(key, idx);
+  const uint64_t check = checksum(key);
+  for (size_t j = 0; j < num_hashes_; ++j) {
+    counts_[idx[j]] += delta;
+    key_sums_[idx[j]] ^= key;
+    hash_sums_[idx[j]] ^= check;
+  }
+}
+
+void InvertibleBloomLookupTable::update_many(const uint64_t *keys, size_t n,
+                                             int32_t delta) {
+  // Two passes per block: hash everything first (independent, pipelines
+  // well), then scatter into the three cell arrays.
+  size_t idx[BATCH * MAX_HASHES];
+  uint64_t checks[BATCH];
+  for (size_t base = 0; base < n; base += BATCH) {
+    const size_t m = std::min(BATCH, n - base);
+    for (size_t i = 0; i < m; ++i) {
+      cell_indices(keys[base + i], idx + i * num_hashes_);
+      checks[i] = checksum(keys[base + i]);
+    }
+    for (size_t i = 0; i < m; ++i) {
+      const uint64_t key = keys[base + i];
+      for (size_t j = 0; j < num_hashes_; ++j) {
+        const size_t c = idx[i * num_hashes_ + j];
+        counts_[c] += delta;
+        key_sums_[c] ^= key;
+        hash_sums_[c] ^= checks[i];
+      }
+    }
+  }
+}
+
+void InvertibleBloomLookupTable::subtract(const InvertibleBloomLookupTable &other) {
+  if (counts_.size() != other.counts_.size() || num_hashes_ != other.num_hashes_) {
+    throw std::invalid_argument("Cannot subtract IBLTs with different parameters");
+  }
+  const size_t total = counts_.size();
+  for (size_t c = 0; c < total; ++c) counts_[c] -= other.counts_[c];
+  for (size_t c = 0; c < total; ++c) key_sums_[c] ^= other.key_sums_[c];
+  for (size_t c = 0; c < total; ++c) hash_sums_[c] ^= other.hash_sums_[c];
+}
+
+bool InvertibleBloomLookupTable::decode(std::vector<uint64_t> &positive,
+                                        std::vector<uint64_t> &negative) const {
+  InvertibleBloomLookupTable t(*this);
+  positive.clear();
+  negative.clear();
+
+  auto is_pure = [&t](size_t c) {
+    return (t.counts_[c] == 1 || t.counts_[c] == -1) &&
+           t.hash_sums_[c] == checksum(t.key_sums_[c]);
+  };
+
+  std::vector<size_t> queue;
+  for (size_t c = 0; c < t.counts_.size(); ++c) {
+    if (is_pure(c)) queue.push_back(c);
+  }
+
+  size_t idx[MAX_HASHES];
+  while (!queue.empty()) {
+    const size_t c = queue.back();
+    queue.pop_back();
+    if (!is_pure(c)) continue; // emptied by an earlier peel
+    const uint64_t key = t.key_sums_[c];
+    const int32_t sign = t.counts_[c];
+    (sign > 0 ? positive : negative).push_back(key);
+    t.update(key, -sign);
+    t.cell_indices(key, idx);
+    for (size_t j = 0; j < t.num_hashes_; ++j) {
+      if (is_pure(idx[j])) queue.push_back(idx[j]);
+    }
+  }
+
+  for (size_t c = 0; c < t.counts_.size(); ++c) {
+    if (t.counts_[c] != 0 || t.key_sums_[c] != 0 || t.hash_sums_[c] != 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+std::string InvertibleBloomLookupTable::serialize() const {
+  std::string out;
+  out.reserve(IBLT_HEADER_SIZE + counts_.size() * IBLT_CELL_SIZE);
+  out.append(IBLT_MAGIC, sizeof(IBLT_MAGIC));
+  write_le<uint8_t>(out, IBLT_VERSION);
+  write_le<uint8_t>(out, static_cast<uint8_t>(num_hashes_));
+  write_le<uint16_t>(out, 0);
+  write_le<uint64_t>(out, counts_.size());
+  for (int32_t v : counts_) write_le(out, v);
+  for (uint64_t v : key_sums_) write_le(out, v);
+  for (uint64_t v : hash_sums_) write_le(out, v);
+  return out;
+}
+
+InvertibleBloomLookupTable
+InvertibleBloomLookupTable::deserialize(const char *data, size_t len) {
+  if (len < IBLT_HEADER_SIZE || std::string(data, 4) != std::string(IBLT_MAGIC, 4) ||
+      read_le<uint8_t>(data + 4) != IBLT_VERSION) {
+    throw std::invalid_argument("Invalid data for IBLT restoration");
+  }
+  const size_t num_hashes = read_le<uint8_t>(data + 5);
+  const uint64_t num_cells = read_le<uint64_t>(data + 8);
+  if (num_hashes == 0 || num_cells % num_hashes != 0 ||
+      num_cells > (len - IBLT_HEADER_SIZE) / IBLT_CELL_SIZE ||
+      len != IBLT_HEADER_SIZE + num_cells * IBLT_CELL_SIZE) {
+    throw std::invalid_argument("Invalid data for IBLT restoration");
+  }
+  InvertibleBloomLookupTable t(num_cells, num_hashes);
+  const char *p = data + IBLT_HEADER_SIZE;
+  for (auto &v : t.counts_) { v = read_le<int32_t>(p); p += 4; }
+  for (auto &v : t.key_sums_) { v = read_le<uint64_t>(p); p += 8; }
+  for (auto &v : t.hash_sums_) { v = read_le<uint64_t>(p); p += 8; }
+  return t;
+}
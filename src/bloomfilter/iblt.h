@@ -0,0 +1,60 @@
+#ifndef IBLT_H
+#define IBLT_H
+
+#include <vector>
+#include <string>
+#include <cstddef>
+#include <cstdint>
+
+#include "hashing.h"
+
+// Invertible Bloom Lookup Table over 64-bit key ids. Subtracting the tables
+// of two replicas cancels the shared keys; peeling the result recovers the
+// symmetric difference with O(difference) cells of traffic. String keys are
+// identified by their h1 (see key_id).
+class InvertibleBloomLookupTable {
+public:
+    InvertibleBloomLookupTable(size_t num_cells, size_t num_hashes);
+
+    static uint64_t key_id(const char* data, size_t len) {
+        return XXH64(data, len, HASH_SEED1);
+    }
+
+    void insert(uint64_t key) { update(key, 1); }
+    void erase(uint64_t key) { update(key, -1); }
+    void insert_many(const uint64_t* keys, size_t n) { update_many(keys, n, 1); }
+    void erase_many(const uint64_t* keys, size_t n) { update_many(keys, n, -1); }
+
+    // this -= other; both tables must share num_cells and num_hashes
+    void subtract(const InvertibleBloomLookupTable& other);
+
+    // Peel a copy of the table. Keys with net count +1 go to `positive`,
+    // -1 to `negative`. Returns false if a residue could not be peeled.
+    bool decode(std::vector<uint64_t>& positive,
+                std::vector<uint64_t>& negative) const;
+
+    std::string serialize() const;
+    static InvertibleBloomLookupTable deserialize(const char* data, size_t len);
+
+    // Accessors
+    size_t get_num_cells() const { return counts_.size(); }
+    size_t get_num_hashes() const { return num_hashes_; }
+
+private:
+    void update(uint64_t key, int32_t delta);
+    void update_many(const uint64_t* keys, size_t n, int32_t delta);
+    void cell_indices(uint64_t key, size_t* out) const;
+    static uint64_t checksum(uint64_t key) { return mix64(key ^ HASH_SEED2); }
+
+    static constexpr size_t MAX_HASHES = 8;
+    static constexpr size_t BATCH = 256;
+
+    // Structure of arrays: subtraction and zero checks are straight loops
+    std::vector<int32_t> counts_;
+    std::vector<uint64_t> key_sums_;
+    std::vector<uint64_t> hash_sums_;
+    size_t num_hashes_;
+    size_t subtable_size_; // cells are split into num_hashes_ disjoint ranges
+};
+
+#endif // IBLT_H
@@ -0,0 +1,142 @@
+#include "io_uring.h"
+
+#ifdef BLOOM_HAVE_IO_URING
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <system_error>
+#include <unistd.h>
+
+namespace {
+
+int io_uring_setup(unsigned entries, io_uring_params *params) {
+  return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+}
+
+int io_uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags) {
+  return static_cast<int>(
+      syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, nullptr, 0));
+}
+
+int io_uring_register(int fd, unsigned opcode, void *arg, unsigned nr_args) {
+  return static_cast<int>(syscall(__NR_io_uring_register, fd, opcode, arg, nr_args));
+}
+
+// IORING_OP_READ and IORING_REGISTER_PROBE both arrived in 5.6; a 5.1-5.5
+// ring sets up fine but fails every read with -EINVAL
+bool supports_read(int fd) {
+  constexpr unsigned OPS = 256;
+  alignas(io_uring_probe) char buf[sizeof(io_uring_probe) + OPS * sizeof(io_uring_probe_op)] = {};
+  auto *probe = reinterpret_cast<io_uring_probe *>(buf);
+  if (io_uring_register(fd, IORING_REGISTER_PROBE, probe, OPS) < 0) return false;
+  return IORING_OP_READ <= probe->last_op &&
+         (probe->ops[IORING_OP_READ].flags & IO_URING_OP_SUPPORTED);
+}
+
+[[noreturn]] void throw_errno(const char *what) {
+  throw std::system_error(errno, std::generic_category(), what);
+}
+
+template <typename T>
+T *at(void *base, unsigned offset) {
+  return reinterpret_cast<T *>(static_cast<char *>(base) + offset);
+}
+
+} // namespace
+
+IoUring::IoUring(unsigned entries) {
+  io_uring_params params;
+  std::memset(&params, 0, sizeof(params));
+  fd_ = io_uring_setup(entries, &params);
+  if (fd_ < 0) throw_errno("io_uring_setup");
+  if (!supports_read(fd_)) {
+    close(fd_);
+    throw std::system_error(EOPNOTSUPP, std::generic_category(), "io_uring without IORING_OP_READ");
+  }
+  sq_entries_ = params.sq_entries;
+
+  sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  cq_ring_size_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+  const bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+  if (single_mmap) {
+    sq_ring_size_ = cq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+  }
+  sq_ring_ = mmap(nullptr, sq_ring_size_, PROT_READ | PROT_WRITE,
+                  MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQ_RING);
+  if (sq_ring_ == MAP_FAILED) {
+    sq_ring_ = nullptr;
+    const int err = errno;
+    close(fd_);
+    errno = err;
+    throw_errno("mmap(io_uring sq)");
+  }
+  cq_ring_ = single_mmap ? sq_ring_
+                         : mmap(nullptr, cq_ring_size_, PROT_READ | PROT_WRITE,
+                                MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_CQ_RING);
+  sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+  void *sqes = cq_ring_ == MAP_FAILED
+                   ? MAP_FAILED
+                   : mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE,
+                          MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQES);
+  if (sqes == MAP_FAILED) {
+    const int err = errno;
+    if (cq_ring_ != MAP_FAILED && cq_ring_ != sq_ring_) munmap(cq_ring_, cq_ring_size_);
+    munmap(sq_ring_, sq_ring_size_);
+    close(fd_);
+    errno = err;
+    throw_errno("mmap(io_uring cq/sqes)");
+  }
+  sqes_ = static_cast<io_uring_sqe *>(sqes);
+
+  sq_head_ = at<unsigned>(sq_ring_, params.sq_off.head);
+  sq_tail_ = at<unsigned>(sq_ring_, params.sq_off.tail);
+  sq_mask_ = at<unsigned>(sq_ring_, params.sq_off.ring_mask);
+  sq_array_ = at<unsigned>(sq_ring_, params.sq_off.array);
+  cq_head_ = at<unsigned>(cq_ring_, params.cq_off.head);
+  cq_tail_ = at<unsigned>(cq_ring_, params.cq_off.tail);
+  cq_mask_ = at<unsigned>(cq_ring_, params.cq_off.ring_mask);
+  cqes_ = at<io_uring_cqe>(cq_ring_, params.cq_off.cqes);
+}
+
+IoUring::~IoUring() {
+  munmap(sqes_, sqes_size_);
+  if (cq_ring_ != sq_ring_) munmap(cq_ring_, cq_ring_size_);
+  munmap(sq_ring_, sq_ring_size_);
+  close(fd_);
+}
+
+bool IoUring::queue_read(int fd, void *buf, unsigned len, uint64_t offset,
+                         uint64_t user_data) {
+  const unsigned tail = *sq_tail_;
+  if (tail - __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE) >= sq_entries_) return false;
+  const unsigned index = tail & *sq_mask_;
+  io_uring_sqe &sqe = sqes_[index];
+  std::memset(&sqe, 0, sizeof(sqe));
+  sqe.opcode = IORING_OP_READ;
+  sqe.fd = fd;
+  sqe.addr = reinterpret_cast<uint64_t>(buf);
+  sqe.len = len;
+  sqe.off = offset;
+  sqe.user_data = user_data;
+  sq_array_[index] = index;
+  __atomic_store_n(sq_tail_, tail + 1, __ATOMIC_RELEASE);
+  ++pending_;
+  return true;
+}
+
+void IoUring::submit_and_wait(unsigned min_complete) {
+  for (;;) {
+    const int r = io_uring_enter(fd_, pending_, min_complete,
+                                 min_complete ? IORING_ENTER_GETEVENTS : 0);
+    if (r >= 0) {
+      pending_ -= static_cast<unsigned>(r) < pending_ ? static_cast<unsigned>(r) : pending_;
+      return;
+    }
+    if (errno != EINTR && errno != EAGAIN && errno != EBUSY) throw_errno("io_uring_enter");
+  }
+}
+
+#endif // BLOOM_HAVE_IO_URING
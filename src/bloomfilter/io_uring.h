@@ -0,0 +1,74 @@
+#ifndef BLOOM_IO_URING_H
+#define BLOOM_IO_URING_H
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define BLOOM_HAVE_IO_URING 1
+#endif
+#endif
+
+#ifdef BLOOM_HAVE_IO_URING
+
+#include <cstddef>
+#include <cstdint>
+#include <linux/io_uring.h>
+
+// Minimal io_uring read queue over the raw syscalls (no liburing). One
+// instance per thread; the constructor throws std::system_error when the
+// kernel lacks io_uring or IORING_OP_READ (before 5.6), or it is blocked
+// (seccomp, container policy).
+class IoUring {
+public:
+    explicit IoUring(unsigned entries);
+    ~IoUring();
+
+    IoUring(const IoUring&) = delete;
+    IoUring& operator=(const IoUring&) = delete;
+
+    unsigned capacity() const { return sq_entries_; }
+
+    // Queue a read; false if the submission queue is full
+    bool queue_read(int fd, void* buf, unsigned len, uint64_t offset, uint64_t user_data);
+    // Submit queued reads and wait for at least min_complete completions
+    void submit_and_wait(unsigned min_complete);
+
+    // Calls fn(user_data, result) for every available completion; returns
+    // the number reaped. result is bytes read or -errno.
+    template <typename Fn>
+    unsigned reap(Fn&& fn) {
+        unsigned head = *cq_head_;
+        const unsigned tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+        unsigned n = 0;
+        for (; head != tail; ++head, ++n) {
+            const io_uring_cqe& cqe = cqes_[head & *cq_mask_];
+            fn(cqe.user_data, cqe.res);
+        }
+        __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+        return n;
+    }
+
+private:
+    int fd_ = -1;
+    unsigned sq_entries_ = 0;
+    unsigned pending_ = 0; // queued but not yet submitted
+
+    void* sq_ring_ = nullptr;
+    size_t sq_ring_size_ = 0;
+    void* cq_ring_ = nullptr; // == sq_ring_ with IORING_FEAT_SINGLE_MMAP
+    size_t cq_ring_size_ = 0;
+    io_uring_sqe* sqes_ = nullptr;
+    size_t sqes_size_ = 0;
+
+    unsigned* sq_head_;
+    unsigned* sq_tail_;
+    unsigned* sq_mask_;
+    unsigned* sq_array_;
+    unsigned* cq_head_;
+    unsigned* cq_tail_;
+    unsigned* cq_mask_;
+    io_uring_cqe* cqes_;
+};
+
+#endif // BLOOM_HAVE_IO_URING
+
+#endif // BLOOM_IO_URING_H
@@ -0,0 +1,44 @@
+#ifndef KEY_BATCH_H
+#define KEY_BATCH_H
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Variable-length keys packed into one arena: a single data buffer plus an
+// offsets array. Lets batch operations run without touching Python objects.
+class KeyBatch {
+public:
+    KeyBatch() : offsets_{0} {}
+
+    void reserve(size_t num_keys, size_t num_bytes) {
+        offsets_.reserve(num_keys + 1);
+        data_.reserve(num_bytes);
+    }
+
+    void push_back(const char* data, size_t len) {
+        data_.append(data, len);
+        offsets_.push_back(data_.size());
+    }
+    void push_back(std::string_view key) { push_back(key.data(), key.size()); }
+
+    void clear() {
+        data_.clear();
+        offsets_.assign(1, 0);
+    }
+
+    size_t size() const { return offsets_.size() - 1; }
+    bool empty() const { return size() == 0; }
+    size_t num_bytes() const { return data_.size(); }
+
+    const char* data(size_t i) const { return data_.data() + offsets_[i]; }
+    size_t length(size_t i) const { return offsets_[i + 1] - offsets_[i]; }
+    std::string_view operator[](size_t i) const { return {data(i), length(i)}; }
+
+private:
+    std::string data_;
+    std::vector<size_t> offsets_;
+};
+
+#endif // KEY_BATCH_H
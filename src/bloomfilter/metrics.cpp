@@ -0,0 +1,211 @@
+#include "metrics.h"
+
+#ifdef BLOOMFILTER_METRICS
+
+#include <cstdio>
+#include <mutex>
+#include <unordered_set>
+#include <vector>
+
+namespace {
+
+struct Registry {
+  std::mutex mutex;
+  std::unordered_set<FilterMetrics *> live;
+  uint64_t next_id = 0;
+};
+
+Registry &registry() {
+  static Registry *r = new Registry; // leaked: filters may outlive static destruction
+  return *r;
+}
+
+size_t thread_shard() {
+  static std::atomic<size_t> next{0};
+  thread_local const size_t index =
+      next.fetch_add(1, std::memory_order_relaxed) % FilterMetrics::SHARDS;
+  return index;
+}
+
+inline unsigned popcount64(uint64_t x) {
+#if defined(_MSC_VER) && !defined(__clang__)
+  return static_cast<unsigned>(__popcnt64(x));
+#else
+  return static_cast<unsigned>(__builtin_popcountll(x));
+#endif
+}
+
+uint64_t sum(const std::atomic<uint64_t> &a) { return a.load(std::memory_order_relaxed); }
+
+std::string escape_label(const std::string &s) {
+  std::string out;
+  for (char c : s) {
+    if (c == '\\' || c == '"') out.push_back('\\');
+    if (c == '\n') {
+      out += "\\n";
+      continue;
+    }
+    out.push_back(c);
+  }
+  return out;
+}
+
+} // namespace
+
+FilterMetrics::FilterMetrics(uint64_t num_bits, const uint64_t *words)
+    : num_bits_(num_bits), words_(words) {
+  Registry &r = registry();
+  std::lock_guard<std::mutex> lock(r.mutex);
+  name_ = "filter" + std::to_string(r.next_id++);
+  r.live.insert(this);
+}
+
+FilterMetrics::~FilterMetrics() {
+  Registry &r = registry();
+  std::lock_guard<std::mutex> lock(r.mutex);
+  r.live.erase(this);
+}
+
+FilterMetrics::Shard &FilterMetrics::shard() const { return shards_[thread_shard()]; }
+
+FilterMetrics::BatchScope::BatchScope(FilterMetrics &metrics, BatchKind kind, uint64_t n)
+    : metrics_(metrics), kind_(kind) {
+  BatchCounters &b = metrics_.batches_[kind_];
+  const uint64_t call = b.calls.fetch_add(1, std::memory_order_relaxed);
+  b.keys.fetch_add(n, std::memory_order_relaxed);
+  timed_ = call % SAMPLE_EVERY == 0;
+  if (timed_) start_ = std::chrono::steady_clock::now();
+}
+
+FilterMetrics::BatchScope::~BatchScope() {
+  if (!timed_) return;
+  const uint64_t nanos = static_cast<uint64_t>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start_)
+          .count());
+  size_t bucket = 0;
+  for (uint64_t bound = 1000; bucket < LATENCY_BUCKETS && nanos > bound; bound *= 4) ++bucket;
+  BatchCounters &b = metrics_.batches_[kind_];
+  b.timed.fetch_add(1, std::memory_order_relaxed);
+  b.nanos.fetch_add(nanos, std::memory_order_relaxed);
+  b.buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+}
+
+uint64_t FilterMetrics::bits_set() const {
+  uint64_t added = 0;
+  for (const Shard &s : shards_) added += sum(s.new_bits);
+  std::call_once(initial_once_, [&] {
+    if (!words_) return;
+    uint64_t bits = 0;
+    for (uint64_t w = 0; w < (num_bits_ + 63) / 64; ++w) bits += popcount64(words_[w]);
+    // Counted adds made before this first read are already in `added`
+    initial_bits_ = bits - added;
+  });
+  return initial_bits_ + added;
+}
+
+FilterMetrics::Snapshot FilterMetrics::snapshot() const {
+  Snapshot snap;
+  for (const Shard &s : shards_) {
+    snap.adds += sum(s.adds);
+    snap.queries += sum(s.queries);
+    snap.positives += sum(s.positives);
+  }
+  snap.bits_set = bits_set();
+  snap.num_bits = num_bits_;
+  for (int k = 0; k < 2; ++k) {
+    const BatchCounters &b = batches_[k];
+    BatchStats &out = snap.batches[k];
+    out.calls = sum(b.calls);
+    out.keys = sum(b.keys);
+    out.timed = sum(b.timed);
+    out.nanos = sum(b.nanos);
+    for (size_t i = 0; i <= LATENCY_BUCKETS; ++i) out.buckets[i] = sum(b.buckets[i]);
+  }
+  return snap;
+}
+
+std::string FilterMetrics::name() const {
+  std::lock_guard<std::mutex> lock(registry().mutex);
+  return name_;
+}
+
+void FilterMetrics::set_name(std::string name) {
+  std::lock_guard<std::mutex> lock(registry().mutex);
+  name_ = std::move(name);
+}
+
+std::string FilterMetrics::prometheus_text() {
+  struct Row {
+    std::string label;
+    Snapshot snap;
+  };
+  std::vector<Row> rows;
+  {
+    Registry &r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    for (const FilterMetrics *m : r.live) {
+      rows.push_back({"filter=\"" + escape_label(m->name_) + "\"", m->snapshot()});
+    }
+  }
+
+  std::string out;
+  auto family = [&out](const char *name, const char *type, const char *help) {
+    out += std::string("# HELP ") + name + " " + help + "\n# TYPE " + name + " " + type + "\n";
+  };
+  auto sample = [&out](const std::string &name, const std::string &labels, double value) {
+    char buf[32];
+    std::snprintf(buf, sizeof(buf), "%.17g", value);
+    out += name + "{" + labels + "} " + buf + "\n";
+  };
+
+  family("bloomfilter_adds_total", "counter", "Keys added");
+  for (const Row &row : rows) sample("bloomfilter_adds_total", row.label, double(row.snap.adds));
+  family("bloomfilter_queries_total", "counter", "Membership queries");
+  for (const Row &row : rows) sample("bloomfilter_queries_total", row.label, double(row.snap.queries));
+  family("bloomfilter_positives_total", "counter", "Queries answered \"maybe present\"");
+  for (const Row &row : rows) {
+    sample("bloomfilter_positives_total", row.label, double(row.snap.positives));
+  }
+  family("bloomfilter_fill_ratio", "gauge", "Fraction of bits set (saturation)");
+  for (const Row &row : rows) {
+    sample("bloomfilter_fill_ratio", row.label,
+           row.snap.num_bits ? double(row.snap.bits_set) / double(row.snap.num_bits) : 0.0);
+  }
+
+  static const char *const KINDS[2] = {"add", "query"};
+  family("bloomfilter_batch_calls_total", "counter", "Batch calls");
+  for (const Row &row : rows) {
+    for (int k = 0; k < 2; ++k) {
+      sample("bloomfilter_batch_calls_total", row.label + ",op=\"" + KINDS[k] + "\"",
+             double(row.snap.batches[k].calls));
+    }
+  }
+  family("bloomfilter_batch_keys_total", "counter", "Keys passed to batch calls");
+  for (const Row &row : rows) {
+    for (int k = 0; k < 2; ++k) {
+      sample("bloomfilter_batch_keys_total", row.label + ",op=\"" + KINDS[k] + "\"",
+             double(row.snap.batches[k].keys));
+    }
+  }
+  family("bloomfilter_batch_seconds", "histogram", "Latency of sampled batch calls");
+  for (const Row &row : rows) {
+    for (int k = 0; k < 2; ++k) {
+      const BatchStats &b = row.snap.batches[k];
+      const std::string labels = row.label + ",op=\"" + KINDS[k] + "\"";
+      uint64_t cumulative = 0;
+      double bound = 1e-6;
+      for (size_t i = 0; i < LATENCY_BUCKETS; ++i, bound *= 4) {
+        cumulative += b.buckets[i];
+        char le[32];
+        std::snprintf(le, sizeof(le), "%g", bound);
+        sample("bloomfilter_batch_seconds_bucket", labels + ",le=\"" + le + "\"", double(cumulative));
+      }
+      sample("bloomfilter_batch_seconds_bucket", labels + ",le=\"+Inf\"", double(b.timed));
+      sample("bloomfilter_batch_seconds_sum", labels, double(b.nanos) * 1e-9);
+      sample("bloomfilter_batch_seconds_count", labels, double(b.timed));
+    }
+  }
+  return out;
+}
+
+#endif // BLOOMFILTER_METRICS
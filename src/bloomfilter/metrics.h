@@ -0,0 +1,146 @@
+#ifndef BLOOM_METRICS_H
+#define BLOOM_METRICS_H
+
+// Optional operation counters, compiled in with -DBLOOMFILTER_METRICS (the
+// BLOOMFILTER_METRICS CMake option). Instrumented code wraps every metrics
+// statement in BLOOM_METRIC(...), which expands to nothing when disabled.
+#ifdef BLOOMFILTER_METRICS
+#define BLOOM_METRIC(...) __VA_ARGS__
+#else
+#define BLOOM_METRIC(...)
+#endif
+
+#ifdef BLOOMFILTER_METRICS
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+
+// Counters for one filter. Updates go to one of SHARDS cache-line sized
+// shards picked per thread, so concurrent writers rarely share a line;
+// readers sum the shards. Live instances are registered for
+// prometheus_text().
+class FilterMetrics {
+public:
+    enum BatchKind { ADD_BATCH = 0, QUERY_BATCH = 1 };
+    static constexpr size_t SHARDS = 16;
+    // Latency buckets: <= 1us * 4^i, plus +Inf
+    static constexpr size_t LATENCY_BUCKETS = 12;
+    // One batch call in SAMPLE_EVERY is timed
+    static constexpr uint64_t SAMPLE_EVERY = 8;
+
+    struct BatchStats {
+        uint64_t calls = 0;
+        uint64_t keys = 0;
+        uint64_t timed = 0;
+        uint64_t nanos = 0;
+        std::array<uint64_t, LATENCY_BUCKETS + 1> buckets{}; // cumulative is computed on export
+    };
+
+    struct Snapshot {
+        uint64_t adds = 0;
+        uint64_t queries = 0;
+        uint64_t positives = 0;
+        uint64_t bits_set = 0;
+        uint64_t num_bits = 0;
+        BatchStats batches[2];
+    };
+
+    // `words` is the filter's bit array. It is popcounted once, on the first
+    // bits_set() or snapshot() call, so restoring a filter costs no scan;
+    // nullptr means the filter starts clear.
+    FilterMetrics(uint64_t num_bits, const uint64_t* words);
+    ~FilterMetrics();
+
+    FilterMetrics(const FilterMetrics&) = delete;
+    FilterMetrics& operator=(const FilterMetrics&) = delete;
+
+    void on_adds(uint64_t n, uint64_t new_bits) {
+        Shard& s = shard();
+        s.adds.fetch_add(n, std::memory_order_relaxed);
+        if (new_bits) s.new_bits.fetch_add(new_bits, std::memory_order_relaxed);
+    }
+    void on_queries(uint64_t n, uint64_t positives) {
+        Shard& s = shard();
+        s.queries.fetch_add(n, std::memory_order_relaxed);
+        if (positives) s.positives.fetch_add(positives, std::memory_order_relaxed);
+    }
+    // Bits set by something other than counted adds (union); exact count
+    void on_new_bits(uint64_t new_bits) { shard().new_bits.fetch_add(new_bits, std::memory_order_relaxed); }
+
+    // Counts one batch call of n keys; times it if sampled
+    class BatchScope {
+    public:
+        BatchScope(FilterMetrics& metrics, BatchKind kind, uint64_t n);
+        ~BatchScope();
+
+    private:
+        FilterMetrics& metrics_;
+        BatchKind kind_;
+        bool timed_;
+        std::chrono::steady_clock::time_point start_;
+    };
+
+    Snapshot snapshot() const;
+    uint64_t bits_set() const;
+    uint64_t num_bits() const { return num_bits_; }
+
+    // Label used by prometheus_text(); defaults to "filter<N>"
+    std::string name() const;
+    void set_name(std::string name);
+
+    // Every live filter in the Prometheus text exposition format
+    static std::string prometheus_text();
+
+private:
+    struct alignas(64) Shard {
+        std::atomic<uint64_t> adds{0};
+        std::atomic<uint64_t> queries{0};
+        std::atomic<uint64_t> positives{0};
+        std::atomic<uint64_t> new_bits{0};
+    };
+    struct alignas(64) BatchCounters {
+        std::atomic<uint64_t> calls{0};
+        std::atomic<uint64_t> keys{0};
+        std::atomic<uint64_t> timed{0};
+        std::atomic<uint64_t> nanos{0};
+        std::atomic<uint64_t> buckets[LATENCY_BUCKETS + 1] = {};
+    };
+
+    Shard& shard() const;
+
+    const uint64_t num_bits_;
+    const uint64_t* const words_;
+    mutable std::once_flag initial_once_;
+    mutable uint64_t initial_bits_ = 0; // bits set before the first counted add
+    mutable Shard shards_[SHARDS];
+    BatchCounters batches_[2];
+    std::string name_; // guarded by the registry mutex
+};
+
+// Owning pointer for BloomFilter members. Move-only: a copied filter needs
+// counters over its own bits, which BloomFilter's copy constructor resets.
+class MetricsHandle {
+public:
+    MetricsHandle() = default;
+    MetricsHandle(MetricsHandle&&) noexcept = default;
+    MetricsHandle& operator=(MetricsHandle&&) noexcept = default;
+
+    void reset(uint64_t num_bits, const uint64_t* words) {
+        p_ = std::make_unique<FilterMetrics>(num_bits, words);
+    }
+    FilterMetrics* operator->() const { return p_.get(); }
+    FilterMetrics& operator*() const { return *p_; }
+
+private:
+    std::unique_ptr<FilterMetrics> p_;
+};
+
+#endif // BLOOMFILTER_METRICS
+
+#endif // BLOOM_METRICS_H
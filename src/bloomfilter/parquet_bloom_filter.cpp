@@ -0,0 +1,228 @@
+#include "parquet_bloom_filter.h"
+#include "byte_io.h"
+#include "filter_layout.h"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace {
+
+constexpr size_t MIN_BYTES = 32;
+constexpr size_t MAX_BYTES = 128 * 1024 * 1024;
+
+// Thrift compact protocol element types
+enum : uint8_t {
+  T_STOP = 0, T_TRUE = 1, T_FALSE = 2, T_BYTE = 3, T_I16 = 4, T_I32 = 5,
+  T_I64 = 6, T_DOUBLE = 7, T_BINARY = 8, T_LIST = 9, T_SET = 10, T_MAP = 11,
+  T_STRUCT = 12
+};
+
+// Minimal Thrift compact reader: enough for BloomFilterHeader, skipping any
+// field a newer writer may add
+class CompactReader {
+public:
+  CompactReader(const char *data, size_t len) : p_(data), end_(data + len) {}
+
+  size_t consumed(const char *start) const { return static_cast<size_t>(p_ - start); }
+
+  uint8_t byte() {
+    if (p_ >= end_) throw std::invalid_argument("Truncated Parquet bloom filter header");
+    return static_cast<uint8_t>(*p_++);
+  }
+
+  uint64_t varint() {
+    uint64_t v = 0;
+    for (unsigned shift = 0; shift < 64; shift += 7) {
+      const uint8_t b = byte();
+      v |= static_cast<uint64_t>(b & 0x7F) << shift;
+      if (!(b & 0x80)) return v;
+    }
+    throw std::invalid_argument("Malformed varint in Parquet bloom filter header");
+  }
+
+  int64_t zigzag() {
+    const uint64_t v = varint();
+    return static_cast<int64_t>(v >> 1) ^ -static_cast<int64_t>(v & 1);
+  }
+
+  // Returns false at the struct's stop marker
+  bool field(int16_t &id, uint8_t &type, int16_t &last_id) {
+    const uint8_t header = byte();
+    type = header & 0x0F;
+    if (type == T_STOP) return false;
+    const uint8_t delta = header >> 4;
+    id = delta ? static_cast<int16_t>(last_id + delta) : static_cast<int16_t>(zigzag());
+    last_id = id;
+    return true;
+  }
+
+  void skip(uint8_t type, int depth = 0) {
+    if (depth > 32) throw std::invalid_argument("Parquet bloom filter header nested too deeply");
+    switch (type) {
+    case T_TRUE: case T_FALSE: return;
+    case T_BYTE: byte(); return;
+    case T_I16: case T_I32: case T_I64: varint(); return;
+    case T_DOUBLE: advance(8); return;
+    case T_BINARY: advance(varint()); return;
+    case T_LIST: case T_SET: {
+      const uint8_t header = byte();
+      uint64_t size = header >> 4;
+      if (size == 15) size = varint();
+      for (uint64_t i = 0; i < size; ++i) skip(header & 0x0F, depth + 1);
+      return;
+    }
+    case T_MAP: {
+      const uint64_t size = varint();
+      if (size == 0) return;
+      const uint8_t types = byte();
+      for (uint64_t i = 0; i < size; ++i) {
+        skip(types >> 4, depth + 1);
+        skip(types & 0x0F, depth + 1);
+      }
+      return;
+    }
+    case T_STRUCT: {
+      int16_t id, last = 0;
+      uint8_t t;
+      while (field(id, t, last)) skip(t, depth + 1);
+      return;
+    }
+    default:
+      throw std::invalid_argument("Unknown Thrift type in Parquet bloom filter header");
+    }
+  }
+
+  // Reads a union struct and returns the id of its (single) set member
+  int16_t union_member() {
+    int16_t id, last = 0, member = -1;
+    uint8_t t;
+    while (field(id, t, last)) {
+      member = id;
+      skip(t);
+    }
+    return member;
+  }
+
+private:
+  void advance(uint64_t n) {
+    if (n > static_cast<uint64_t>(end_ - p_)) {
+      throw std::invalid_argument("Truncated Parquet bloom filter header");
+    }
+    p_ += n;
+  }
+
+  const char *p_;
+  const char *end_;
+};
+
+void write_varint(std::string &out, uint64_t v) {
+  while (v >= 0x80) {
+    out.push_back(static_cast<char>((v & 0x7F) | 0x80));
+    v >>= 7;
+  }
+  out.push_back(static_cast<char>(v));
+}
+
+} // namespace
+
+ParquetBloomFilter::ParquetBloomFilter(size_t num_bytes) {
+  if (num_bytes == 0 || num_bytes % BYTES_PER_BLOCK != 0) {
+    throw std::invalid_argument("num_bytes must be a positive multiple of 32");
+  }
+  words_.assign(num_bytes / sizeof(uint32_t), 0);
+}
+
+size_t ParquetBloomFilter::optimal_num_bytes(size_t ndv, double fpp) {
+  if (fpp <= 0.0 || fpp >= 1.0) {
+    throw std::invalid_argument("fpp must be between 0 and 1");
+  }
+  // m = -8 * ndv / ln(1 - fpp^(1/8)), as in the reference implementations
+  const double bits = -8.0 * static_cast<double>(ndv) /
+                      std::log(1.0 - std::pow(fpp, 1.0 / 8.0));
+  size_t bytes = MIN_BYTES;
+  while (bytes < MAX_BYTES && static_cast<double>(bytes) * 8 < bits) bytes <<= 1;
+  return bytes;
+}
+
+void ParquetBloomFilter::insert_hash(uint64_t hash) {
+  uint32_t *block = &words_[block_index(hash) * WORDS_PER_BLOCK];
+  const uint32_t key = static_cast<uint32_t>(hash);
+  for (size_t i = 0; i < WORDS_PER_BLOCK; ++i) {
+    block[i] |= 1U << ((key * SPLIT_BLOCK_SALT[i]) >> 27);
+  }
+}
+
+bool ParquetBloomFilter::check_hash(uint64_t hash) const {
+  const uint32_t *block = &words_[block_index(hash) * WORDS_PER_BLOCK];
+  const uint32_t key = static_cast<uint32_t>(hash);
+  // Branch-free over the block: all eight words share one cache line
+  uint32_t missing = 0;
+  for (size_t i = 0; i < WORDS_PER_BLOCK; ++i) {
+    missing |= ~block[i] & (1U << ((key * SPLIT_BLOCK_SALT[i]) >> 27));
+  }
+  return missing == 0;
+}
+
+ParquetBloomFilter ParquetBloomFilter::from_parquet_bytes(const char *data,
+                                                          size_t len,
+                                                          bool has_header) {
+  size_t num_bytes = len - len % BYTES_PER_BLOCK;
+  size_t offset = 0;
+  if (has_header) {
+    CompactReader reader(data, len);
+    int64_t declared = -1;
+    int16_t algorithm = -1, hash = -1, compression = -1;
+    int16_t id, last = 0;
+    uint8_t type;
+    while (reader.field(id, type, last)) {
+      if (id == 1 && type == T_I32) {
+        declared = reader.zigzag();
+      } else if (id >= 2 && id <= 4 && type == T_STRUCT) {
+        const int16_t member = reader.union_member();
+        (id == 2 ? algorithm : id == 3 ? hash : compression) = member;
+      } else {
+        reader.skip(type);
+      }
+    }
+    if (algorithm != 1 || hash != 1 || compression != 1) {
+      throw std::invalid_argument(
+          "Unsupported Parquet bloom filter: expected BLOCK / XXHASH / UNCOMPRESSED");
+    }
+    if (declared <= 0) {
+      throw std::invalid_argument("Parquet bloom filter header lacks numBytes");
+    }
+    offset = reader.consumed(data);
+    num_bytes = static_cast<size_t>(declared);
+    if (num_bytes > len - offset) {
+      throw std::invalid_argument("Parquet bloom filter bitset is truncated");
+    }
+  }
+
+  ParquetBloomFilter filter(num_bytes);
+  const char *bits = data + offset;
+  for (size_t i = 0; i < filter.words_.size(); ++i) {
+    filter.words_[i] = read_le<uint32_t>(bits + i * sizeof(uint32_t));
+  }
+  return filter;
+}
+
+std::string ParquetBloomFilter::to_parquet_bytes(bool with_header) const {
+  std::string out;
+  out.reserve(16 + get_num_bytes());
+  if (with_header) {
+    const int64_t n = static_cast<int64_t>(get_num_bytes());
+    out.push_back(static_cast<char>(0x10 | T_I32)); // 1: numBytes
+    write_varint(out, static_cast<uint64_t>((n << 1) ^ (n >> 63)));
+    // 2: algorithm {1: BLOCK {}}, 3: hash {1: XXHASH {}},
+    // 4: compression {1: UNCOMPRESSED {}}
+    for (int field = 2; field <= 4; ++field) {
+      out.push_back(static_cast<char>(0x10 | T_STRUCT));
+      out.push_back(static_cast<char>(0x10 | T_STRUCT));
+      out.push_back(static_cast<char>(T_STOP));
+      out.push_back(static_cast<char>(T_STOP));
+    }
+    out.push_back(static_cast<char>(T_STOP));
+  }
+  for (uint32_t word : words_) write_le(out, word);
+  return out;
+}
@@ -0,0 +1,55 @@
+#ifndef PARQUET_BLOOM_FILTER_H
+#define PARQUET_BLOOM_FILTER_H
+
+#include <vector>
+#include <string>
+#include <cstddef>
+#include <cstdint>
+
+#include "xxhash.h"
+
+// Split-block Bloom filter exactly as specified by Apache Parquet
+// (parquet-format BloomFilter.md): 256-bit blocks of eight 32-bit words,
+// one salted bit per word, XXH64 (seed 0) of the value's PLAIN encoding.
+// Reads and writes the on-disk bytes: Thrift compact BloomFilterHeader
+// followed by the little-endian bitset.
+class ParquetBloomFilter {
+public:
+    // num_bytes must be a positive multiple of 32
+    explicit ParquetBloomFilter(size_t num_bytes);
+
+    // Bitset size parquet writers use for ndv distinct values at rate fpp:
+    // a power of two between 32 bytes and 128 MiB
+    static size_t optimal_num_bytes(size_t ndv, double fpp);
+
+    // Parse filter bytes as stored at a column chunk's bloom_filter_offset.
+    // With has_header=false the input is the bare bitset. Trailing bytes
+    // past the bitset are ignored.
+    static ParquetBloomFilter from_parquet_bytes(const char* data, size_t len,
+                                                 bool has_header = true);
+    std::string to_parquet_bytes(bool with_header = true) const;
+
+    // Hash of a PLAIN-encoded value (for BYTE_ARRAY: the raw bytes)
+    static uint64_t hash(const char* data, size_t len) { return XXH64(data, len, 0); }
+
+    void insert(const char* data, size_t len) { insert_hash(hash(data, len)); }
+    bool check(const char* data, size_t len) const { return check_hash(hash(data, len)); }
+    void insert_hash(uint64_t hash);
+    bool check_hash(uint64_t hash) const;
+
+    // Accessors
+    size_t get_num_bytes() const { return words_.size() * sizeof(uint32_t); }
+    size_t get_num_blocks() const { return words_.size() / WORDS_PER_BLOCK; }
+
+private:
+    static constexpr size_t WORDS_PER_BLOCK = 8;
+    static constexpr size_t BYTES_PER_BLOCK = 32;
+
+    size_t block_index(uint64_t hash) const {
+        return static_cast<size_t>(((hash >> 32) * get_num_blocks()) >> 32);
+    }
+
+    std::vector<uint32_t> words_;
+};
+
+#endif // PARQUET_BLOOM_FILTER_H
@@ -0,0 +1,85 @@
+#include "semi_join.h"
+#include <cstring>
+#include <stdexcept>
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define SEMI_JOIN_HAVE_AVX512 1
+#include <immintrin.h>
+#endif
+
+StridedColumn::StridedColumn(const char *data, size_t length, ptrdiff_t stride,
+                             size_t itemsize, Kind kind)
+    : data_(data), length_(length), stride_(stride), itemsize_(itemsize),
+      kind_(kind) {
+  if (kind_ != Kind::FixedBytes && itemsize_ != 1 && itemsize_ != 2 &&
+      itemsize_ != 4 && itemsize_ != 8) {
+    throw std::invalid_argument("Integer columns must have 1, 2, 4 or 8 byte items");
+  }
+}
+
+std::string_view StridedColumn::key(size_t i, char (&scratch)[8]) const {
+  const char *p = data_ + static_cast<ptrdiff_t>(i) * stride_;
+  if (kind_ == Kind::FixedBytes) {
+    size_t len = itemsize_;
+    while (len > 0 && p[len - 1] == '\0') --len;
+    return {p, len};
+  }
+  const uint64_t v = integer(i);
+  for (unsigned b = 0; b < 8; ++b) {
+    scratch[b] = static_cast<char>(v >> (8 * b));
+  }
+  return {scratch, 8};
+}
+
+uint64_t StridedColumn::integer(size_t i) const {
+  const char *p = data_ + static_cast<ptrdiff_t>(i) * stride_;
+  uint64_t v = 0;
+  std::memcpy(&v, p, itemsize_); // little-endian hosts
+  if (kind_ == Kind::SignedInt && itemsize_ < 8) {
+    const unsigned shift = 64 - 8 * static_cast<unsigned>(itemsize_);
+    v = static_cast<uint64_t>(static_cast<int64_t>(v << shift) >> shift);
+  }
+  return v;
+}
+
+namespace {
+
+size_t compress_scalar(uint32_t mask, int64_t base, int64_t *out) {
+  // Branch-free: always store, advance only on a hit
+  size_t n = 0;
+  for (uint32_t lane = 0; lane < 16; ++lane) {
+    out[n] = base + lane;
+    n += (mask >> lane) & 1;
+  }
+  return n;
+}
+
+#ifdef SEMI_JOIN_HAVE_AVX512
+__attribute__((target("avx512f"))) size_t compress_avx512(uint32_t mask,
+                                                          int64_t base,
+                                                          int64_t *out) {
+  const __m512i lo = _mm512_add_epi64(_mm512_set1_epi64(base),
+                                      _mm512_set_epi64(7, 6, 5, 4, 3, 2, 1, 0));
+  const __m512i hi = _mm512_add_epi64(lo, _mm512_set1_epi64(8));
+  const size_t n_lo = static_cast<size_t>(__builtin_popcount(mask & 0xFF));
+  _mm512_mask_compressstoreu_epi64(out, static_cast<__mmask8>(mask), lo);
+  _mm512_mask_compressstoreu_epi64(out + n_lo, static_cast<__mmask8>(mask >> 8), hi);
+  return n_lo + static_cast<size_t>(__builtin_popcount((mask >> 8) & 0xFF));
+}
+#endif
+
+using CompressFn = size_t (*)(uint32_t, int64_t, int64_t *);
+
+CompressFn select_compress() {
+#ifdef SEMI_JOIN_HAVE_AVX512
+  if (__builtin_cpu_supports("avx512f")) return compress_avx512;
+#endif
+  return compress_scalar;
+}
+
+} // namespace
+
+size_t compress_indices(uint32_t mask, int64_t base, int64_t *out) {
+  static const CompressFn impl = select_compress();
+  return impl(mask, base, out);
+}
@@ -0,0 +1,118 @@
+#ifndef SEMI_JOIN_H
+#define SEMI_JOIN_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+#include "batch_hash.h"
+#include "bloom_filter.h"
+#include "cpu_info.h"
+#include "thread_pool.h"
+
+// Semi-join pre-filtering: build a filter from one table's key column, then
+// probe another column and emit the row indices that pass (a selection
+// vector) instead of a bool mask. Column types provide size(), is_valid(i),
+// key(i, scratch), and is_integer() with integer(i) for columns whose keys
+// are 8-byte integers (see ArrowColumn and StridedColumn).
+
+// Fixed-width values in a possibly strided buffer (NumPy arrays via the
+// buffer protocol). Integers are widened to 8 little-endian bytes like
+// ArrowColumn; fixed-width bytes drop trailing NULs as NumPy's 'S' does.
+class StridedColumn {
+public:
+    enum class Kind { SignedInt, UnsignedInt, FixedBytes };
+
+    StridedColumn(const char* data, size_t length, ptrdiff_t stride, size_t itemsize,
+                  Kind kind);
+
+    size_t size() const { return length_; }
+    bool is_valid(size_t) const { return true; }
+    std::string_view key(size_t i, char (&scratch)[8]) const;
+    bool is_integer() const { return kind_ != Kind::FixedBytes; }
+    // Integer rows widened to 64 bits (only for integer columns)
+    uint64_t integer(size_t i) const;
+
+private:
+    const char* data_;
+    size_t length_;
+    ptrdiff_t stride_;
+    size_t itemsize_;
+    Kind kind_;
+};
+
+// Append base + lane for every set bit of `mask` (lanes 0..15) to out;
+// returns the number written. Uses AVX-512 compress-store when available.
+size_t compress_indices(uint32_t mask, int64_t base, int64_t* out);
+
+template <typename Column>
+void build_from_column(BloomFilter& filter, const Column& column, size_t threads = 0) {
+    parallel_for(column.size(), size_t(1) << 14, threads, [&](size_t begin, size_t end) {
+        KeyHash hashes[HASH_BLOCK];
+        for (size_t start = begin; start < end; start += HASH_BLOCK) {
+            const size_t m = std::min(HASH_BLOCK, end - start);
+            hash_column_rows(filter.get_hash_scheme(), column, start, m, hashes);
+            for (size_t j = 0; j < m; ++j) {
+                if (column.is_valid(start + j)) filter.add_hash_concurrent(hashes[j]);
+            }
+        }
+    });
+}
+
+// Appends the indices (offset by row_base) of rows that might be in the
+// filter to `out`, in row order. Null rows never pass.
+template <typename Column>
+void probe_select(const BloomFilter& filter, const Column& column, int64_t row_base,
+                  std::vector<int64_t>& out, size_t threads = 0) {
+    constexpr size_t GROUP = 16;
+    constexpr size_t GRAIN = size_t(1) << 16;
+    const size_t n = column.size();
+    const size_t num_chunks = (n + GRAIN - 1) / GRAIN;
+    // Prefetching only pays once the bit array no longer fits in L2
+    const bool prefetch = filter.get_num_bits() / 8 > l2_cache_bytes();
+
+    std::vector<std::vector<int64_t>> parts(num_chunks);
+    parallel_for(n, GRAIN, threads, [&](size_t begin, size_t end) {
+        std::vector<int64_t>& part = parts[begin / GRAIN];
+        part.resize(end - begin + GROUP);
+        size_t count = 0;
+        KeyHash hashes[2][GROUP];
+        uint32_t valid[2] = {0, 0};
+
+        // Hash (and prefetch) group g + 1 while testing group g
+        auto load = [&](size_t start, KeyHash* h) {
+            uint32_t mask = 0;
+            const size_t stop = std::min(end, start + GROUP);
+            hash_column_rows(filter.get_hash_scheme(), column, start, stop - start, h);
+            for (size_t i = start; i < stop; ++i) {
+                if (!column.is_valid(i)) continue;
+                if (prefetch) filter.prefetch_hash(h[i - start]);
+                mask |= 1u << (i - start);
+            }
+            return mask;
+        };
+
+        valid[0] = load(begin, hashes[0]);
+        for (size_t start = begin, cur = 0; start < end; start += GROUP, cur ^= 1) {
+            if (start + GROUP < end) valid[cur ^ 1] = load(start + GROUP, hashes[cur ^ 1]);
+            uint32_t hits = 0;
+            for (uint32_t lane = 0; lane < GROUP; ++lane) {
+                if (valid[cur] >> lane & 1) {
+                    hits |= static_cast<uint32_t>(filter.might_contain_hash(hashes[cur][lane])) << lane;
+                }
+            }
+            count += compress_indices(hits, row_base + static_cast<int64_t>(start),
+                                      part.data() + count);
+        }
+        part.resize(count);
+    });
+
+    size_t total = out.size();
+    for (const auto& part : parts) total += part.size();
+    out.reserve(total);
+    for (const auto& part : parts) out.insert(out.end(), part.begin(), part.end());
+}
+
+#endif // SEMI_JOIN_H
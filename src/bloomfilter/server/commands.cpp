@@ -0,0 +1,194 @@
+#include "commands.h"
+#include "resp.h"
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstdlib>
+
+namespace {
+
+bool equals_upper(std::string_view arg, std::string_view upper) {
+  if (arg.size() != upper.size()) return false;
+  for (size_t i = 0; i < arg.size(); ++i) {
+    if (std::toupper(static_cast<unsigned char>(arg[i])) != upper[i]) return false;
+  }
+  return true;
+}
+
+std::string lower(std::string_view s) {
+  std::string out(s);
+  for (char &c : out) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+  return out;
+}
+
+bool parse_double(std::string_view s, double &value) {
+  const std::string text(s);
+  char *end = nullptr;
+  errno = 0;
+  value = std::strtod(text.c_str(), &end);
+  return !text.empty() && end == text.c_str() + text.size() && errno == 0;
+}
+
+bool parse_size(std::string_view s, size_t &value) {
+  if (s.empty() || s.size() > 19) return false;
+  size_t v = 0;
+  for (char c : s) {
+    if (c < '0' || c > '9') return false;
+    v = v * 10 + static_cast<size_t>(c - '0');
+  }
+  value = v;
+  return true;
+}
+
+void wrong_arity(std::string &out, std::string_view name) {
+  resp::write_error(out, "wrong number of arguments for '" + lower(name) + "' command");
+}
+
+// Lookup cache for runs of commands on the same filter within a batch
+class FilterCache {
+public:
+  explicit FilterCache(FilterStore &store) : store_(store) {}
+
+  FilterStore::Entry *find(std::string_view name) {
+    if (!(entry_ && name == name_)) {
+      entry_ = store_.find(name);
+      if (entry_) name_ = name;
+    }
+    return entry_;
+  }
+
+  FilterStore::Entry *find_or_create(std::string_view name) {
+    if (!(entry_ && name == name_)) {
+      entry_ = store_.find_or_create(name);
+      name_ = name;
+    }
+    return entry_;
+  }
+
+  FilterStore &store() { return store_; }
+
+private:
+  FilterStore &store_;
+  std::string_view name_;
+  FilterStore::Entry *entry_ = nullptr;
+};
+
+// Hash every key first and prefetch its bits, then probe
+template <typename Fn>
+void for_each_key(const BloomFilter &filter, const Command &cmd, size_t first, Fn &&fn) {
+  constexpr size_t GROUP = 16;
+  KeyHash hashes[GROUP];
+  for (size_t start = first; start < cmd.size(); start += GROUP) {
+    const size_t n = std::min(GROUP, cmd.size() - start);
+    for (size_t i = 0; i < n; ++i) {
+      hashes[i] = filter.hash(cmd[start + i].data(), cmd[start + i].size());
+      filter.prefetch_hash(hashes[i]);
+    }
+    for (size_t i = 0; i < n; ++i) fn(hashes[i]);
+  }
+}
+
+void bf_reserve(FilterCache &cache, const Command &cmd, std::string &out) {
+  if (cmd.size() < 4) return wrong_arity(out, cmd[0]);
+  double error_rate = 0;
+  size_t capacity = 0;
+  if (!parse_double(cmd[2], error_rate)) return resp::write_error(out, "bad error rate");
+  if (!parse_size(cmd[3], capacity)) return resp::write_error(out, "bad capacity");
+  if (!(error_rate > 0 && error_rate < 1)) {
+    return resp::write_error(out, "(0 < error rate range < 1)");
+  }
+  if (capacity == 0) return resp::write_error(out, "(capacity should be larger than 0)");
+  // EXPANSION / NONSCALING are accepted; filters here never scale
+  for (size_t i = 4; i < cmd.size(); ++i) {
+    if (equals_upper(cmd[i], "NONSCALING")) continue;
+    if (equals_upper(cmd[i], "EXPANSION") && i + 1 < cmd.size()) {
+      ++i;
+      continue;
+    }
+    return resp::write_error(out, "syntax error");
+  }
+  if (!cache.store().create(cmd[1], capacity, error_rate)) {
+    return resp::write_error(out, "item exists");
+  }
+  resp::write_simple(out, "OK");
+}
+
+void bf_add(FilterCache &cache, const Command &cmd, std::string &out, bool multi) {
+  if (multi ? cmd.size() < 3 : cmd.size() != 3) return wrong_arity(out, cmd[0]);
+  FilterStore::Entry *entry = cache.find_or_create(cmd[1]);
+  if (multi) resp::write_array_header(out, cmd.size() - 2);
+  for_each_key(entry->filter, cmd, 2, [&](const KeyHash &hash) {
+    const bool added = entry->filter.add_hash_concurrent(hash);
+    if (added) entry->items_inserted.fetch_add(1, std::memory_order_relaxed);
+    resp::write_integer(out, added);
+  });
+}
+
+void bf_exists(FilterCache &cache, const Command &cmd, std::string &out, bool multi) {
+  if (multi ? cmd.size() < 3 : cmd.size() != 3) return wrong_arity(out, cmd[0]);
+  FilterStore::Entry *entry = cache.find(cmd[1]);
+  if (multi) resp::write_array_header(out, cmd.size() - 2);
+  if (!entry) {
+    for (size_t i = 2; i < cmd.size(); ++i) resp::write_integer(out, 0);
+    return;
+  }
+  for_each_key(entry->filter, cmd, 2, [&](const KeyHash &hash) {
+    resp::write_integer(out, entry->filter.might_contain_hash(hash));
+  });
+}
+
+void bf_info(FilterCache &cache, const Command &cmd, std::string &out) {
+  if (cmd.size() != 2) return wrong_arity(out, cmd[0]);
+  FilterStore::Entry *entry = cache.find(cmd[1]);
+  if (!entry) return resp::write_error(out, "not found");
+  resp::write_array_header(out, 10);
+  resp::write_simple(out, "Capacity");
+  resp::write_integer(out, static_cast<long long>(entry->capacity));
+  resp::write_simple(out, "Size");
+  resp::write_integer(out, static_cast<long long>(entry->filter.get_raw_bits_vector().size() * 8));
+  resp::write_simple(out, "Number of filters");
+  resp::write_integer(out, 1);
+  resp::write_simple(out, "Number of items inserted");
+  resp::write_integer(out, static_cast<long long>(entry->items_inserted.load(std::memory_order_relaxed)));
+  resp::write_simple(out, "Expansion rate");
+  resp::write_null(out);
+}
+
+} // namespace
+
+bool execute_batch(FilterStore &store, const std::vector<Command> &batch, std::string &out) {
+  FilterCache cache(store);
+  for (const Command &cmd : batch) {
+    if (cmd.empty()) continue;
+    const std::string_view name = cmd[0];
+    if (equals_upper(name, "BF.ADD")) {
+      bf_add(cache, cmd, out, false);
+    } else if (equals_upper(name, "BF.EXISTS")) {
+      bf_exists(cache, cmd, out, false);
+    } else if (equals_upper(name, "BF.MADD")) {
+      bf_add(cache, cmd, out, true);
+    } else if (equals_upper(name, "BF.MEXISTS")) {
+      bf_exists(cache, cmd, out, true);
+    } else if (equals_upper(name, "BF.RESERVE")) {
+      bf_reserve(cache, cmd, out);
+    } else if (equals_upper(name, "BF.INFO")) {
+      bf_info(cache, cmd, out);
+    } else if (equals_upper(name, "PING")) {
+      if (cmd.size() > 1) {
+        resp::write_bulk(out, cmd[1]);
+      } else {
+        resp::write_simple(out, "PONG");
+      }
+    } else if (equals_upper(name, "ECHO") && cmd.size() == 2) {
+      resp::write_bulk(out, cmd[1]);
+    } else if (equals_upper(name, "COMMAND")) {
+      resp::write_array_header(out, 0); // clients probe this on connect
+    } else if (equals_upper(name, "QUIT")) {
+      resp::write_simple(out, "OK");
+      return false;
+    } else {
+      resp::write_error(out, "unknown command '" + std::string(name) + "'");
+    }
+  }
+  return true;
+}
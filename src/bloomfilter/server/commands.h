@@ -0,0 +1,19 @@
+#ifndef BLOOM_SERVER_COMMANDS_H
+#define BLOOM_SERVER_COMMANDS_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "filter_store.h"
+
+using Command = std::vector<std::string_view>;
+
+// Executes the commands parsed from one read as a batch, appending the
+// replies to `out` in order. Consecutive commands on the same filter share a
+// single store lookup, and multi-key commands hash all keys and prefetch
+// their bits before probing. Returns false if a command asked to close the
+// connection (QUIT); later commands are not run.
+bool execute_batch(FilterStore& store, const std::vector<Command>& batch, std::string& out);
+
+#endif // BLOOM_SERVER_COMMANDS_H
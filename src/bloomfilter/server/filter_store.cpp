@@ -0,0 +1,29 @@
+#include "filter_store.h"
+#include <mutex>
+
+FilterStore::Entry *FilterStore::find(std::string_view name) const {
+  std::shared_lock<std::shared_mutex> lock(mutex_);
+  auto it = filters_.find(std::string(name));
+  return it == filters_.end() ? nullptr : it->second.get();
+}
+
+FilterStore::Entry *FilterStore::create(std::string_view name, size_t capacity,
+                                        double error_rate) {
+  auto entry = std::make_unique<Entry>(capacity, error_rate);
+  std::unique_lock<std::shared_mutex> lock(mutex_);
+  auto [it, inserted] = filters_.emplace(std::string(name), std::move(entry));
+  return inserted ? it->second.get() : nullptr;
+}
+
+FilterStore::Entry *FilterStore::find_or_create(std::string_view name) {
+  if (Entry *entry = find(name)) return entry;
+  auto fresh = std::make_unique<Entry>(DEFAULT_CAPACITY, DEFAULT_ERROR_RATE);
+  std::unique_lock<std::shared_mutex> lock(mutex_);
+  auto [it, inserted] = filters_.emplace(std::string(name), std::move(fresh));
+  return it->second.get(); // another thread may have created it first
+}
+
+size_t FilterStore::size() const {
+  std::shared_lock<std::shared_mutex> lock(mutex_);
+  return filters_.size();
+}
@@ -0,0 +1,45 @@
+#ifndef BLOOM_SERVER_FILTER_STORE_H
+#define BLOOM_SERVER_FILTER_STORE_H
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "bloom_filter.h"
+
+// Named filters shared by all I/O threads. Filters are never removed, so
+// entry pointers stay valid for the life of the store.
+class FilterStore {
+public:
+    struct Entry {
+        Entry(size_t capacity, double error_rate)
+            : filter(capacity, error_rate), capacity(capacity), error_rate(error_rate) {}
+
+        BloomFilter filter; // written with add_hash_concurrent only
+        size_t capacity;
+        double error_rate;
+        std::atomic<uint64_t> items_inserted{0};
+    };
+
+    // RedisBloom's defaults for BF.ADD on a missing key
+    static constexpr size_t DEFAULT_CAPACITY = 100;
+    static constexpr double DEFAULT_ERROR_RATE = 0.01;
+
+    Entry* find(std::string_view name) const;
+    // nullptr if the name is taken
+    Entry* create(std::string_view name, size_t capacity, double error_rate);
+    Entry* find_or_create(std::string_view name);
+
+    size_t size() const;
+
+private:
+    mutable std::shared_mutex mutex_;
+    std::unordered_map<std::string, std::unique_ptr<Entry>> filters_;
+};
+
+#endif // BLOOM_SERVER_FILTER_STORE_H
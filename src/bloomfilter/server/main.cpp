@@ -0,0 +1,72 @@
+// bloomfilter-server: hosts named BloomFilters behind a RedisBloom-compatible
+// subset of the RESP protocol (BF.RESERVE/ADD/MADD/EXISTS/MEXISTS/INFO)
+
+#include "filter_store.h"
+#include "server.h"
+
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <pthread.h>
+#include <string>
+#include <thread>
+
+namespace {
+
+void usage(const char *argv0) {
+  std::fprintf(stderr,
+               "usage: %s [--bind ADDR] [--port N] [--unix PATH] [--threads N]\n"
+               "  --bind ADDR   IPv4 address to listen on (default 127.0.0.1)\n"
+               "  --port N      TCP port, 0 to disable (default 6379)\n"
+               "  --unix PATH   also listen on a Unix domain socket\n"
+               "  --threads N   I/O threads (default: all cores)\n",
+               argv0);
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  ServerOptions options;
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    const bool has_value = i + 1 < argc;
+    if (arg == "--bind" && has_value) {
+      options.bind = argv[++i];
+    } else if (arg == "--port" && has_value) {
+      options.port = std::atoi(argv[++i]);
+    } else if (arg == "--unix" && has_value) {
+      options.unix_path = argv[++i];
+    } else if (arg == "--threads" && has_value) {
+      options.io_threads = static_cast<size_t>(std::atoi(argv[++i]));
+    } else {
+      usage(argv[0]);
+      return arg == "--help" || arg == "-h" ? 0 : 2;
+    }
+  }
+
+  // Handle SIGINT/SIGTERM synchronously on this thread; block them before
+  // any thread starts so the I/O threads inherit the mask
+  sigset_t signals;
+  sigemptyset(&signals);
+  sigaddset(&signals, SIGINT);
+  sigaddset(&signals, SIGTERM);
+  pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+  std::signal(SIGPIPE, SIG_IGN);
+
+  try {
+    FilterStore store;
+    Server server(options, store);
+    std::thread loop([&server] { server.run(); });
+    std::fprintf(stderr, "bloomfilter-server ready (port %d%s%s)\n", options.port,
+                 options.unix_path.empty() ? "" : ", unix ", options.unix_path.c_str());
+    int sig = 0;
+    sigwait(&signals, &sig);
+    server.stop();
+    loop.join();
+  } catch (const std::exception &e) {
+    std::fprintf(stderr, "bloomfilter-server: %s\n", e.what());
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,150 @@
+#include "resp.h"
+#include <climits>
+#include <cstring>
+
+namespace resp {
+
+namespace {
+
+constexpr long long MAX_ARGS = 1024 * 1024;
+constexpr long long MAX_BULK = 512LL * 1024 * 1024;
+constexpr size_t MAX_INLINE = 64 * 1024;
+
+// Reads "<int>\r\n" at data[pos]; false if incomplete, sets bad on garbage
+bool read_int_line(const char *data, size_t len, size_t &pos, long long &value, bool &bad) {
+  const void *cr = std::memchr(data + pos, '\r', len - pos);
+  if (!cr) {
+    bad = len - pos > 32;
+    return false;
+  }
+  const size_t end = static_cast<const char *>(cr) - data;
+  if (end + 1 >= len) return false;
+  if (data[end + 1] != '\n' || end == pos || end - pos > 20) {
+    bad = true;
+    return false;
+  }
+  size_t i = pos;
+  const bool negative = data[i] == '-';
+  if (negative) ++i;
+  long long v = 0;
+  for (; i < end; ++i) {
+    if (data[i] < '0' || data[i] > '9') {
+      bad = true;
+      return false;
+    }
+    const int digit = data[i] - '0';
+    if (v > (LLONG_MAX - digit) / 10) {
+      bad = true;
+      return false;
+    }
+    v = v * 10 + digit;
+  }
+  value = negative ? -v : v;
+  pos = end + 2;
+  return true;
+}
+
+ParseStatus parse_inline(const char *data, size_t len, size_t &pos,
+                         std::vector<std::string_view> &args, std::string &error) {
+  const void *nl = std::memchr(data + pos, '\n', len - pos);
+  if (!nl) {
+    if (len - pos > MAX_INLINE) {
+      error = "Protocol error: too big inline request";
+      return ParseStatus::Error;
+    }
+    return ParseStatus::Incomplete;
+  }
+  size_t end = static_cast<const char *>(nl) - data;
+  const size_t next = end + 1;
+  if (end > pos && data[end - 1] == '\r') --end;
+  size_t i = pos;
+  while (i < end) {
+    while (i < end && (data[i] == ' ' || data[i] == '\t')) ++i;
+    const size_t start = i;
+    while (i < end && data[i] != ' ' && data[i] != '\t') ++i;
+    if (i > start) args.emplace_back(data + start, i - start);
+  }
+  pos = next;
+  return ParseStatus::Ok;
+}
+
+} // namespace
+
+ParseStatus parse_command(const char *data, size_t len, size_t &pos,
+                          std::vector<std::string_view> &args, std::string &error) {
+  args.clear();
+  if (pos >= len) return ParseStatus::Incomplete;
+  if (data[pos] != '*') return parse_inline(data, len, pos, args, error);
+
+  size_t p = pos + 1;
+  long long count = 0;
+  bool bad = false;
+  if (!read_int_line(data, len, p, count, bad)) {
+    if (!bad) return ParseStatus::Incomplete;
+    error = "Protocol error: invalid multibulk length";
+    return ParseStatus::Error;
+  }
+  if (count > MAX_ARGS) {
+    error = "Protocol error: invalid multibulk length";
+    return ParseStatus::Error;
+  }
+  for (long long i = 0; i < count; ++i) {
+    if (p >= len) return ParseStatus::Incomplete;
+    if (data[p] != '$') {
+      error = std::string("Protocol error: expected '$', got '") + data[p] + "'";
+      return ParseStatus::Error;
+    }
+    ++p;
+    long long size = 0;
+    if (!read_int_line(data, len, p, size, bad)) {
+      if (!bad) return ParseStatus::Incomplete;
+      error = "Protocol error: invalid bulk length";
+      return ParseStatus::Error;
+    }
+    if (size < 0 || size > MAX_BULK) {
+      error = "Protocol error: invalid bulk length";
+      return ParseStatus::Error;
+    }
+    if (len - p < static_cast<size_t>(size) + 2) return ParseStatus::Incomplete;
+    args.emplace_back(data + p, static_cast<size_t>(size));
+    p += static_cast<size_t>(size) + 2;
+  }
+  pos = p;
+  return ParseStatus::Ok;
+}
+
+void write_simple(std::string &out, std::string_view s) {
+  out.push_back('+');
+  out.append(s);
+  out.append("\r\n");
+}
+
+void write_error(std::string &out, std::string_view message) {
+  out.append("-ERR ");
+  out.append(message);
+  out.append("\r\n");
+}
+
+void write_integer(std::string &out, long long value) {
+  out.push_back(':');
+  out.append(std::to_string(value));
+  out.append("\r\n");
+}
+
+void write_bulk(std::string &out, std::string_view s) {
+  out.push_back('$');
+  out.append(std::to_string(s.size()));
+  out.append("\r\n");
+  out.append(s);
+  out.append("\r\n");
+}
+
+void write_null(std::string &out) { out.append("$-1\r\n"); }
+
+void write_array_header(std::string &out, size_t n) {
+  out.push_back('*');
+  out.append(std::to_string(n));
+  out.append("\r\n");
+}
+
+} // namespace resp
@@ -0,0 +1,30 @@
+#ifndef BLOOM_SERVER_RESP_H
+#define BLOOM_SERVER_RESP_H
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// RESP2 request parsing and reply encoding (the subset Redis clients send
+// and expect for BF.* commands)
+namespace resp {
+
+enum class ParseStatus { Ok, Incomplete, Error };
+
+// Parse one command at data[pos..len): an array of bulk strings, or an inline
+// command line. On Ok, args view into data and pos moves past the command.
+// On Error, `error` holds the message for the client.
+ParseStatus parse_command(const char* data, size_t len, size_t& pos,
+                          std::vector<std::string_view>& args, std::string& error);
+
+void write_simple(std::string& out, std::string_view s);
+void write_error(std::string& out, std::string_view message);
+void write_integer(std::string& out, long long value);
+void write_bulk(std::string& out, std::string_view s);
+void write_null(std::string& out);
+void write_array_header(std::string& out, size_t n);
+
+} // namespace resp
+
+#endif // BLOOM_SERVER_RESP_H
@@ -0,0 +1,303 @@
+#include "server.h"
+#include "commands.h"
+#include "resp.h"
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <memory>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdexcept>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <unordered_map>
+
+namespace {
+
+constexpr size_t READ_CHUNK = 64 * 1024;
+constexpr int MAX_EVENTS = 256;
+
+// epoll_event.data.ptr for the non-connection descriptors
+char listener_tag, stop_tag;
+void *const LISTENER_TAG = &listener_tag;
+void *const STOP_TAG = &stop_tag;
+
+[[noreturn]] void throw_errno(const std::string &what) {
+  throw std::runtime_error(what + ": " + std::strerror(errno));
+}
+
+int listen_tcp(const std::string &bind, int port) {
+  sockaddr_in addr{};
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(static_cast<uint16_t>(port));
+  if (inet_pton(AF_INET, bind.c_str(), &addr.sin_addr) != 1) {
+    throw std::invalid_argument("Invalid IPv4 bind address: " + bind);
+  }
+  const int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (fd < 0) throw_errno("socket");
+  const int one = 1;
+  setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+  if (::bind(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0 ||
+      listen(fd, SOMAXCONN) < 0) {
+    const int err = errno;
+    close(fd);
+    errno = err;
+    throw_errno("listen on " + bind + ":" + std::to_string(port));
+  }
+  return fd;
+}
+
+int listen_unix(const std::string &path) {
+  sockaddr_un addr{};
+  addr.sun_family = AF_UNIX;
+  if (path.size() >= sizeof(addr.sun_path)) {
+    throw std::invalid_argument("Unix socket path too long: " + path);
+  }
+  std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+  const int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (fd < 0) throw_errno("socket");
+  unlink(path.c_str()); // stale socket from a previous run
+  if (::bind(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0 ||
+      listen(fd, SOMAXCONN) < 0) {
+    const int err = errno;
+    close(fd);
+    errno = err;
+    throw_errno("listen on " + path);
+  }
+  return fd;
+}
+
+struct Connection {
+  int fd;
+  std::string in;
+  size_t in_pos = 0; // start of the first unparsed command
+  std::string out;
+  size_t out_pos = 0;
+  bool closing = false; // QUIT or protocol error: close once `out` drains
+  bool writing = false; // registered for EPOLLOUT instead of EPOLLIN
+};
+
+class IoThread {
+public:
+  IoThread(FilterStore &store, const std::vector<int> &listeners, int stop_fd)
+      : store_(store), listeners_(listeners), stop_fd_(stop_fd) {
+    epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd_ < 0) throw_errno("epoll_create1");
+    spare_fd_ = open("/dev/null", O_RDONLY | O_CLOEXEC);
+    for (int fd : listeners_) watch(fd, EPOLLIN | EPOLLEXCLUSIVE, LISTENER_TAG);
+    // Level-triggered and never read, so it wakes every thread once stopping
+    watch(stop_fd_, EPOLLIN, STOP_TAG);
+  }
+
+  ~IoThread() {
+    for (auto &kv : connections_) close(kv.first);
+    if (spare_fd_ >= 0) close(spare_fd_);
+    close(epoll_fd_);
+  }
+
+  void run() {
+    epoll_event events[MAX_EVENTS];
+    for (;;) {
+      const int n = epoll_wait(epoll_fd_, events, MAX_EVENTS, -1);
+      if (n < 0) {
+        if (errno == EINTR) continue;
+        throw_errno("epoll_wait");
+      }
+      for (int i = 0; i < n; ++i) {
+        void *tag = events[i].data.ptr;
+        if (tag == STOP_TAG) return;
+        if (tag == LISTENER_TAG) {
+          accept_all();
+          continue;
+        }
+        auto *conn = static_cast<Connection *>(tag);
+        if (events[i].events & (EPOLLERR | EPOLLHUP)) {
+          drop(conn);
+        } else if (events[i].events & EPOLLOUT) {
+          flush(conn);
+        } else if (events[i].events & EPOLLIN) {
+          on_readable(conn);
+        }
+      }
+    }
+  }
+
+private:
+  void watch(int fd, uint32_t events, void *tag) {
+    epoll_event ev{};
+    ev.events = events;
+    ev.data.ptr = tag;
+    if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &ev) < 0) throw_errno("epoll_ctl");
+  }
+
+  void rearm(Connection *conn, bool writing) {
+    if (conn->writing == writing) return;
+    epoll_event ev{};
+    ev.events = writing ? EPOLLOUT : EPOLLIN;
+    ev.data.ptr = conn;
+    epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, conn->fd, &ev);
+    conn->writing = writing;
+  }
+
+  void accept_all() {
+    for (int listener : listeners_) {
+      for (;;) {
+        const int fd = accept4(listener, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0 && (errno == EMFILE || errno == ENFILE)) {
+          // The level-triggered listener would fire again at once: shed
+          // the pending connection, or back off if no spare fd is left
+          if (!reject_pending(listener)) break;
+          continue;
+        }
+        if (fd < 0) break; // EAGAIN, or another thread got it
+        const int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one)); // fails harmlessly on AF_UNIX
+        auto conn = std::make_unique<Connection>();
+        conn->fd = fd;
+        watch(fd, EPOLLIN, conn.get());
+        connections_.emplace(fd, std::move(conn));
+      }
+    }
+  }
+
+  // Out of descriptors: free the spare one to accept and close the next
+  // connection, then take it back. false if the listener should be left
+  // alone for now.
+  bool reject_pending(int listener) {
+    if (spare_fd_ < 0) spare_fd_ = open("/dev/null", O_RDONLY | O_CLOEXEC);
+    if (spare_fd_ < 0) {
+      const timespec pause{0, 10 * 1000 * 1000};
+      nanosleep(&pause, nullptr);
+      return false;
+    }
+    close(spare_fd_);
+    const int fd = accept4(listener, nullptr, nullptr, SOCK_CLOEXEC);
+    if (fd >= 0) close(fd);
+    spare_fd_ = open("/dev/null", O_RDONLY | O_CLOEXEC);
+    return fd >= 0;
+  }
+
+  void drop(Connection *conn) {
+    epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, conn->fd, nullptr);
+    close(conn->fd);
+    connections_.erase(conn->fd); // frees conn
+  }
+
+  void on_readable(Connection *conn) {
+    for (;;) {
+      const size_t old = conn->in.size();
+      conn->in.resize(old + READ_CHUNK);
+      const ssize_t r = read(conn->fd, &conn->in[old], READ_CHUNK);
+      if (r > 0) {
+        conn->in.resize(old + static_cast<size_t>(r));
+        if (static_cast<size_t>(r) < READ_CHUNK) break;
+        continue;
+      }
+      conn->in.resize(old);
+      if (r == 0) return drop(conn);
+      if (errno == EINTR) continue;
+      if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+      return drop(conn);
+    }
+    process(conn);
+  }
+
+  // Parse every complete pipelined command, run them as one batch, and
+  // reply with a single write
+  void process(Connection *conn) {
+    batch_.clear();
+    Command args;
+    std::string error;
+    for (;;) {
+      const resp::ParseStatus status =
+          resp::parse_command(conn->in.data(), conn->in.size(), conn->in_pos, args, error);
+      if (status == resp::ParseStatus::Incomplete) break;
+      if (status == resp::ParseStatus::Error) {
+        conn->closing = true;
+        break;
+      }
+      batch_.push_back(args);
+    }
+    if (!execute_batch(store_, batch_, conn->out)) conn->closing = true;
+    if (conn->closing && !error.empty()) resp::write_error(conn->out, error);
+    // Commands are views into `in`; compact only after executing them
+    conn->in.erase(0, conn->in_pos);
+    conn->in_pos = 0;
+    flush(conn);
+  }
+
+  void flush(Connection *conn) {
+    while (conn->out_pos < conn->out.size()) {
+      const ssize_t w = send(conn->fd, conn->out.data() + conn->out_pos,
+                             conn->out.size() - conn->out_pos, MSG_NOSIGNAL);
+      if (w > 0) {
+        conn->out_pos += static_cast<size_t>(w);
+        continue;
+      }
+      if (w < 0 && errno == EINTR) continue;
+      if (w < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+        // Stop reading until the client drains its replies (backpressure)
+        return rearm(conn, true);
+      }
+      return drop(conn);
+    }
+    conn->out.clear();
+    conn->out_pos = 0;
+    if (conn->closing) return drop(conn);
+    rearm(conn, false);
+  }
+
+  FilterStore &store_;
+  const std::vector<int> &listeners_;
+  int stop_fd_;
+  int epoll_fd_;
+  int spare_fd_ = -1; // /dev/null, given up to shed connections at the fd limit
+  std::unordered_map<int, std::unique_ptr<Connection>> connections_;
+  std::vector<Command> batch_;
+};
+
+} // namespace
+
+Server::Server(const ServerOptions &options, FilterStore &store)
+    : options_(options), store_(store) {
+  if (options_.port > 0) listeners_.push_back(listen_tcp(options_.bind, options_.port));
+  if (!options_.unix_path.empty()) listeners_.push_back(listen_unix(options_.unix_path));
+  if (listeners_.empty()) {
+    throw std::invalid_argument("No listener configured (need a TCP port or a Unix socket)");
+  }
+  stop_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (stop_fd_ < 0) throw_errno("eventfd");
+}
+
+Server::~Server() {
+  for (int fd : listeners_) close(fd);
+  if (!options_.unix_path.empty()) unlink(options_.unix_path.c_str());
+  close(stop_fd_);
+}
+
+void Server::run() {
+  size_t n = options_.io_threads;
+  if (n == 0) n = std::max(1u, std::thread::hardware_concurrency());
+  std::vector<std::thread> threads;
+  for (size_t i = 1; i < n; ++i) threads.emplace_back([this] { io_loop(); });
+  io_loop();
+  for (auto &t : threads) t.join();
+}
+
+void Server::stop() {
+  const uint64_t one = 1;
+  const ssize_t r = write(stop_fd_, &one, sizeof(one));
+  (void)r;
+}
+
+void Server::io_loop() {
+  IoThread thread(store_, listeners_, stop_fd_);
+  thread.run();
+}
@@ -0,0 +1,44 @@
+#ifndef BLOOM_SERVER_SERVER_H
+#define BLOOM_SERVER_SERVER_H
+
+#include <atomic>
+#include <cstddef>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "filter_store.h"
+
+struct ServerOptions {
+    std::string bind = "127.0.0.1";
+    int port = 6379;         // 0 = no TCP listener
+    std::string unix_path;   // empty = no Unix socket
+    size_t io_threads = 0;   // 0 = hardware concurrency
+};
+
+// epoll event loop per I/O thread. Every thread waits on the listening
+// sockets (EPOLLEXCLUSIVE wakes one of them) and owns the connections it
+// accepts, so connections never migrate between threads.
+class Server {
+public:
+    Server(const ServerOptions& options, FilterStore& store);
+    ~Server();
+
+    Server(const Server&) = delete;
+    Server& operator=(const Server&) = delete;
+
+    // Blocks until stop() is called
+    void run();
+    // Safe to call from any thread or a signal-driven thread
+    void stop();
+
+private:
+    void io_loop();
+
+    ServerOptions options_;
+    FilterStore& store_;
+    std::vector<int> listeners_;
+    int stop_fd_ = -1; // eventfd, readable once stopping
+};
+
+#endif // BLOOM_SERVER_SERVER_H
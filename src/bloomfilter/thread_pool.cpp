@@ -0,0 +1,196 @@
+#include "thread_pool.h"
+#include <algorithm>
+#include <chrono>
+#include <exception>
+#include <stdexcept>
+
+namespace {
+
+std::mutex global_mutex;
+std::shared_ptr<ThreadPool> global_pool;
+size_t global_threads = 0; // 0: not configured yet
+
+size_t default_threads() {
+  return std::max<size_t>(1, std::thread::hardware_concurrency());
+}
+
+// Waits for a fixed number of helper tasks to finish
+struct Latch {
+  explicit Latch(size_t count) : remaining(count) {}
+  void count_down() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (--remaining == 0) done.notify_all();
+  }
+  std::mutex mutex;
+  std::condition_variable done;
+  size_t remaining;
+};
+
+} // namespace
+
+ThreadPool::ThreadPool(size_t num_threads) {
+  if (num_threads == 0) {
+    throw std::invalid_argument("Thread pool needs at least one thread");
+  }
+  for (size_t i = 0; i < num_threads; ++i) {
+    queues_.push_back(std::make_unique<Queue>());
+  }
+  for (size_t i = 0; i < num_threads; ++i) {
+    workers_.emplace_back([this, i] { worker_loop(i); });
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(sleep_mutex_);
+    stopping_ = true;
+  }
+  wake_.notify_all();
+  for (auto &worker : workers_) worker.join();
+}
+
+void ThreadPool::submit(Task task) {
+  const size_t q = next_queue_.fetch_add(1, std::memory_order_relaxed) % queues_.size();
+  {
+    std::lock_guard<std::mutex> lock(queues_[q]->mutex);
+    queues_[q]->tasks.push_back(std::move(task));
+  }
+  {
+    std::lock_guard<std::mutex> lock(sleep_mutex_);
+    ++pending_;
+  }
+  wake_.notify_one();
+}
+
+std::future<void> ThreadPool::async(Task task) {
+  auto packaged = std::make_shared<std::packaged_task<void()>>(std::move(task));
+  std::future<void> done = packaged->get_future();
+  submit([packaged] { (*packaged)(); });
+  return done;
+}
+
+bool ThreadPool::try_run_one(size_t preferred) {
+  Task task;
+  const size_t n = queues_.size();
+  for (size_t i = 0; i < n && !task; ++i) {
+    Queue &q = *queues_[(preferred + i) % n];
+    std::lock_guard<std::mutex> lock(q.mutex);
+    if (q.tasks.empty()) continue;
+    if (i == 0) { // own queue: LIFO keeps the freshest data in cache
+      task = std::move(q.tasks.back());
+      q.tasks.pop_back();
+    } else { // steal the oldest task
+      task = std::move(q.tasks.front());
+      q.tasks.pop_front();
+    }
+  }
+  if (!task) return false;
+  pending_.fetch_sub(1, std::memory_order_relaxed);
+  task();
+  return true;
+}
+
+void ThreadPool::worker_loop(size_t index) {
+  for (;;) {
+    if (try_run_one(index)) continue;
+    std::unique_lock<std::mutex> lock(sleep_mutex_);
+    wake_.wait(lock, [this] { return stopping_ || pending_.load() > 0; });
+    if (stopping_ && pending_.load() == 0) return;
+  }
+}
+
+void ThreadPool::parallel_for(size_t n, size_t grain, size_t max_threads,
+                              const std::function<void(size_t, size_t)> &fn) {
+  if (n == 0) return;
+  grain = std::max<size_t>(1, grain);
+  const size_t num_chunks = (n + grain - 1) / grain;
+  const size_t helpers =
+      std::min({num_chunks, std::max<size_t>(1, max_threads), size() + 1}) - 1;
+  if (helpers == 0) {
+    fn(0, n);
+    return;
+  }
+
+  // Dynamic chunk claiming: fast threads simply take more chunks
+  std::atomic<size_t> next_chunk{0};
+  std::exception_ptr error;
+  std::mutex error_mutex;
+  auto run_chunks = [&] {
+    for (;;) {
+      const size_t chunk = next_chunk.fetch_add(1, std::memory_order_relaxed);
+      if (chunk >= num_chunks) return;
+      const size_t begin = chunk * grain;
+      try {
+        fn(begin, std::min(n, begin + grain));
+      } catch (...) {
+        std::lock_guard<std::mutex> lock(error_mutex);
+        if (!error) error = std::current_exception();
+        next_chunk.store(num_chunks, std::memory_order_relaxed);
+      }
+    }
+  };
+
+  Latch latch(helpers);
+  for (size_t i = 0; i < helpers; ++i) {
+    submit([&] {
+      run_chunks();
+      latch.count_down();
+    });
+  }
+  run_chunks();
+
+  // Help drain the pool while helpers finish; a helper that never got
+  // scheduled is eventually run right here
+  for (size_t spin = 0;; ++spin) {
+    {
+      std::unique_lock<std::mutex> lock(latch.mutex);
+      if (latch.remaining == 0) break;
+      if (pending_.load(std::memory_order_relaxed) == 0) {
+        latch.done.wait_for(lock, std::chrono::microseconds(100));
+        continue;
+      }
+    }
+    try_run_one(spin);
+  }
+  if (error) std::rethrow_exception(error);
+}
+
+std::shared_ptr<ThreadPool> ThreadPool::global() {
+  std::lock_guard<std::mutex> lock(global_mutex);
+  if (!global_pool) {
+    if (global_threads == 0) global_threads = default_threads();
+    // The caller participates in every parallel_for, so keep one fewer worker
+    global_pool = std::make_shared<ThreadPool>(std::max<size_t>(1, global_threads - 1));
+  }
+  return global_pool;
+}
+
+void ThreadPool::set_global_size(size_t num_threads) {
+  std::shared_ptr<ThreadPool> old;
+  {
+    std::lock_guard<std::mutex> lock(global_mutex);
+    global_threads = num_threads == 0 ? default_threads() : num_threads;
+    old = std::move(global_pool); // in-flight users keep their reference
+  }
+  // If this was the last reference, ~ThreadPool joins the old workers here,
+  // after their queued tasks have run
+}
+
+size_t ThreadPool::global_size() {
+  std::lock_guard<std::mutex> lock(global_mutex);
+  return global_threads == 0 ? default_threads() : global_threads;
+}
+
+size_t resolve_threads(size_t threads) {
+  return threads == 0 ? ThreadPool::global_size() : threads;
+}
+
+void parallel_for(size_t n, size_t grain, size_t threads,
+                  const std::function<void(size_t, size_t)> &fn) {
+  threads = resolve_threads(threads);
+  if (threads <= 1 || n <= grain) {
+    if (n > 0) fn(0, n);
+    return;
+  }
+  ThreadPool::global()->parallel_for(n, grain, threads, fn);
+}
@@ -0,0 +1,74 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Work-stealing pool: one task deque per worker. Owners pop from the back,
+// idle workers steal from the front of others. Threads waiting for their
+// own tasks execute queued work instead of blocking, so nested and
+// concurrent parallel_for calls (e.g. from several Python threads with the
+// GIL released) cannot deadlock the pool.
+class ThreadPool {
+public:
+    using Task = std::function<void()>;
+
+    explicit ThreadPool(size_t num_threads);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    size_t size() const { return workers_.size(); }
+
+    // Queue a task; it runs on some worker
+    void submit(Task task);
+    // Queue a task and get a future for its completion (and exception)
+    std::future<void> async(Task task);
+
+    // Run fn(begin, end) over [0, n) in chunks of `grain` using the calling
+    // thread plus up to max_threads - 1 workers; blocks until done and
+    // rethrows the first exception thrown by fn
+    void parallel_for(size_t n, size_t grain, size_t max_threads,
+                      const std::function<void(size_t, size_t)>& fn);
+
+    // Process-wide pool, sized by set_num_threads (default: all cores)
+    static std::shared_ptr<ThreadPool> global();
+    static void set_global_size(size_t num_threads);
+    static size_t global_size();
+
+private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    void worker_loop(size_t index);
+    bool try_run_one(size_t preferred);
+
+    std::vector<std::unique_ptr<Queue>> queues_;
+    std::vector<std::thread> workers_;
+    std::atomic<size_t> next_queue_{0};
+    std::atomic<size_t> pending_{0};
+    std::mutex sleep_mutex_;
+    std::condition_variable wake_;
+    bool stopping_ = false;
+};
+
+// Parallel loop on the global pool. threads == 0 means the global setting,
+// 1 runs inline on the caller. Ranges no larger than `grain` run inline.
+void parallel_for(size_t n, size_t grain, size_t threads,
+                  const std::function<void(size_t, size_t)>& fn);
+
+// Effective thread count for a per-call `threads` argument
+size_t resolve_threads(size_t threads);
+
+#endif // THREAD_POOL_H
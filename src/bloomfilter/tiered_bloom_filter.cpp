@@ -0,0 +1,63 @@
+#include "tiered_bloom_filter.h"
+#include "cpu_info.h"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace {
+
+constexpr double LN2_SQUARED = 0.480453013918201; // ln(2)²
+
+// Level-one error rate: level one gets at most half of the optimal total bits
+// (so p1 >= sqrt(p) and p2 = p / p1 < 1) and no more than its cache budget.
+double level1_error_rate(size_t n, double p, size_t level1_bytes) {
+  if (n == 0 || p <= 0.0 || p >= 1.0) {
+    throw std::invalid_argument(
+        "Invalid parameters: n must be > 0, p must be between 0 and 1");
+  }
+  if (level1_bytes == 0) {
+    level1_bytes = l2_cache_bytes() / 2;
+  }
+  const double optimal_bits = -static_cast<double>(n) * std::log(p) / LN2_SQUARED;
+  const double m1 = std::min(optimal_bits / 2, 8.0 * static_cast<double>(level1_bytes));
+  return std::exp(-m1 * LN2_SQUARED / static_cast<double>(n));
+}
+
+} // namespace
+
+TieredBloomFilter::TieredBloomFilter(size_t estimated_num_items,
+                                     double false_positive_rate,
+                                     size_t level1_bytes)
+    : level1_(estimated_num_items,
+              level1_error_rate(estimated_num_items, false_positive_rate, level1_bytes)),
+      level2_(estimated_num_items,
+              false_positive_rate /
+                  level1_error_rate(estimated_num_items, false_positive_rate, level1_bytes)) {}
+
+// Constructor for deserialization
+TieredBloomFilter::TieredBloomFilter(const BloomFilter &level1,
+                                     const BloomFilter &level2)
+    : level1_(level1), level2_(level2) {}
+
+void TieredBloomFilter::add(const char *data, size_t len) {
+  add_hash(hash_key(data, len));
+}
+
+bool TieredBloomFilter::might_contain(const char *data, size_t len) const {
+  return might_contain_hash(hash_key(data, len));
+}
+
+void TieredBloomFilter::add_hash(const KeyHash &hash) {
+  level1_.add_hash(level1_hash(hash));
+  level2_.add_hash(hash);
+}
+
+void TieredBloomFilter::add_hash_concurrent(const KeyHash &hash) {
+  level1_.add_hash_concurrent(level1_hash(hash));
+  level2_.add_hash_concurrent(hash);
+}
+
+bool TieredBloomFilter::might_contain_hash(const KeyHash &hash) const {
+  return level1_.might_contain_hash(level1_hash(hash)) &&
+         level2_.might_contain_hash(hash);
+}
@@ -0,0 +1,46 @@
+#ifndef TIERED_BLOOM_FILTER_H
+#define TIERED_BLOOM_FILTER_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "bloom_filter.h"
+#include "hashing.h"
+
+// Two-level filter: a small level one that stays resident in L2 in front of
+// the full-size level two. Keys go into both; a query reaches level two
+// only when level one says "maybe", so most negatives never leave the cache.
+//
+// With optimal k, a filter's bits grow with -ln(p), so splitting the target
+// p into p1 * p2 costs no extra memory over a single filter.
+class TieredBloomFilter {
+public:
+    // level1_bytes == 0 picks half the detected L2 cache
+    TieredBloomFilter(size_t estimated_num_items, double false_positive_rate,
+                      size_t level1_bytes = 0);
+    // Constructor for deserialization
+    TieredBloomFilter(const BloomFilter& level1, const BloomFilter& level2);
+
+    void add(const char* data, size_t len);
+    bool might_contain(const char* data, size_t len) const;
+
+    void add_hash(const KeyHash& hash);
+    void add_hash_concurrent(const KeyHash& hash);
+    bool might_contain_hash(const KeyHash& hash) const;
+
+    // Accessors
+    const BloomFilter& get_level1() const { return level1_; }
+    const BloomFilter& get_level2() const { return level2_; }
+
+private:
+    // Level one probes an independent remix of the key's hashes; reusing
+    // h1/h2 directly would correlate its false positives with level two's
+    static KeyHash level1_hash(const KeyHash& hash) {
+        return {mix64(hash.h1 + HASH_SEED2), mix64(hash.h2 + HASH_SEED1)};
+    }
+
+    BloomFilter level1_;
+    BloomFilter level2_;
+};
+
+#endif // TIERED_BLOOM_FILTER_H
@@ -0,0 +1,116 @@
+#define XXH_STATIC_LINKING_ONLY // XXH64_state_t on the stack
+#include "tokenizer.h"
+#include <cstring>
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define TOKENIZER_HAVE_AVX2 1
+#include <immintrin.h>
+#endif
+
+namespace {
+
+#ifdef TOKENIZER_HAVE_AVX2
+// Byte c is a delimiter iff lo_table[c & 15] has bit (c >> 4) set; the high
+// nibble table maps 0-7 to that bit and 8-15 (non-ASCII) to 0
+__attribute__((target("avx2"))) uint32_t delimiter_mask32(const char *p,
+                                                          const uint8_t *lo_table) {
+  const __m256i lo_lut = _mm256_broadcastsi128_si256(
+      _mm_load_si128(reinterpret_cast<const __m128i *>(lo_table)));
+  const __m256i hi_lut = _mm256_setr_epi8(
+      1, 2, 4, 8, 16, 32, 64, -128, 0, 0, 0, 0, 0, 0, 0, 0,
+      1, 2, 4, 8, 16, 32, 64, -128, 0, 0, 0, 0, 0, 0, 0, 0);
+  const __m256i nibble = _mm256_set1_epi8(0x0F);
+  const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+  const __m256i lo = _mm256_and_si256(v, nibble);
+  const __m256i hi = _mm256_and_si256(_mm256_srli_epi16(v, 4), nibble);
+  const __m256i hit = _mm256_and_si256(_mm256_shuffle_epi8(lo_lut, lo),
+                                       _mm256_shuffle_epi8(hi_lut, hi));
+  const __m256i none = _mm256_cmpeq_epi8(hit, _mm256_setzero_si256());
+  return ~static_cast<uint32_t>(_mm256_movemask_epi8(none));
+}
+#endif
+
+void update_lower(XXH64_state_t *state, const char *data, size_t len) {
+  char buf[256];
+  while (len > 0) {
+    const size_t n = len < sizeof(buf) ? len : sizeof(buf);
+    for (size_t i = 0; i < n; ++i) {
+      const char c = data[i];
+      buf[i] = (c >= 'A' && c <= 'Z') ? static_cast<char>(c + ('a' - 'A')) : c;
+    }
+    XXH64_update(state, buf, n);
+    data += n;
+    len -= n;
+  }
+}
+
+} // namespace
+
+Tokenizer::Tokenizer(std::string_view delimiters) {
+  is_delim_.fill(false);
+  std::memset(lo_table_, 0, sizeof(lo_table_));
+  bool ascii = true;
+  for (char c : delimiters) {
+    const unsigned char u = static_cast<unsigned char>(c);
+    is_delim_[u] = true;
+    if (u >= 0x80) {
+      ascii = false;
+    } else {
+      lo_table_[u & 0x0F] |= static_cast<uint8_t>(1u << (u >> 4));
+    }
+  }
+#ifdef TOKENIZER_HAVE_AVX2
+  simd_ = ascii && __builtin_cpu_supports("avx2");
+#else
+  simd_ = false;
+  (void)ascii;
+#endif
+}
+
+uint64_t Tokenizer::delimiter_mask(const char *p) const {
+#ifdef TOKENIZER_HAVE_AVX2
+  if (simd_) {
+    return static_cast<uint64_t>(delimiter_mask32(p, lo_table_)) |
+           static_cast<uint64_t>(delimiter_mask32(p + 32, lo_table_)) << 32;
+  }
+#endif
+  uint64_t mask = 0;
+  for (unsigned i = 0; i < 64; ++i) {
+    mask |= static_cast<uint64_t>(is_delimiter(p[i])) << i;
+  }
+  return mask;
+}
+
+KeyHash hash_joined(const std::string_view *tokens, size_t n, bool lowercase) {
+  XXH64_state_t s1, s2;
+  XXH64_reset(&s1, HASH_SEED1);
+  XXH64_reset(&s2, HASH_SEED2);
+  for (size_t i = 0; i < n; ++i) {
+    if (i > 0) {
+      XXH64_update(&s1, " ", 1);
+      XXH64_update(&s2, " ", 1);
+    }
+    if (lowercase) {
+      update_lower(&s1, tokens[i].data(), tokens[i].size());
+      update_lower(&s2, tokens[i].data(), tokens[i].size());
+    } else {
+      XXH64_update(&s1, tokens[i].data(), tokens[i].size());
+      XXH64_update(&s2, tokens[i].data(), tokens[i].size());
+    }
+  }
+  return {XXH64_digest(&s1), XXH64_digest(&s2)};
+}
+
+void join_tokens(const std::string_view *tokens, size_t n, bool lowercase, std::string &out) {
+  out.clear();
+  for (size_t i = 0; i < n; ++i) {
+    if (i > 0) out.push_back(' ');
+    if (lowercase) {
+      for (const char c : tokens[i]) {
+        out.push_back((c >= 'A' && c <= 'Z') ? static_cast<char>(c + ('a' - 'A')) : c);
+      }
+    } else {
+      out.append(tokens[i].data(), tokens[i].size());
+    }
+  }
+}
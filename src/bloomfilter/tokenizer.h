@@ -0,0 +1,174 @@
+#ifndef TOKENIZER_H
+#define TOKENIZER_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+#include "hashing.h"
+
+// Splits text into maximal runs of non-delimiter bytes. Tokens are views
+// into the source buffer; nothing is copied. Delimiters are located 64 bytes
+// at a time (AVX2 nibble lookup when the set is ASCII and the CPU has it).
+class Tokenizer {
+public:
+    static constexpr std::string_view DEFAULT_DELIMITERS =
+        " \t\r\n\v\f,;:.!?\"'`()[]{}<>=/\\|";
+
+    explicit Tokenizer(std::string_view delimiters = DEFAULT_DELIMITERS);
+
+    bool is_delimiter(char c) const { return is_delim_[static_cast<unsigned char>(c)]; }
+
+    // Bit i set iff p[i] is a delimiter; reads exactly 64 bytes
+    uint64_t delimiter_mask(const char* p) const;
+
+    // Calls fn(token) for every token; fn may return false to stop early.
+    // Returns false if stopped.
+    template <typename Fn>
+    bool for_each_token(const char* data, size_t len, Fn&& fn) const;
+
+private:
+    std::array<bool, 256> is_delim_;
+    alignas(16) uint8_t lo_table_[16]; // high nibbles (0-7) delimited per low nibble
+    bool simd_;
+};
+
+namespace tokenizer_detail {
+
+template <typename Fn>
+bool call(Fn& fn, std::string_view token) {
+    if constexpr (std::is_same_v<decltype(fn(token)), bool>) {
+        return fn(token);
+    } else {
+        fn(token);
+        return true;
+    }
+}
+
+inline unsigned ctz64(uint64_t x) {
+#if defined(_MSC_VER) && !defined(__clang__)
+    unsigned long i;
+    _BitScanForward64(&i, x);
+    return static_cast<unsigned>(i);
+#else
+    return static_cast<unsigned>(__builtin_ctzll(x));
+#endif
+}
+
+} // namespace tokenizer_detail
+
+template <typename Fn>
+bool Tokenizer::for_each_token(const char* data, size_t len, Fn&& fn) const {
+    size_t start = 0;
+    bool in_token = false;
+    char tail[64];
+    for (size_t base = 0; base < len; base += 64) {
+        const size_t avail = len - base;
+        uint64_t delims;
+        if (avail >= 64) {
+            delims = delimiter_mask(data + base);
+        } else {
+            for (size_t i = 0; i < avail; ++i) tail[i] = data[base + i];
+            for (size_t i = avail; i < 64; ++i) tail[i] = 0;
+            delims = delimiter_mask(tail) | (~0ULL << avail);
+        }
+        // Walk alternating runs of token and delimiter bytes within the block
+        unsigned pos = 0;
+        while (pos < 64) {
+            const uint64_t rest = (in_token ? delims : ~delims) >> pos;
+            if (rest == 0) break;
+            pos += tokenizer_detail::ctz64(rest);
+            if (in_token) {
+                if (!tokenizer_detail::call(fn, std::string_view(data + start, base + pos - start))) {
+                    return false;
+                }
+            } else {
+                start = base + pos;
+            }
+            in_token = !in_token;
+        }
+    }
+    // A token running to the end of a whole number of blocks is still open
+    if (in_token) return tokenizer_detail::call(fn, std::string_view(data + start, len - start));
+    return true;
+}
+
+// How text is turned into filter keys: tokens are optionally ASCII-lowercased
+// and, for ngram > 1, every run of 2..ngram consecutive tokens is also a key,
+// hashed as the tokens joined by single spaces
+struct TokenOptions {
+    static constexpr size_t MAX_NGRAM = 8;
+
+    bool lowercase = false;
+    size_t ngram = 1; // 1..MAX_NGRAM; larger values throw std::invalid_argument
+};
+
+// hash_key of tokens[0..n) joined by ' ' (lowercased if requested)
+KeyHash hash_joined(const std::string_view* tokens, size_t n, bool lowercase);
+// The bytes hash_joined hashes, written to out
+void join_tokens(const std::string_view* tokens, size_t n, bool lowercase, std::string& out);
+
+namespace token_detail {
+
+// Calls fn(key_hash(tokens, n)) for every key derived from text, where
+// tokens[0..n) are the key's words
+template <typename KeyHashFn, typename Fn>
+bool for_each_token_key(const Tokenizer& tokenizer, const TokenOptions& options,
+                        const char* data, size_t len, KeyHashFn&& key_hash, Fn&& fn) {
+    constexpr size_t MAX_NGRAM = TokenOptions::MAX_NGRAM;
+    if (options.ngram > MAX_NGRAM) {
+        throw std::invalid_argument("ngram must be at most " + std::to_string(MAX_NGRAM));
+    }
+    std::string_view window[MAX_NGRAM]; // last `ngram` tokens, oldest first
+    const size_t ngram = options.ngram < 1 ? 1 : options.ngram;
+    size_t filled = 0;
+    return tokenizer.for_each_token(data, len, [&](std::string_view token) {
+        if (filled == ngram) {
+            for (size_t i = 1; i < ngram; ++i) window[i - 1] = window[i];
+            --filled;
+        }
+        window[filled++] = token;
+        for (size_t g = 1; g <= filled; ++g) {
+            if (!fn(key_hash(window + filled - g, g))) return false;
+        }
+        return true;
+    });
+}
+
+} // namespace token_detail
+
+// Calls fn(KeyHash) for every key derived from text; fn may return false to
+// stop early. Returns false if stopped.
+template <typename Fn>
+bool for_each_token_hash(const Tokenizer& tokenizer, const TokenOptions& options,
+                         const char* data, size_t len, Fn&& fn) {
+    return token_detail::for_each_token_key(
+        tokenizer, options, data, len,
+        [&options](const std::string_view* tokens, size_t n) {
+            return n == 1 && !options.lowercase ? hash_key(tokens->data(), tokens->size())
+                                                : hash_joined(tokens, n, options.lowercase);
+        },
+        fn);
+}
+
+// Same keys hashed by hasher(data, len) instead of hash_key, for filters
+// with another hash scheme. Lowercased and joined keys are built in a buffer.
+template <typename Hasher, typename Fn>
+bool for_each_token_hash(const Tokenizer& tokenizer, const TokenOptions& options,
+                         const char* data, size_t len, const Hasher& hasher, Fn&& fn) {
+    std::string buffer;
+    return token_detail::for_each_token_key(
+        tokenizer, options, data, len,
+        [&](const std::string_view* tokens, size_t n) {
+            if (n == 1 && !options.lowercase) return hasher(tokens->data(), tokens->size());
+            join_tokens(tokens, n, options.lowercase, buffer);
+            return hasher(buffer.data(), buffer.size());
+        },
+        fn);
+}
+
+#endif // TOKENIZER_H
@@ -0,0 +1,73 @@
+// bloomfilter-merge: OR saved filter files (BloomFilter.save,
+// BlockedBloomFilter.save) into one, streaming them in bounded memory
+
+#include "filter_merge.h"
+#include "thread_pool.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+
+void usage(const char *argv0) {
+  std::fprintf(stderr,
+               "usage: %s [--threads N] [--memory MB] OUT IN...\n"
+               "  --threads N   worker threads (default: all cores)\n"
+               "  --memory MB   stripe plus read buffers (default 256)\n"
+               "  IN            input filter files; '-' reads one path per line from stdin\n",
+               argv0);
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  size_t threads = 0;
+  size_t memory_bytes = 0;
+  std::vector<std::string> positional;
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    const bool has_value = i + 1 < argc;
+    if (arg == "--threads" && has_value) {
+      threads = std::strtoull(argv[++i], nullptr, 10);
+    } else if (arg == "--memory" && has_value) {
+      memory_bytes = std::strtoull(argv[++i], nullptr, 10) << 20;
+    } else if (arg == "--help" || arg == "-h" || (arg.size() > 1 && arg.compare(0, 2, "--") == 0)) {
+      usage(argv[0]);
+      return arg == "--help" || arg == "-h" ? 0 : 2;
+    } else {
+      positional.push_back(arg);
+    }
+  }
+  if (positional.size() < 2) {
+    usage(argv[0]);
+    return 2;
+  }
+
+  const std::string out_path = positional[0];
+  std::vector<std::string> inputs;
+  for (size_t i = 1; i < positional.size(); ++i) {
+    if (positional[i] != "-") {
+      inputs.push_back(positional[i]);
+      continue;
+    }
+    for (std::string line; std::getline(std::cin, line);) {
+      if (!line.empty()) inputs.push_back(line);
+    }
+  }
+
+  try {
+    const FilterFileHeader header = merge_filter_files(inputs, out_path, threads, memory_bytes);
+    std::fprintf(stderr, "merged %zu files (%llu bits, %s layout, %s) into %s\n", inputs.size(),
+                 static_cast<unsigned long long>(header.num_bits),
+                 filter_layout_name(header.layout), hash_scheme_name(header.hash_scheme),
+                 out_path.c_str());
+  } catch (const std::exception &e) {
+    std::fprintf(stderr, "bloomfilter-merge: %s\n", e.what());
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,442 @@
+#include "tuner.h"
+#include "bloom_engine.h"
+#include "cpu_info.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <mutex>
+#include <new>
+#include <numeric>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <unistd.h>
+#endif
+
+namespace {
+
+constexpr size_t MAX_TUNED_HASHES = 16;
+// k values the microbenchmark times; costs in between are interpolated
+constexpr size_t BENCH_HASHES[] = {1, 2, 3, 4, 6, 8, 12, 16};
+constexpr size_t NUM_BENCH_HASHES = sizeof(BENCH_HASHES) / sizeof(BENCH_HASHES[0]);
+constexpr size_t NUM_LAYOUTS = 4;
+// Filter sizes timed: L2-resident, LLC-resident and DRAM-resident
+constexpr size_t NUM_SIZES = 3;
+constexpr size_t BENCH_LOOKUPS = 1 << 14;
+constexpr int BENCH_REPEATS = 3;
+constexpr int CACHE_FORMAT_VERSION = 1;
+// Configurations this close count as ties on the primary objective
+constexpr double TIE_RATIO = 1.02;
+
+constexpr FilterLayout LAYOUTS[NUM_LAYOUTS] = {FilterLayout::Standard, FilterLayout::Blocked,
+                                               FilterLayout::SplitBlock,
+                                               FilterLayout::Partitioned};
+
+size_t bytes_for(size_t bits) { return (bits + 63) / 64 * 8; }
+
+// Sizes step in whole words so memory_bytes is met exactly
+size_t size_granule(FilterLayout layout, size_t num_hashes) {
+  return std::lcm(layout_granule(layout, num_hashes), size_t{64});
+}
+
+// Expectation of rate(j) over a block's load j ~ Poisson(lambda)
+template <typename Fn> double poisson_mix(double lambda, Fn &&rate) {
+  const double spread = 12.0 * std::sqrt(lambda) + 12.0;
+  const size_t lo = lambda > spread ? static_cast<size_t>(lambda - spread) : 0;
+  const size_t hi = static_cast<size_t>(lambda + spread);
+  double sum = 0.0;
+  for (size_t j = lo; j <= hi; ++j) {
+    const double jd = static_cast<double>(j);
+    sum += std::exp(jd * std::log(lambda) - lambda - std::lgamma(jd + 1.0)) * rate(jd);
+  }
+  return sum;
+}
+
+// ns per lookup by [layout][BENCH_HASHES index][size]
+struct CostTable {
+  size_t bytes[NUM_SIZES];
+  double ns[NUM_LAYOUTS][NUM_BENCH_HASHES][NUM_SIZES];
+
+  double lookup_ns(FilterLayout layout, size_t num_hashes, size_t num_bytes) const {
+    const size_t l = static_cast<size_t>(layout);
+    // Linear in k between timed values, then in log2(size) between sizes
+    size_t hi = 0;
+    while (hi + 1 < NUM_BENCH_HASHES && BENCH_HASHES[hi] < num_hashes) ++hi;
+    const size_t lo = hi > 0 && BENCH_HASHES[hi] > num_hashes ? hi - 1 : hi;
+    const double tk = lo == hi ? 0.0
+                               : static_cast<double>(num_hashes - BENCH_HASHES[lo]) /
+                                     static_cast<double>(BENCH_HASHES[hi] - BENCH_HASHES[lo]);
+    double by_size[NUM_SIZES];
+    for (size_t s = 0; s < NUM_SIZES; ++s) {
+      by_size[s] = ns[l][lo][s] + tk * (ns[l][hi][s] - ns[l][lo][s]);
+    }
+    if (num_bytes <= bytes[0]) return by_size[0];
+    for (size_t s = 1; s < NUM_SIZES; ++s) {
+      if (num_bytes <= bytes[s]) {
+        const double ts = std::log2(static_cast<double>(num_bytes) / bytes[s - 1]) /
+                          std::log2(static_cast<double>(bytes[s]) / bytes[s - 1]);
+        return by_size[s - 1] + ts * (by_size[s] - by_size[s - 1]);
+      }
+    }
+    return by_size[NUM_SIZES - 1];
+  }
+};
+
+bool benched(FilterLayout layout, size_t num_hashes) {
+  return layout != FilterLayout::SplitBlock || num_hashes == SPLIT_BLOCK_LAYOUT_HASHES;
+}
+
+uint64_t splitmix64(uint64_t &state) {
+  uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+  return z ^ (z >> 31);
+}
+
+// Best-of-N ns per lookup of 16-byte keys, hashing included, through the
+// same engine kernels BloomFilter runs. Misses stop at the first clear bit
+// of the half-full array; hits visit all k probes.
+template <class Layout>
+double time_lookups(size_t num_bits, size_t num_hashes, const std::vector<uint64_t> &words,
+                    bool hits) {
+  using Kernel = BloomEngine<Xxh64PairHash, Layout>;
+  const Layout layout(num_bits, num_hashes);
+  const uint64_t *data = words.data();
+  double best = std::numeric_limits<double>::infinity();
+  volatile uint64_t sink = 0;
+  for (int rep = 0; rep <= BENCH_REPEATS; ++rep) { // rep 0 warms up
+    uint64_t found = 0;
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < BENCH_LOOKUPS; ++i) {
+      const uint64_t key[2] = {i + rep * BENCH_LOOKUPS, 0x2545F4914F6CDD1DULL};
+      const KeyHash hash = Kernel::hash(reinterpret_cast<const char *>(key), sizeof(key));
+      if (hits) {
+        uint64_t all = 1;
+        layout.for_each_bit(hash, [&](uint64_t bit) {
+          all &= (data[bit >> 6] >> (bit & 63)) & 1;
+          return true;
+        });
+        found += all;
+      } else {
+        found += Kernel::test(layout, data, hash);
+      }
+    }
+    const double ns = std::chrono::duration<double, std::nano>(
+                          std::chrono::steady_clock::now() - start).count();
+    sink = sink + found;
+    if (rep > 0) best = std::min(best, ns / BENCH_LOOKUPS);
+  }
+  return best;
+}
+
+double time_lookups(FilterLayout layout, size_t num_bits, size_t num_hashes,
+                    const std::vector<uint64_t> &words, bool hits) {
+  switch (layout) {
+  case FilterLayout::Blocked:
+    return time_lookups<BlockedLayout<>>(num_bits, num_hashes, words, hits);
+  case FilterLayout::SplitBlock:
+    return time_lookups<SplitBlockLayout<>>(num_bits, num_hashes, words, hits);
+  case FilterLayout::Partitioned:
+    return time_lookups<PartitionedLayout<>>(num_bits, num_hashes, words, hits);
+  default:
+    return time_lookups<StandardLayout<>>(num_bits, num_hashes, words, hits);
+  }
+}
+
+// Array for the DRAM timings: 4x the LLC within 32..128 MB, or
+// $BLOOMFILTER_TUNING_DRAM_MB; never below twice the LLC-sized array
+size_t dram_probe_bytes(size_t llc, size_t llc_array) {
+  size_t bytes = std::clamp(4 * llc, size_t{32} << 20, size_t{128} << 20);
+  if (const char *mb = std::getenv("BLOOMFILTER_TUNING_DRAM_MB"); mb && *mb) {
+    const unsigned long long value = std::strtoull(mb, nullptr, 10);
+    if (value > 0 && value < (std::numeric_limits<size_t>::max() >> 21)) {
+      bytes = static_cast<size_t>(value) << 20;
+    }
+  }
+  return std::max(bytes, 2 * llc_array);
+}
+
+CostTable measure_costs() {
+  CostTable table{};
+  const size_t l2 = l2_cache_bytes();
+  const size_t llc = std::max(llc_cache_bytes(), 4 * l2);
+  const size_t page = 4096;
+  table.bytes[0] = std::max(page, l2 / 2 / page * page);
+  table.bytes[1] = std::max(2 * l2, std::min(llc / 2, size_t{32} << 20)) / page * page;
+  table.bytes[2] = dram_probe_bytes(llc, table.bytes[1]);
+
+  for (size_t s = 0; s < NUM_SIZES; ++s) {
+    std::vector<uint64_t> words;
+    for (;;) {
+      try {
+        words.resize(table.bytes[s] / 8);
+        break;
+      } catch (const std::bad_alloc &) {
+        if (s + 1 < NUM_SIZES || table.bytes[s] <= 2 * table.bytes[s - 1]) throw;
+        table.bytes[s] /= 2;
+      }
+    }
+    uint64_t state = s;
+    for (uint64_t &w : words) w = splitmix64(state); // half of the bits set
+
+    for (size_t l = 0; l < NUM_LAYOUTS; ++l) {
+      for (size_t h = 0; h < NUM_BENCH_HASHES; ++h) {
+        const size_t k = BENCH_HASHES[h];
+        if (!benched(LAYOUTS[l], k)) continue;
+        const size_t granule = size_granule(LAYOUTS[l], k);
+        const size_t bits = table.bytes[s] * 8 / granule * granule;
+        table.ns[l][h][s] = 0.5 * (time_lookups(LAYOUTS[l], bits, k, words, false) +
+                                   time_lookups(LAYOUTS[l], bits, k, words, true));
+      }
+    }
+  }
+  // Split-block has one k: give every index its timing
+  const size_t sb = static_cast<size_t>(FilterLayout::SplitBlock);
+  size_t h8 = 0;
+  while (BENCH_HASHES[h8] != SPLIT_BLOCK_LAYOUT_HASHES) ++h8;
+  for (size_t h = 0; h < NUM_BENCH_HASHES; ++h) {
+    std::copy(table.ns[sb][h8], table.ns[sb][h8] + NUM_SIZES, table.ns[sb][h]);
+  }
+  return table;
+}
+
+std::string host_name() {
+#if defined(__unix__) || defined(__APPLE__)
+  char name[256] = {};
+  if (gethostname(name, sizeof(name) - 1) == 0 && name[0]) return name;
+#else
+  if (const char *name = std::getenv("COMPUTERNAME")) return name;
+#endif
+  return "localhost";
+}
+
+// Timings are only reused on the machine that produced them
+std::string machine_fingerprint() {
+  std::string cpu;
+  std::ifstream info("/proc/cpuinfo");
+  for (std::string line; std::getline(info, line);) {
+    if (line.compare(0, 10, "model name") == 0) {
+      cpu = line.substr(line.find(':') + 1);
+      break;
+    }
+  }
+  std::ostringstream out;
+  out << host_name() << '|' << cpu << '|' << l2_cache_bytes() << '|' << llc_cache_bytes();
+  std::string fp = out.str();
+  std::replace(fp.begin(), fp.end(), '\n', ' ');
+  return fp;
+}
+
+std::string cache_path() {
+  if (const char *path = std::getenv("BLOOMFILTER_TUNING_CACHE")) return path;
+  std::string dir;
+  if (const char *xdg = std::getenv("XDG_CACHE_HOME"); xdg && *xdg) {
+    dir = xdg;
+  } else if (const char *home = std::getenv("HOME"); home && *home) {
+    dir = std::string(home) + "/.cache";
+  } else if (const char *local = std::getenv("LOCALAPPDATA"); local && *local) {
+    dir = local;
+  } else {
+    return "";
+  }
+  std::string host = host_name();
+  std::replace_if(host.begin(), host.end(), [](char c) { return c == '/' || c == '\\'; }, '_');
+  return dir + "/bloomfilter/tuning-" + host + ".txt";
+}
+
+std::optional<CostTable> load_costs(const std::string &path, const std::string &fingerprint) {
+  std::ifstream in(path);
+  std::string magic, line;
+  int version = 0;
+  if (!(in >> magic >> version) || magic != "bloomfilter-tuning" ||
+      version != CACHE_FORMAT_VERSION) {
+    return std::nullopt;
+  }
+  std::getline(in, line);
+  if (!std::getline(in, line) || line != "machine " + fingerprint) return std::nullopt;
+
+  CostTable table{};
+  std::string word;
+  if (!(in >> word) || word != "sizes") return std::nullopt;
+  for (size_t &b : table.bytes) {
+    if (!(in >> b) || b == 0) return std::nullopt;
+  }
+  size_t seen = 0;
+  std::string layout_name;
+  size_t k = 0;
+  while (in >> layout_name >> k) {
+    size_t l = 0;
+    while (l < NUM_LAYOUTS && layout_name != filter_layout_name(LAYOUTS[l])) ++l;
+    size_t h = 0;
+    while (h < NUM_BENCH_HASHES && BENCH_HASHES[h] != k) ++h;
+    if (l == NUM_LAYOUTS || h == NUM_BENCH_HASHES) return std::nullopt;
+    for (double &ns : table.ns[l][h]) {
+      if (!(in >> ns) || !(ns > 0.0)) return std::nullopt;
+    }
+    ++seen;
+  }
+  if (seen != NUM_LAYOUTS * NUM_BENCH_HASHES) return std::nullopt;
+  return table;
+}
+
+// Best effort: a read-only or missing cache directory only costs a re-run
+void store_costs(const std::string &path, const std::string &fingerprint,
+                 const CostTable &table) {
+  std::error_code ec;
+  const std::filesystem::path target(path);
+  if (target.has_parent_path()) std::filesystem::create_directories(target.parent_path(), ec);
+  // Write then rename, so concurrent processes never read a partial file
+  const std::string tmp = path + ".tmp" + std::to_string(std::chrono::steady_clock::now()
+                                                             .time_since_epoch().count());
+  {
+    std::ofstream out(tmp, std::ios::trunc);
+    if (!out) return;
+    out << "bloomfilter-tuning " << CACHE_FORMAT_VERSION << "\n"
+        << "machine " << fingerprint << "\n"
+        << "sizes " << table.bytes[0] << ' ' << table.bytes[1] << ' ' << table.bytes[2] << "\n";
+    for (size_t l = 0; l < NUM_LAYOUTS; ++l) {
+      for (size_t h = 0; h < NUM_BENCH_HASHES; ++h) {
+        out << filter_layout_name(LAYOUTS[l]) << ' ' << BENCH_HASHES[h];
+        for (double ns : table.ns[l][h]) out << ' ' << ns;
+        out << "\n";
+      }
+    }
+    if (!out) {
+      std::filesystem::remove(tmp, ec);
+      return;
+    }
+  }
+  std::filesystem::rename(tmp, target, ec);
+  if (ec) std::filesystem::remove(tmp, ec);
+}
+
+const CostTable &cost_table() {
+  static std::mutex mutex;
+  static std::optional<CostTable> table;
+  std::lock_guard<std::mutex> lock(mutex);
+  if (!table) {
+    const std::string path = cache_path();
+    const std::string fingerprint = machine_fingerprint();
+    if (!path.empty()) table = load_costs(path, fingerprint);
+    if (!table) {
+      table = measure_costs();
+      if (!path.empty()) store_costs(path, fingerprint, *table);
+    }
+  }
+  return *table;
+}
+
+} // namespace
+
+TuneObjective parse_tune_objective(const std::string &name) {
+  if (name == "latency") return TuneObjective::Latency;
+  if (name == "space") return TuneObjective::Space;
+  throw std::invalid_argument("optimize must be 'latency' or 'space'");
+}
+
+double predicted_fpr(FilterLayout layout, size_t n, size_t num_bits, size_t num_hashes) {
+  const double k = static_cast<double>(num_hashes);
+  const double items = static_cast<double>(n);
+  const double m = static_cast<double>(num_bits);
+  switch (layout) {
+  case FilterLayout::Blocked: {
+    const double b = static_cast<double>(BLOCKED_LAYOUT_BITS);
+    const double lambda = items * b / m;
+    const double fpr = poisson_mix(lambda, [&](double j) {
+      return std::pow(-std::expm1(j * k * std::log1p(-1.0 / b)), k);
+    });
+    // In-block probes are double hashing mod 512: only 2^18 distinct bit
+    // sets, so a key sharing the query's set is a floor on the rate
+    return fpr + (1.0 - fpr) * std::min(1.0, lambda / 262144.0);
+  }
+  case FilterLayout::SplitBlock: {
+    // Each of the eight 32-bit words gets one bit per key in the block
+    const double b = static_cast<double>(SPLIT_BLOCK_LAYOUT_BITS);
+    return poisson_mix(items * b / m, [](double j) {
+      return std::pow(-std::expm1(j * std::log1p(-1.0 / 32.0)), 8.0);
+    });
+  }
+  case FilterLayout::Partitioned:
+    return std::pow(-std::expm1(items * std::log1p(-k / m)), k);
+  default:
+    return std::pow(-std::expm1(k * items * std::log1p(-1.0 / m)), k);
+  }
+}
+
+TunedConfig tune_filter(size_t n, size_t memory_bytes, double false_positive_rate,
+                        TuneObjective objective) {
+  if (n == 0 || false_positive_rate <= 0.0 || false_positive_rate >= 1.0) {
+    throw std::invalid_argument(
+        "Invalid parameters: n must be > 0, p must be between 0 and 1");
+  }
+  static constexpr double LN2_SQUARED = 0.480453013918201;
+  const double optimal_bits = -static_cast<double>(n) * std::log(false_positive_rate) / LN2_SQUARED;
+  const double max_bytes = static_cast<double>(std::numeric_limits<size_t>::max() / 8);
+  if (memory_bytes == 0) {
+    memory_bytes = static_cast<size_t>(std::min(max_bytes, std::ceil(1.5 * optimal_bits / 8)));
+  }
+  const size_t budget_bits = std::min<double>(memory_bytes, max_bytes) * 8;
+
+  const CostTable &costs = cost_table();
+  std::vector<TunedConfig> candidates;
+  auto add_candidate = [&](FilterLayout layout, size_t bits, size_t k) {
+    candidates.push_back({layout, bits, k, predicted_fpr(layout, n, bits, k),
+                          costs.lookup_ns(layout, k, bytes_for(bits))});
+  };
+  for (FilterLayout layout : LAYOUTS) {
+    for (size_t k = 1; k <= MAX_TUNED_HASHES; ++k) {
+      if (layout == FilterLayout::SplitBlock && k != SPLIT_BLOCK_LAYOUT_HASHES) continue;
+      const size_t granule = size_granule(layout, k);
+      const size_t max_units = budget_bits / granule;
+      if (max_units == 0 ||
+          predicted_fpr(layout, n, max_units * granule, k) > false_positive_rate) {
+        continue;
+      }
+      // Smallest size meeting the target: the rate falls as size grows
+      size_t lo = 1, hi = max_units;
+      while (lo < hi) {
+        const size_t mid = lo + (hi - lo) / 2;
+        if (predicted_fpr(layout, n, mid * granule, k) <= false_positive_rate) {
+          hi = mid;
+        } else {
+          lo = mid + 1;
+        }
+      }
+      add_candidate(layout, lo * granule, k);
+      // Spending the whole budget lowers the rate but may leave the cache
+      if (objective == TuneObjective::Latency && lo != max_units) {
+        add_candidate(layout, max_units * granule, k);
+      }
+    }
+  }
+  if (candidates.empty()) {
+    std::ostringstream msg;
+    msg << "No filter layout reaches false_positive_rate " << false_positive_rate << " for "
+        << n << " items in " << memory_bytes << " bytes (a standard filter needs about "
+        << static_cast<size_t>(std::ceil(optimal_bits / 8)) << ")";
+    throw std::invalid_argument(msg.str());
+  }
+
+  auto bytes = [](const TunedConfig &c) { return static_cast<double>(bytes_for(c.num_bits)); };
+  const bool latency = objective == TuneObjective::Latency;
+  auto primary = [&](const TunedConfig &c) { return latency ? c.lookup_ns : bytes(c); };
+  auto secondary = [&](const TunedConfig &c) { return latency ? bytes(c) : c.lookup_ns; };
+  double best_primary = std::numeric_limits<double>::infinity();
+  for (const TunedConfig &c : candidates) best_primary = std::min(best_primary, primary(c));
+  const TunedConfig *best = nullptr;
+  for (const TunedConfig &c : candidates) {
+    if (primary(c) > best_primary * TIE_RATIO) continue;
+    if (!best || secondary(c) < secondary(*best) ||
+        (secondary(c) == secondary(*best) && c.false_positive_rate < best->false_positive_rate)) {
+      best = &c;
+    }
+  }
+  return *best;
+}
@@ -0,0 +1,38 @@
+#ifndef BLOOM_TUNER_H
+#define BLOOM_TUNER_H
+
+#include <cstddef>
+#include <string>
+
+#include "filter_layout.h"
+
+enum class TuneObjective {
+    Latency, // cheapest lookup on this host within the memory budget
+    Space,   // smallest filter; near-ties go to the cheaper lookup
+};
+
+TuneObjective parse_tune_objective(const std::string& name);
+
+struct TunedConfig {
+    FilterLayout layout;
+    size_t num_bits;
+    size_t num_hashes;
+    double false_positive_rate; // analytic model at the estimated item count
+    double lookup_ns;           // measured cost per lookup, hashing included
+};
+
+// Expected false positive rate of the layout after n distinct insertions
+double predicted_fpr(FilterLayout layout, size_t n, size_t num_bits, size_t num_hashes);
+
+// Searches layouts and k = 1..16 for filters of at most memory_bytes that
+// meet false_positive_rate for n items, and picks one per the objective.
+// memory_bytes = 0 allows 1.5x the space-optimal standard filter. Lookup
+// costs come from a short microbenchmark, run once per machine and cached
+// in $BLOOMFILTER_TUNING_CACHE (empty: no cache) or the user cache directory.
+// Without a cached table the first call allocates and touches an array of
+// up to 128 MB ($BLOOMFILTER_TUNING_DRAM_MB overrides) for DRAM timings.
+// Throws std::invalid_argument when no configuration fits.
+TunedConfig tune_filter(size_t n, size_t memory_bytes, double false_positive_rate,
+                        TuneObjective objective);
+
+#endif // BLOOM_TUNER_H